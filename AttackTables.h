@@ -0,0 +1,50 @@
+#ifndef ATTACKTABLES_H
+#define ATTACKTABLES_H
+
+#include"Pieces.h"
+#include<cstdint>
+
+/** Attack tables for the leaping pieces, generated at compile time.
+ *  Each entry is a 64-bit set with bit n set if square index n (row * 8 + col, see Move.h)
+ *  can be reached from the entry's square, so there is no start-up cost and no delta arithmetic.
+ */
+namespace AttackTables {
+
+  /** One 64-bit set per square. */
+  struct SquareSets {
+    uint64_t sets[64];
+    constexpr uint64_t operator[](const int square) const { return sets[square]; }
+  };
+
+  /** Builds a table from a list of (row, col) offsets, skipping destinations off the board. */
+  constexpr SquareSets buildLeaperTable(const int offsets[][2], const int count) {
+    SquareSets table{};
+    for (int square = 0; square < 64; square++) {
+      int row = square / 8, col = square % 8;
+      for (int k = 0; k < count; k++) {
+	int toRow = row + offsets[k][0], toCol = col + offsets[k][1];
+	if (toRow >= 0 && toRow < 8 && toCol >= 0 && toCol < 8) {
+	  table.sets[square] |= 1ULL << (toRow * 8 + toCol);
+	}
+      }
+    }
+    return table;
+  }
+
+  constexpr int KNIGHT_OFFSETS[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+  constexpr int KING_OFFSETS[8][2] = {{-1, -1}, {-1, 0}, {-1, 1}, {0, -1}, {0, 1}, {1, -1}, {1, 0}, {1, 1}};
+  // White pawns move towards row 0, Black pawns towards row 7
+  constexpr int WHITE_PAWN_CAPTURES[2][2] = {{-1, -1}, {-1, 1}};
+  constexpr int BLACK_PAWN_CAPTURES[2][2] = {{1, -1}, {1, 1}};
+
+  constexpr SquareSets KNIGHT_ATTACKS = buildLeaperTable(KNIGHT_OFFSETS, 8);
+  constexpr SquareSets KING_ATTACKS = buildLeaperTable(KING_OFFSETS, 8);
+  /** Squares a pawn of each colour attacks, indexed by Colour then square. */
+  constexpr SquareSets PAWN_ATTACKS[2] = {buildLeaperTable(WHITE_PAWN_CAPTURES, 2),
+					  buildLeaperTable(BLACK_PAWN_CAPTURES, 2)};
+
+  /** Checks if square index to is in a set. */
+  constexpr bool contains(const uint64_t set, const int to) { return (set >> to) & 1ULL; }
+}
+
+#endif // ATTACKTABLES_H
@@ -0,0 +1,1527 @@
+#include"ChessBoard.h"
+#include"Engine.h"
+#include"Evaluation.h"
+#include"PackedPosition.h"
+#include"Pgn.h"
+#include"PositionIndex.h"
+#include"Search.h"
+#include"SearchScheduler.h"
+
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<iostream>
+#include<malloc.h>
+#include<memory>
+#include<string>
+#include<thread>
+#include<unistd.h>
+#include<unordered_map>
+#include<vector>
+
+using std::cout;
+
+namespace {
+  /** Fixed benchmark positions, so node counts are comparable between builds. */
+  const char* BENCH_FENS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4",
+    "r2q1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 9",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1",
+  };
+  const int BENCH_FEN_COUNT = sizeof(BENCH_FENS) / sizeof(BENCH_FENS[0]);
+
+  /** Tactical test positions from the Win At Chess suite, with their best moves in SAN. */
+  struct TacticalPosition {
+    const char* fen;
+    const char* bestMoves;
+  };
+  const TacticalPosition TACTICAL_SUITE[] = {
+    {"2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - 0 1", "Qg6"},
+    {"8/7p/5k2/5p2/p1p2P2/Pr1pPK2/1P1R3P/8 b - - 0 1", "Rxb2"},
+    {"5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w - - 0 1", "Rg3"},
+    {"r1bq2rk/pp3pbp/2p1p1pQ/7P/3P4/2PB1N2/PP3PPR/2KR4 w - - 0 1", "Qxh7+"},
+    {"5k2/6pp/p1qN4/1p1p4/3P4/2PKP2Q/PP3r2/3R4 b - - 0 1", "Qc4+"},
+    {"7k/p7/1R5K/6r1/6p1/6P1/8/8 w - - 0 1", "Rb7"},
+    {"rnbqkb1r/pppp1ppp/8/4P3/6n1/7P/PPPNPPP1/R1BQKBNR b KQkq - 0 1", "Ne3"},
+    {"r4q1k/p2bR1rp/2p2Q1N/5p2/5p2/2P5/PP3PPP/R5K1 w - - 0 1", "Rf7"},
+    {"3q1rk1/p4pp1/2pb3p/3p4/6Pr/1PNQ4/P1PB1PP1/4RRK1 b - - 0 1", "Bh2+"},
+    {"2br2k1/2q3rn/p2NppQ1/2p1P3/Pp5R/4P3/1P3PPP/3R2K1 w - - 0 1", "Rxh7"},
+    {"r1b1kb1r/3q1ppp/pBp1pn2/8/Np3P2/5B2/PPP3PP/R2Q1RK1 w kq - 0 1", "Bxc6"},
+    {"4k1r1/2p3r1/1pR1p3/3pP2p/3P2qP/P4N2/1PQ4P/5R1K b - - 0 1", "Qxf3+"},
+    {"5rk1/pp4p1/2n1p2p/2Npq3/2p5/6P1/P3P1BP/R4Q1K w - - 0 1", "Qxf8+"},
+    {"r2rb1k1/pp1q1p1p/2n1p1p1/2bp4/5P2/PP1BPR1Q/1BPN2PP/R5K1 w - - 0 1", "Qxh7+"},
+    {"1R6/1brk2p1/4p2p/p1P1Pp2/P7/6P1/1P4P1/2R3K1 w - - 0 1", "Rxb7"},
+    {"r4rk1/ppp2ppp/2n5/2bqp3/8/P2PB3/1PP1NPPP/R2Q1RK1 w - - 0 1", "Nc3"},
+    {"R7/P4k2/8/8/8/8/r7/6K1 w - - 0 1", "Rh8"},
+    {"r1b2rk1/ppbn1ppp/4p3/1QP4q/3P4/N4N2/5PPP/R1B2RK1 w - - 0 1", "c6"},
+    {"r2qkb1r/1ppb1ppp/p7/4p3/P1Q1P3/2P5/5PPP/R1B2KNR b kq - 0 1", "Bb5"},
+    {"5rk1/1b3p1p/pp3p2/3n1N2/1P6/P1qB1PP1/3Q3P/4R1K1 w - - 0 1", "Qh6"},
+    {"r1bqk2r/ppp1nppp/4p3/n5N1/2BPp3/P1P5/2P2PPP/R1BQK2R w KQkq - 0 1", "Ba2 Nxf7"},
+    {"r3nrk1/2p2p1p/p1p1b1p1/2NpPq2/3R4/P1N1Q3/1PP2PPP/4R1K1 w - - 0 1", "g4"},
+    {"6k1/1b1nqpbp/pp4p1/5P2/1PN5/4Q3/P5PP/1B2B1K1 b - - 0 1", "Bd4"},
+    {"3R1rk1/8/5Qpp/2p5/2P1p1q1/P3P3/1P2PK2/8 b - - 0 1", "Qh4+"},
+  };
+  const int TACTICAL_SUITE_COUNT = sizeof(TACTICAL_SUITE) / sizeof(TACTICAL_SUITE[0]);
+
+  /** Searches every bench position with one ordering configuration and prints a summary row. */
+  void runOrderingBench(const char* name, const OrderingOptions & options, const int depth) {
+    uint64_t totalNodes = 0, cutoffs = 0, firstMoveCutoffs = 0;
+    double branchingSum = 0.0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      ChessBoard board;
+      board.setFen(BENCH_FENS[i]);
+      Search search(board);
+      search.setOrderingOptions(options);
+      search.searchDepth(depth);
+
+      const SearchStats & stats = search.getStats();
+      totalNodes += stats.nodes;
+      cutoffs += stats.betaCutoffs;
+      firstMoveCutoffs += stats.firstMoveCutoffs;
+      branchingSum += stats.effectiveBranchingFactor();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-22s %12llu %8.2f %9.1f%% %10.0f\n", name, static_cast<unsigned long long>(totalNodes),
+	   branchingSum / BENCH_FEN_COUNT, cutoffs == 0 ? 0.0 : 100.0 * firstMoveCutoffs / cutoffs,
+	   seconds > 0 ? totalNodes / seconds : 0.0);
+  }
+
+  /** Compares move ordering heuristics on the bench positions. */
+  void orderingBench(const int depth) {
+    printf("Move ordering, depth %d, %d positions\n", depth, BENCH_FEN_COUNT);
+    printf("%-22s %12s %8s %10s %10s\n", "ordering", "nodes", "EBF", "1st-cut", "nps");
+
+    OrderingOptions none;
+    none.hashMove = none.mvvLva = none.killers = none.history = false;
+    runOrderingBench("none", none, depth);
+
+    OrderingOptions hashOnly = none;
+    hashOnly.hashMove = true;
+    runOrderingBench("hash", hashOnly, depth);
+
+    OrderingOptions captures = hashOnly;
+    captures.mvvLva = true;
+    runOrderingBench("hash+mvv-lva", captures, depth);
+
+    OrderingOptions killers = captures;
+    killers.killers = true;
+    runOrderingBench("hash+mvv-lva+killers", killers, depth);
+
+    runOrderingBench("all", OrderingOptions(), depth);
+  }
+
+  /** Prints the rate of an operation repeated count times since start. */
+  void printRate(const char* name, const long count, const std::chrono::steady_clock::time_point start) {
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %10.2f M/s\n", name, seconds > 0 ? count / seconds / 1e6 : 0.0);
+  }
+
+  /** Malformed FEN strings with the error parseFen() must report for each. */
+  struct MalformedFen {
+    const char* fen;
+    FenError error;
+  };
+  const MalformedFen MALFORMED_FENS[] = {
+    {"", FenEmpty},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNX w KQkq - 0 1", FenBadPiece},
+    {"rnbqkbnr/pppppppp/7/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenBadRankLength},
+    {"rnbqkbnr/pppppppp/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenBadRankCount},
+    {"rnbqqbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", FenBadKingCount},
+    {"rnbqkbnP/pppppppp/8/8/8/8/PPPPPPP1/RNBQKBNR w KQkq - 0 1", FenBadPawnRank},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1", FenBadSideToMove},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkqK - 0 1", FenBadCastling},
+    // Rights without the king and rooks on their starting squares
+    {"4k3/8/8/8/8/8/8/4K3 w KQkq - 0 1", FenBadCastling},
+    {"r3k2r/8/8/8/8/8/8/R4K1R w KQkq - 0 1", FenBadCastling},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e3 0 1", FenBadEnPassant},
+    // An en passant square with no enemy pawn behind it, or with the squares it crossed taken
+    {"4k3/8/8/3NP3/8/8/8/4K3 w - d6 0 1", FenBadEnPassant},
+    {"4k3/3n4/8/3pP3/8/8/8/4K3 w - d6 0 1", FenBadEnPassant},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - x 1", FenBadHalfmoveClock},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 0", FenBadFullmoveNumber},
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 x", FenTrailingCharacters},
+  };
+  const int MALFORMED_FEN_COUNT = sizeof(MALFORMED_FENS) / sizeof(MALFORMED_FENS[0]);
+
+  /** Measures FEN import and export throughput over the bench positions. */
+  void fenBench(const long count) {
+    printf("FEN throughput, %ld operations each\n", count);
+
+    // Round trip check first, every bench position must come back unchanged
+    ChessBoard board;
+    char fen[MAX_FEN_LENGTH];
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      board.setFen(BENCH_FENS[i]);
+      board.toFen(fen);
+      if (strcmp(fen, BENCH_FENS[i]) != 0) {
+	printf("Round trip mismatch:\n  %s\n  %s\n", BENCH_FENS[i], fen);
+      }
+    }
+
+    // Every malformed string must be refused with its own error
+    FenPosition position;
+    for (int i = 0; i < MALFORMED_FEN_COUNT; i++) {
+      FenError error = parseFen(MALFORMED_FENS[i].fen, position);
+      if (error != MALFORMED_FENS[i].error) {
+	printf("Malformed FEN \"%s\": %s, expected %s\n", MALFORMED_FENS[i].fen, fenErrorString(error),
+	       fenErrorString(MALFORMED_FENS[i].error));
+      }
+    }
+
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += parseFen(BENCH_FENS[n % BENCH_FEN_COUNT], position) + position.halfmoveClock;
+    }
+    printRate("parseFen", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += writeFen(position, fen);
+    }
+    printRate("writeFen", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += board.setFen(BENCH_FENS[n % BENCH_FEN_COUNT]);
+    }
+    printRate("ChessBoard::setFen", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += board.toFen(fen);
+    }
+    printRate("ChessBoard::toFen", count, start);
+
+    // Keeps the loops from being optimised away
+    printf("(checksum %ld)\n", checksum);
+  }
+
+  /** Plays engine against engine from each bench position and measures the first engine's
+   *  reply latency, i.e. the time from the opponent's move to its own.
+   *  @return The average latency in milliseconds.
+   */
+  double runPonderGames(const bool ponder, const int moveTimeMs, const int plies, PonderStats & stats,
+			int & historyMismatches) {
+    SearchLimits limits;
+    limits.moveTimeMs = moveTimeMs;
+    double totalMs = 0.0;
+    int replies = 0;
+
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      Engine engines[2];
+      engines[0].setPosition(BENCH_FENS[i]);
+      engines[1].setPosition(BENCH_FENS[i]);
+      for (int ply = 0; ply < plies; ply++) {
+	Engine & mover = engines[ply % 2];
+	auto start = std::chrono::steady_clock::now();
+	SearchResult result = mover.think(limits);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (result.bestMove.isNull()) {
+	  break;
+	}
+	if (ply % 2 == 0) {
+	  totalMs += ms;
+	  replies++;
+	  // think() has resolved any ponder search, so the first engine's board is free again and
+	  // its game history must hold the same moves as the second's
+	  const GameHistory & history = engines[0].getBoard().getHistory();
+	  const GameHistory & expected = engines[1].getBoard().getHistory();
+	  if (history.getLength() != expected.getLength() || history.getCursor() != expected.getCursor() ||
+	      history.getHashKey(history.getCursor()) != expected.getHashKey(expected.getCursor())) {
+	    historyMismatches++;
+	  }
+	}
+	engines[0].playMove(result.bestMove);
+	engines[1].playMove(result.bestMove);
+	if (ply % 2 == 0 && ponder) {
+	  engines[0].startPondering(limits);
+	}
+	// The second engine never ponders, so its board is safe to look at
+	if (engines[1].getBoard().isDrawByRule()) {
+	  break;
+	}
+      }
+      stats.hits += engines[0].getPonderStats().hits;
+      stats.misses += engines[0].getPonderStats().misses;
+      if (engines[0].getPonderStats().maxAbortMicros > stats.maxAbortMicros) {
+	stats.maxAbortMicros = engines[0].getPonderStats().maxAbortMicros;
+      }
+    }
+    return replies == 0 ? 0.0 : totalMs / replies;
+  }
+
+  /** Compares the reply latency of an engine with and without pondering. */
+  void ponderBench(const int moveTimeMs, const int plies) {
+    printf("Pondering, %d ms per move, %d plies from %d positions\n", moveTimeMs, plies, BENCH_FEN_COUNT);
+
+    PonderStats off, on;
+    int historyMismatches = 0;
+    double offMs = runPonderGames(false, moveTimeMs, plies, off, historyMismatches);
+    double onMs = runPonderGames(true, moveTimeMs, plies, on, historyMismatches);
+    int guesses = on.hits + on.misses;
+
+    printf("%-28s %10.2f ms\n", "average reply, no ponder", offMs);
+    printf("%-28s %10.2f ms\n", "average reply, ponder", onMs);
+    printf("%-28s %10d / %d\n", "ponder hits", on.hits, guesses);
+    printf("%-28s %10.1f us\n", "slowest miss abort", on.maxAbortMicros);
+    printf("%-28s %10d\n", "game history mismatches", historyMismatches);
+  }
+
+  /** Plays a game of random legal moves and appends the key of every position. */
+  void randomGameKeys(uint64_t seed, const int plies, std::vector<uint64_t> & keys) {
+    ChessBoard board;
+    board.setFen(START_FEN);
+    MoveList moves;
+    keys.push_back(board.getHashKey());
+    for (int ply = 0; ply < plies; ply++) {
+      board.generateLegalMoves(moves);
+      if (moves.empty()) {
+	break;
+      }
+      // xorshift64, so every run plays the same games
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      board.makeMove(moves[seed % moves.size()]);
+      keys.push_back(board.getHashKey());
+    }
+  }
+
+  /** Inserts each thread's keys into its own index, or into the first one if there is one index.
+   *  Reports the positions a full index could not count.
+   */
+  double insertKeys(std::vector<PositionIndex*> & indexes, const std::vector<std::vector<uint64_t>> & keys) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    std::atomic<size_t> failed{0};
+    for (size_t t = 0; t < keys.size(); t++) {
+      PositionIndex* index = indexes[indexes.size() == 1 ? 0 : t];
+      threads.emplace_back([index, &keys, &failed, t]() {
+	for (uint64_t key : keys[t]) {
+	  if (index->insert(key) == 0) {
+	    failed.fetch_add(1, std::memory_order_relaxed);
+	  }
+	}
+      });
+    }
+    for (std::thread & thread : threads) {
+      thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (failed.load() > 0) {
+      printf("error: %zu positions not counted, the index is full. Its capacity of %zu slots is fixed\n"
+	     "       when it is created and it cannot grow, so create it larger.\n", failed.load(),
+	     indexes[0]->capacity());
+    }
+    return seconds;
+  }
+
+  /** Measures the position index on the positions of random games. */
+  void indexBench(const int games, const int threadCount) {
+    const int plies = 80;
+    const size_t capacity = 1 << 22;
+    std::vector<std::vector<uint64_t>> keys(threadCount);
+    size_t total = 0;
+    for (int game = 0; game < games; game++) {
+      randomGameKeys(0x9E3779B97F4A7C15ULL * (game + 1), plies, keys[game % threadCount]);
+    }
+    for (const std::vector<uint64_t> & threadKeys : keys) {
+      total += threadKeys.size();
+    }
+    printf("Position index, %zu positions from %d random games, %d threads\n", total, games, threadCount);
+
+    // Baseline: a node based hash map on one thread
+    std::unordered_map<uint64_t, uint32_t> map;
+    auto start = std::chrono::steady_clock::now();
+    for (const std::vector<uint64_t> & threadKeys : keys) {
+      for (uint64_t key : threadKeys) {
+	map[key]++;
+      }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %10.2f M/s %10zu distinct\n", "unordered_map, 1 thread", total / seconds / 1e6, map.size());
+
+    PositionIndex shared(capacity);
+    std::vector<PositionIndex*> sharedList = {&shared};
+    seconds = insertKeys(sharedList, keys);
+    printf("%-28s %10.2f M/s %10zu distinct, %.1f bytes each (%zu MB table)\n", "shared index", total / seconds / 1e6,
+	   shared.size(), static_cast<double>(shared.memoryBytes()) / shared.size(), shared.memoryBytes() >> 20);
+
+    // Sharded build: one index per thread, merged afterwards
+    std::vector<PositionIndex*> shards;
+    for (int t = 0; t < threadCount; t++) {
+      shards.push_back(new PositionIndex(capacity));
+    }
+    seconds = insertKeys(shards, keys);
+    PositionIndex merged(capacity);
+    start = std::chrono::steady_clock::now();
+    for (PositionIndex* shard : shards) {
+      merged.merge(*shard);
+      delete shard;
+    }
+    double mergeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %10.2f M/s %10zu distinct, merge %.3fs\n", "sharded index", total / seconds / 1e6,
+	   merged.size(), mergeSeconds);
+
+    // File backed, reopened with its counts
+    const char* path = "/tmp/bench_positions.idx";
+    size_t fileSize = 0;
+    {
+      PositionIndex onFile(capacity, path);
+      std::vector<PositionIndex*> fileList = {&onFile};
+      seconds = insertKeys(fileList, keys);
+      onFile.sync();
+      printf("%-28s %10.2f M/s %10zu distinct\n", "file backed index", total / seconds / 1e6, onFile.size());
+    }
+    PositionIndex reopened(capacity, path);
+    fileSize = reopened.size();
+    // A different capacity must not wipe the file, it is reopened at its own size
+    PositionIndex resized(capacity / 2, path);
+    if (!resized.isOpen() || resized.capacity() != reopened.capacity()) {
+      printf("error: reopening the file with another capacity did not keep its size\n");
+    }
+    unlink(path);
+
+    // Every index must agree with the baseline counts
+    size_t mismatches = 0;
+    for (const auto & entry : map) {
+      mismatches += shared.lookup(entry.first) != entry.second;
+      mismatches += merged.lookup(entry.first) != entry.second;
+      mismatches += reopened.lookup(entry.first) != entry.second;
+      mismatches += resized.lookup(entry.first) != entry.second;
+    }
+    printf("reopened file %zu distinct, start position seen %u times, %zu count mismatches\n", fileSize,
+	   shared.lookup(keys[0][0]), mismatches);
+  }
+
+  /** Measures the packed position format against FEN, and the streaming writer and reader. */
+  void packedBench(const long count) {
+    printf("Packed positions (%d bytes), %ld operations each\n", PACKED_POSITION_SIZE, count);
+
+    // Round trip check first, every bench position must come back unchanged
+    ChessBoard board;
+    FenPosition position;
+    PackedPosition packed[BENCH_FEN_COUNT];
+    char fen[MAX_FEN_LENGTH];
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      parseFen(BENCH_FENS[i], position);
+      if (!packPosition(position, packed[i]) || unpackPosition(packed[i], position) != FenOk ||
+	  (writeFen(position, fen), strcmp(fen, BENCH_FENS[i]) != 0)) {
+	printf("Round trip mismatch: %s\n", BENCH_FENS[i]);
+      }
+    }
+    // A FEN may have more pieces than the format holds, the writer must refuse it
+    const char* crowded = "rnbqkbnr/pppppppp/8/8/8/P7/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+    FILE* refused = tmpfile();
+    {
+      PackedWriter writer(refused);
+      if (board.setFen(crowded) != FenOk || writer.write(board)) {
+	printf("33 pieces not refused: %s\n", crowded);
+      }
+    }
+    fclose(refused);
+
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += unpackPosition(packed[n % BENCH_FEN_COUNT], position) + position.halfmoveClock;
+    }
+    printRate("unpackPosition", count, start);
+
+    PackedPosition scratch;
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      packPosition(position, scratch);
+      checksum += scratch.bytes[24];
+    }
+    printRate("packPosition", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += parseFen(BENCH_FENS[n % BENCH_FEN_COUNT], position) + position.halfmoveClock;
+    }
+    printRate("parseFen", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      unpackPosition(packed[n % BENCH_FEN_COUNT], position);
+      board.setPosition(position);
+      checksum += board.getHalfmoveClock();
+    }
+    printRate("unpack + setPosition", count, start);
+
+    // setFen() is loadState() without the messages
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += board.setFen(BENCH_FENS[n % BENCH_FEN_COUNT]);
+    }
+    printRate("setFen (loadState)", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      board.getPosition(position);
+      packPosition(position, scratch);
+      checksum += scratch.bytes[24];
+    }
+    printRate("getPosition + pack", count, start);
+
+    start = std::chrono::steady_clock::now();
+    for (long n = 0; n < count; n++) {
+      checksum += board.toFen(fen);
+    }
+    printRate("toFen", count, start);
+
+    // Streaming: the positions of random games, written and read back with each block format
+    std::vector<PackedPosition> positions;
+    for (int game = 0; static_cast<long>(positions.size()) < count; game++) {
+      board.setFen(START_FEN);
+      MoveList moves;
+      uint64_t seed = 0x9E3779B97F4A7C15ULL * (game + 1);
+      for (int ply = 0; ply < 80; ply++) {
+	PackedPosition current;
+	board.getPosition(position);
+	packPosition(position, current);
+	positions.push_back(current);
+	board.generateLegalMoves(moves);
+	if (moves.empty()) {
+	  break;
+	}
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	board.makeMove(moves[seed % moves.size()]);
+      }
+    }
+    for (int compress = 0; compress < 2; compress++) {
+      FILE* file = tmpfile();
+      start = std::chrono::steady_clock::now();
+      uint64_t bytes;
+      {
+	PackedWriter writer(file, compress);
+	for (const PackedPosition & p : positions) {
+	  writer.write(p);
+	}
+	writer.flush();
+	bytes = writer.getBytesWritten();
+      }
+      fflush(file);
+      double writeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      rewind(file);
+      start = std::chrono::steady_clock::now();
+      PackedReader reader(file);
+      size_t read = 0, mismatches = 0;
+      PackedPosition p;
+      while (reader.read(p)) {
+	mismatches += memcmp(p.bytes, positions[read].bytes, PACKED_POSITION_SIZE) != 0;
+	read++;
+      }
+      double readSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      fclose(file);
+      printf("%-28s %6.2f bytes/position, write %.1f M/s, read %.1f M/s, %zu read, %zu mismatches\n",
+	     compress ? "stream, compressed" : "stream, raw", static_cast<double>(bytes) / positions.size(),
+	     positions.size() / writeSeconds / 1e6, positions.size() / readSeconds / 1e6, read, mismatches);
+    }
+
+    // Keeps the loops from being optimised away
+    printf("(checksum %ld)\n", checksum);
+  }
+
+  /** Measures the memory each live game costs: the board itself plus whatever it allocates,
+   *  taken from the allocator's count of bytes in use. Also times loading and playing out games.
+   */
+  void memoryBench(const int games) {
+    printf("Memory per live game, %d games\n", games);
+    std::vector<std::unique_ptr<ChessBoard>> boards;
+    boards.reserve(games);
+    size_t before = mallinfo2().uordblks;
+    auto start = std::chrono::steady_clock::now();
+    for (int game = 0; game < games; game++) {
+      boards.emplace_back(new ChessBoard());
+      boards.back()->setFen(BENCH_FENS[game % BENCH_FEN_COUNT]);
+    }
+    printRate("new board + setFen", games, start);
+    size_t after = mallinfo2().uordblks;
+    printf("sizeof(ChessBoard) %zu bytes, %.1f bytes per live game including the heap\n", sizeof(ChessBoard),
+	   static_cast<double>(after - before) / games);
+
+    // Random playouts touch every square access path, captures and promotions included
+    MoveList moves;
+    long plies = 0;
+    start = std::chrono::steady_clock::now();
+    for (int game = 0; game < games; game++) {
+      ChessBoard & board = *boards[game];
+      uint64_t seed = 0x9E3779B97F4A7C15ULL * (game + 1);
+      for (int ply = 0; ply < 60 && !board.isDrawByRule(); ply++, plies++) {
+	board.generateLegalMoves(moves);
+	if (moves.empty()) {
+	  break;
+	}
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	board.makeMove(moves[seed % moves.size()]);
+      }
+    }
+    printRate("random playout plies", plies, start);
+    printf("%.1f bytes per live game after the playouts\n",
+	   static_cast<double>(mallinfo2().uordblks - before) / games);
+  }
+
+  /** Checks lastMoveGivesCheck() against the full board scan on random games, and times both. */
+  void checksBench(const int games) {
+    printf("Check detection on %d random games\n", games);
+    MoveList moves;
+    long plies = 0, checks = 0, mismatches = 0, castles = 0, enPassants = 0, promotions = 0;
+    long checkingMoves = 0, generatorMismatches = 0;
+    double incrementalSeconds = 0, scanSeconds = 0, generatorSeconds = 0, filterSeconds = 0;
+    MoveList generated, filtered;
+    ChessBoard board;
+    for (int game = 0; game < games; game++) {
+      board.setFen(BENCH_FENS[game % BENCH_FEN_COUNT]);
+      uint64_t seed = 0x9E3779B97F4A7C15ULL * (game + 1);
+      for (int ply = 0; ply < 200 && !board.isDrawByRule(); ply++, plies++) {
+	board.generateLegalMoves(moves);
+	if (moves.empty()) {
+	  break;
+	}
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	Move move = moves[seed % moves.size()];
+	castles += move.flag() == FlagCastle;
+	enPassants += move.flag() == FlagEnPassant;
+	promotions += move.isPromotion();
+	board.makeMove(move);
+
+	auto start = std::chrono::steady_clock::now();
+	bool incremental = board.lastMoveGivesCheck(move);
+	auto middle = std::chrono::steady_clock::now();
+	bool scan = board.isSideToMoveInCheck();
+	auto end = std::chrono::steady_clock::now();
+	incrementalSeconds += std::chrono::duration<double>(middle - start).count();
+	scanSeconds += std::chrono::duration<double>(end - middle).count();
+	checks += scan;
+	if (incremental != scan) {
+	  char fen[MAX_FEN_LENGTH], text[6];
+	  board.toFen(fen);
+	  move.toString(text);
+	  printf("Mismatch after %s: %s\n", text, fen);
+	  mismatches++;
+	}
+
+	// The checking moves of the next player, generated against filtered from all legal moves
+	start = std::chrono::steady_clock::now();
+	board.generateCheckingMoves(generated);
+	middle = std::chrono::steady_clock::now();
+	board.generateLegalMoves(moves);
+	filtered.clear();
+	for (const Move & reply : moves) {
+	  MoveUndo undo;
+	  board.doMove(reply, undo);
+	  if (board.isSideToMoveInCheck()) {
+	    filtered.add(reply);
+	  }
+	  board.undoMove(reply, undo);
+	}
+	end = std::chrono::steady_clock::now();
+	generatorSeconds += std::chrono::duration<double>(middle - start).count();
+	filterSeconds += std::chrono::duration<double>(end - middle).count();
+	checkingMoves += filtered.size();
+	bool same = generated.size() == filtered.size();
+	for (int i = 0; same && i < generated.size(); i++) {
+	  same = filtered.contains(generated[i]);
+	}
+	if (!same) {
+	  char fen[MAX_FEN_LENGTH];
+	  board.toFen(fen);
+	  printf("Checking moves mismatch (%d generated, %d filtered): %s\n", generated.size(), filtered.size(), fen);
+	  generatorMismatches++;
+	}
+      }
+    }
+    printf("%ld plies, %ld checks, %ld castles, %ld en passant, %ld promotions, %ld mismatches\n",
+	   plies, checks, castles, enPassants, promotions, mismatches);
+    printf("%-28s %10.1f ns/move\n", "lastMoveGivesCheck", incrementalSeconds / plies * 1e9);
+    printf("%-28s %10.1f ns/move\n", "isSideToMoveInCheck", scanSeconds / plies * 1e9);
+    printf("%ld checking moves, %ld generator mismatches\n", checkingMoves, generatorMismatches);
+    printf("%-28s %10.1f ns/position\n", "generateCheckingMoves", generatorSeconds / plies * 1e9);
+    printf("%-28s %10.1f ns/position\n", "legal moves + check filter", filterSeconds / plies * 1e9);
+  }
+
+  /** Prints the lines of a MultiPV analysis as it deepens, then how the node count grows with
+   *  the number of lines, against searching each line from scratch.
+   */
+  void multiPVBench(const int depth, const int lineCount) {
+    printf("MultiPV analysis, depth %d, %d lines\n", depth, lineCount);
+    {
+      ChessBoard board;
+      board.setFen(BENCH_FENS[1]);
+      Search search(board);
+      search.setIterationCallback([](const SearchResult & result) {
+	for (int line = 0; line < result.lineCount; line++) {
+	  printf("depth %2d line %d score %6d pv", result.depth, line + 1, result.lines[line].score);
+	  for (int i = 0; i < result.lines[line].pvLength; i++) {
+	    char text[6];
+	    result.lines[line].pv[i].toString(text);
+	    printf(" %s", text);
+	  }
+	  printf("\n");
+	}
+      });
+      SearchLimits limits;
+      limits.depth = depth;
+      limits.multiPV = lineCount;
+      search.search(limits);
+    }
+
+    printf("%-6s %12s %10s %10s\n", "lines", "nodes", "x 1 line", "seconds");
+    uint64_t singleNodes = 0;
+    for (int lines = 1; lines <= lineCount; lines++) {
+      uint64_t nodes = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+	ChessBoard board;
+	board.setFen(BENCH_FENS[i]);
+	Search search(board);
+	SearchLimits limits;
+	limits.depth = depth;
+	limits.multiPV = lines;
+	search.search(limits);
+	nodes += search.getStats().nodes;
+      }
+      if (lines == 1) {
+	singleNodes = nodes;
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-6d %12llu %10.2f %10.2f\n", lines, static_cast<unsigned long long>(nodes),
+	     static_cast<double>(nodes) / singleNodes, seconds);
+    }
+  }
+
+  /** Checks the network's incremental accumulators against computing them from scratch, and
+   *  the vector kernels against plain loops, on random games. Then times the network against the
+   *  handcrafted evaluation. Without a file the network built from the material values is used,
+   *  after a round trip through a network file.
+   */
+  void nnueBench(const char* path, const int games) {
+    std::unique_ptr<Network> network(new Network());
+    bool material = path == nullptr;
+    if (material) {
+      network->setFromMaterial();
+      char name[] = "/tmp/networkXXXXXX";
+      int fd = mkstemp(name);
+      std::unique_ptr<Network> loaded(new Network());
+      bool roundTrip = fd >= 0 && network->save(name) && loaded->load(name) &&
+	memcmp(static_cast<void*>(loaded.get()), static_cast<void*>(network.get()), sizeof(Network)) == 0;
+      if (fd >= 0) {
+	close(fd);
+	unlink(name);
+      }
+      printf("Material network, file round trip %s\n", roundTrip ? "ok" : "FAILED");
+    } else if (!network->load(path)) {
+      printf("Cannot load network %s\n", path);
+      return;
+    } else {
+      printf("Network %s\n", path);
+    }
+    printf("%s kernels, %d random games\n", Network::kernelName(), games);
+
+    // Every legal move of every position is made and taken back, the accumulators must match a
+    // refresh after both
+    ChessBoard board, fresh;
+    board.setNetwork(network.get());
+    fresh.setNetwork(network.get());
+    std::vector<FenPosition> positions;
+    MoveList moves;
+    long moveChecks = 0, accumulatorMismatches = 0, kernelMismatches = 0, materialError = 0, worstError = 0;
+    // Loading the position on another board computes its accumulators from scratch
+    auto matchesRefresh = [&]() {
+      FenPosition position;
+      board.getPosition(position);
+      fresh.setPosition(position);
+      const Accumulator & incremental = board.getAccumulator();
+      const Accumulator & expected = fresh.getAccumulator();
+      return memcmp(incremental.values, expected.values, sizeof(expected.values)) == 0 &&
+	incremental.kingSquares[White] == expected.kingSquares[White] &&
+	incremental.kingSquares[Black] == expected.kingSquares[Black];
+    };
+    for (int game = 0; game < games; game++) {
+      board.setFen(BENCH_FENS[game % BENCH_FEN_COUNT]);
+      uint64_t seed = 0x9E3779B97F4A7C15ULL * (game + 1);
+      for (int ply = 0; ply < 200 && !board.isDrawByRule(); ply++) {
+	board.generateLegalMoves(moves);
+	if (moves.empty()) {
+	  break;
+	}
+	positions.emplace_back();
+	board.getPosition(positions.back());
+	for (int i = 0; i < moves.size(); i++) {
+	  MoveUndo undo;
+	  board.doMove(moves[i], undo);
+	  accumulatorMismatches += !matchesRefresh();
+	  board.undoMove(moves[i], undo);
+	  moveChecks++;
+	}
+	accumulatorMismatches += !matchesRefresh();
+	int score = board.evaluateNetwork();
+	kernelMismatches += score != network->evaluateScalar(board.getAccumulator(), board.getSideToMove());
+	if (material) {
+	  long error = labs(score - evaluateMaterial(board));
+	  materialError += error;
+	  worstError = error > worstError ? error : worstError;
+	}
+
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	board.makeMove(moves[seed % moves.size()]);
+      }
+    }
+    printf("%zu positions, %ld moves made and taken back, %ld accumulator mismatches, %ld kernel mismatches\n",
+	   positions.size(), moveChecks, accumulatorMismatches, kernelMismatches);
+    if (material) {
+      printf("Against evaluateMaterial(): mean error %.2f cp, worst %ld cp\n",
+	     static_cast<double>(materialError) / positions.size(), worstError);
+    }
+
+    // Each position is evaluated REPEATS times in a row, so loading it is not timed
+    const int REPEATS = 64;
+    double handcraftedSeconds = 0, networkSeconds = 0, scalarSeconds = 0, refreshSeconds = 0;
+    long checksum = 0;
+    for (const FenPosition & position : positions) {
+      board.setPosition(position);
+      auto start = std::chrono::steady_clock::now();
+      for (int r = 0; r < REPEATS; r++) {
+	checksum += evaluate(board);
+      }
+      auto handcrafted = std::chrono::steady_clock::now();
+      for (int r = 0; r < REPEATS; r++) {
+	checksum += board.evaluateNetwork();
+      }
+      auto incremental = std::chrono::steady_clock::now();
+      for (int r = 0; r < REPEATS; r++) {
+	checksum += network->evaluateScalar(board.getAccumulator(), board.getSideToMove());
+      }
+      auto scalar = std::chrono::steady_clock::now();
+      for (int r = 0; r < REPEATS; r++) {
+	// Attaching the network again computes both accumulators from scratch
+	board.setNetwork(network.get());
+	checksum += board.evaluateNetwork();
+      }
+      auto end = std::chrono::steady_clock::now();
+      handcraftedSeconds += std::chrono::duration<double>(handcrafted - start).count();
+      networkSeconds += std::chrono::duration<double>(incremental - handcrafted).count();
+      scalarSeconds += std::chrono::duration<double>(scalar - incremental).count();
+      refreshSeconds += std::chrono::duration<double>(end - scalar).count();
+    }
+    double evaluations = static_cast<double>(positions.size()) * REPEATS;
+    printf("%-36s %10.2f M evals/s\n", "handcrafted evaluate()", evaluations / handcraftedSeconds / 1e6);
+    printf("%-36s %10.2f M evals/s\n", "network, accumulators up to date", evaluations / networkSeconds / 1e6);
+    printf("%-36s %10.2f M evals/s\n", "network, plain loops", evaluations / scalarSeconds / 1e6);
+    printf("%-36s %10.2f M evals/s\n", "network, accumulators from scratch", evaluations / refreshSeconds / 1e6);
+    printf("(checksum %ld)\n", checksum);
+
+    // In a search every move also pays for its accumulator update
+    for (int withNetwork = 0; withNetwork < 2; withNetwork++) {
+      uint64_t nodes = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+	ChessBoard searched;
+	searched.setFen(BENCH_FENS[i]);
+	if (withNetwork) {
+	  searched.setNetwork(network.get());
+	}
+	Search search(searched);
+	search.setUseNetwork(withNetwork);
+	search.searchDepth(5);
+	nodes += search.getStats().nodes;
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-36s %10.2f M nodes/s\n", withNetwork ? "depth 5 search, network" : "depth 5 search, handcrafted",
+	     nodes / seconds / 1e6);
+    }
+  }
+
+  /** Checks if a move is one of a space separated list of SAN moves. */
+  bool isListedMove(ChessBoard & board, const char* list, const Move & move) {
+    char san[MAX_SAN_LENGTH];
+    while (*list != '\0') {
+      int length = 0;
+      while (*list != '\0' && *list != ' ' && length < MAX_SAN_LENGTH - 1) {
+	san[length++] = *list++;
+      }
+      san[length] = '\0';
+      while (*list == ' ') {
+	list++;
+      }
+      if (sanToMove(board, san) == move) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  /** Searches the tactical suite and the bench positions with one search configuration and
+   *  prints a summary row.
+   */
+  void runQuiescenceBench(const char* name, const SearchOptions & options, const int depth) {
+    uint64_t nodes = 0, quiescenceNodes = 0, seePruned = 0;
+    int solved = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TACTICAL_SUITE_COUNT; i++) {
+      ChessBoard board;
+      board.setFen(TACTICAL_SUITE[i].fen);
+      Search search(board);
+      search.setSearchOptions(options);
+      Move best = search.searchDepth(depth).bestMove;
+      solved += isListedMove(board, TACTICAL_SUITE[i].bestMoves, best);
+      nodes += search.getStats().nodes;
+      quiescenceNodes += search.getStats().quiescenceNodes;
+      seePruned += search.getStats().seePruned;
+    }
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      ChessBoard board;
+      board.setFen(BENCH_FENS[i]);
+      Search search(board);
+      search.setSearchOptions(options);
+      search.searchDepth(depth);
+      nodes += search.getStats().nodes;
+      quiescenceNodes += search.getStats().quiescenceNodes;
+      seePruned += search.getStats().seePruned;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-22s %5d/%-3d %12llu %12llu %10llu %8.2f\n", name, solved, TACTICAL_SUITE_COUNT,
+	   static_cast<unsigned long long>(nodes), static_cast<unsigned long long>(quiescenceNodes),
+	   static_cast<unsigned long long>(seePruned), seconds);
+  }
+
+  /** Compares a fixed depth search without a quiescence search, with one and with static
+   *  exchange pruning in it, on the tactical suite and the bench positions.
+   */
+  void quiescenceBench(const int depth) {
+    printf("Quiescence search, depth %d, %d tactical and %d bench positions\n", depth, TACTICAL_SUITE_COUNT,
+	   BENCH_FEN_COUNT);
+    printf("%-22s %9s %12s %12s %10s %8s\n", "search", "solved", "nodes", "qnodes", "pruned", "seconds");
+
+    SearchOptions none;
+    none.quiescence = false;
+    none.seePruning = false;
+    runQuiescenceBench("no quiescence", none, depth);
+
+    SearchOptions noPruning;
+    noPruning.seePruning = false;
+    runQuiescenceBench("quiescence", noPruning, depth);
+
+    runQuiescenceBench("quiescence+see", SearchOptions(), depth);
+  }
+
+  /** Searches the tactical suite and the bench positions with one set of selective search
+   *  options and prints a summary row.
+   */
+  void runPruningBench(const char* name, const SearchOptions & options, const int depth) {
+    SearchStats total;
+    int solved = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < TACTICAL_SUITE_COUNT + BENCH_FEN_COUNT; i++) {
+      bool tactical = i < TACTICAL_SUITE_COUNT;
+      ChessBoard board;
+      board.setFen(tactical ? TACTICAL_SUITE[i].fen : BENCH_FENS[i - TACTICAL_SUITE_COUNT]);
+      Search search(board);
+      search.setSearchOptions(options);
+      Move best = search.searchDepth(depth).bestMove;
+      if (tactical) {
+	solved += isListedMove(board, TACTICAL_SUITE[i].bestMoves, best);
+      }
+      const SearchStats & stats = search.getStats();
+      total.nodes += stats.nodes;
+      total.nullMoveCutoffs += stats.nullMoveCutoffs;
+      total.reducedMoves += stats.reducedMoves;
+      total.futilityPruned += stats.futilityPruned;
+      total.reverseFutilityCutoffs += stats.reverseFutilityCutoffs;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-18s %5d/%-3d %12llu %10llu %10llu %10llu %10llu %8.2f\n", name, solved, TACTICAL_SUITE_COUNT,
+	   static_cast<unsigned long long>(total.nodes), static_cast<unsigned long long>(total.nullMoveCutoffs),
+	   static_cast<unsigned long long>(total.reducedMoves), static_cast<unsigned long long>(total.futilityPruned),
+	   static_cast<unsigned long long>(total.reverseFutilityCutoffs), seconds);
+  }
+
+  /** Compares a fixed depth search without selective pruning, with each kind on its own and with
+   *  all of them, on the tactical suite and the bench positions.
+   */
+  void pruningBench(const int depth) {
+    printf("Selective search, depth %d, %d tactical and %d bench positions\n", depth, TACTICAL_SUITE_COUNT,
+	   BENCH_FEN_COUNT);
+    printf("%-18s %9s %12s %10s %10s %10s %10s %8s\n", "search", "solved", "nodes", "null cuts", "reduced",
+	   "futile", "reverse", "seconds");
+    SearchOptions none;
+    none.nullMove = false;
+    none.lateMoveReductions = false;
+    none.futility = false;
+    none.reverseFutility = false;
+    runPruningBench("full width", none, depth);
+
+    SearchOptions only = none;
+    only.nullMove = true;
+    runPruningBench("null move", only, depth);
+    only = none;
+    only.lateMoveReductions = true;
+    runPruningBench("late reductions", only, depth);
+    only = none;
+    only.futility = true;
+    runPruningBench("futility", only, depth);
+    only = none;
+    only.reverseFutility = true;
+    runPruningBench("reverse futility", only, depth);
+
+    runPruningBench("all", SearchOptions(), depth);
+  }
+
+  /** Searches the bench positions and returns the nodes per second.
+   *  @param trace: Trace to record into, nullptr for none.
+   *  @param report: File to write the JSON report of each search to, nullptr for none.
+   */
+  double runStatsBench(const int depth, SearchTrace* trace, FILE* report) {
+    uint64_t nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      ChessBoard board;
+      board.setFen(BENCH_FENS[i]);
+      Search search(board);
+      search.setTrace(trace);
+      search.setReportFile(report);
+      search.searchDepth(depth);
+      nodes += search.getStats().nodes;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds > 0 ? nodes / seconds : 0.0;
+  }
+
+  /** Writes the JSON search report of every bench position to stdout, one line each, then
+   *  measures what the trace costs on stderr.
+   */
+  void statsBench(const int depth, const int traceEvents) {
+    SearchTrace trace(traceEvents > 0 ? traceEvents : 1);
+    runStatsBench(depth, traceEvents > 0 ? &trace : nullptr, stdout);
+
+    double withoutTrace = runStatsBench(depth, nullptr, nullptr);
+    double withTrace = runStatsBench(depth, &trace, nullptr);
+    fprintf(stderr, "depth %d: %.0f nodes/s without trace, %.0f with (%+.1f%%)\n", depth, withoutTrace,
+	    withTrace, withoutTrace > 0 ? 100.0 * (withTrace - withoutTrace) / withoutTrace : 0.0);
+  }
+
+  /** Plays random games and checks that seeking to any ply, undo and redo give back exactly the
+   *  positions of the game, then times random seeks against replaying every move from the start.
+   */
+  void historyBench(const int games) {
+    const int plies = 400;
+    printf("Game history, %d random games of up to %d plies, snapshot every %d plies\n", games, plies,
+	   GameHistory::DEFAULT_SNAPSHOT_INTERVAL);
+
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    long checked = 0, mismatches = 0, seeks = 0, totalPlies = 0;
+    double seekSeconds = 0.0, replaySeconds = 0.0;
+    size_t memory = 0;
+    for (int game = 0; game < games; game++) {
+      ChessBoard board;
+      board.setFen(START_FEN);
+      std::vector<std::string> fens;
+      std::vector<int> repetitions;
+      char fen[MAX_FEN_LENGTH];
+      MoveList moves;
+      for (int ply = 0; ply <= plies; ply++) {
+	board.toFen(fen);
+	fens.push_back(fen);
+	repetitions.push_back(board.getRepetitionCount());
+	board.generateLegalMoves(moves);
+	if (ply == plies || moves.empty()) {
+	  break;
+	}
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	board.makeMove(moves[seed % moves.size()]);
+      }
+      int length = board.getHistory().getLength();
+      totalPlies += length;
+      memory += board.getHistory().getMemoryBytes();
+
+      auto check = [&](const int ply) {
+	board.toFen(fen);
+	checked++;
+	if (fens[ply] != fen || board.getHashKey() != board.getHistory().getHashKey(ply) ||
+	    board.getRepetitionCount() != repetitions[ply]) {
+	  mismatches++;
+	}
+      };
+      // Every ply in a scrambled order, then all the way back and forward again
+      for (int k = 0; k <= length; k++) {
+	int ply = static_cast<int>((static_cast<uint64_t>(k) * 7919) % (length + 1));
+	board.seekGamePly(ply);
+	check(ply);
+      }
+      while (board.undoGameMove()) {
+	check(board.getHistory().getCursor());
+      }
+      while (board.redoGameMove()) {
+	check(board.getHistory().getCursor());
+      }
+
+      // Random seeks, against loading the start and replaying the moves up to the ply
+      const int seekCount = 2000;
+      std::vector<int> targets(seekCount);
+      for (int& target : targets) {
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	target = static_cast<int>(seed % (length + 1));
+      }
+      auto start = std::chrono::steady_clock::now();
+      for (int target : targets) {
+	board.seekGamePly(target);
+      }
+      seekSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      ChessBoard replay;
+      start = std::chrono::steady_clock::now();
+      for (int target : targets) {
+	replay.setFen(START_FEN);
+	for (int ply = 0; ply < target; ply++) {
+	  MoveUndo undo;
+	  replay.doMove(board.getHistory().getMove(ply), undo);
+	}
+      }
+      replaySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      seeks += seekCount;
+    }
+
+    printf("%-28s %10ld, %ld mismatches\n", "positions checked", checked, mismatches);
+    printf("%-28s %10.1f\n", "average game length", static_cast<double>(totalPlies) / games);
+    printf("%-28s %10.1f bytes\n", "history per ply", totalPlies > 0 ? static_cast<double>(memory) / totalPlies : 0.0);
+    printf("%-28s %10.2f us\n", "seek with snapshots", 1e6 * seekSeconds / seeks);
+    printf("%-28s %10.2f us\n", "replay from the start", 1e6 * replaySeconds / seeks);
+  }
+
+  /** Times the handcrafted evaluation with and without the pawn hash table, first on the
+   *  children of the positions of random games, then in searches of the bench positions.
+   */
+  void pawnHashBench(const int games, const int depth) {
+    printf("Pawn hash table, %d random games and depth %d searches\n", games, depth);
+    ChessBoard board;
+    PawnHashTable table;
+    MoveList moves;
+    long evaluations = 0, checksum = 0;
+    double directSeconds = 0, cachedSeconds = 0;
+    for (int game = 0; game < games; game++) {
+      board.setFen(BENCH_FENS[game % BENCH_FEN_COUNT]);
+      uint64_t seed = 0x9E3779B97F4A7C15ULL * (game + 1);
+      for (int ply = 0; ply < 200 && !board.isDrawByRule(); ply++) {
+	board.generateLegalMoves(moves);
+	if (moves.empty()) {
+	  break;
+	}
+	// The children are visited as a search would, three times: without evaluating them, which
+	// is taken off the other two times, evaluating them directly and through the table
+	double seconds[3];
+	for (int pass = 0; pass < 3; pass++) {
+	  auto start = std::chrono::steady_clock::now();
+	  for (int i = 0; i < moves.size(); i++) {
+	    MoveUndo undo;
+	    board.doMove(moves[i], undo);
+	    if (pass == 1) {
+	      checksum += evaluate(board);
+	    } else if (pass == 2) {
+	      checksum -= evaluate(board, &table);
+	    }
+	    board.undoMove(moves[i], undo);
+	  }
+	  seconds[pass] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	directSeconds += seconds[1] - seconds[0];
+	cachedSeconds += seconds[2] - seconds[0];
+	evaluations += moves.size();
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	board.makeMove(moves[seed % moves.size()]);
+      }
+    }
+    // Both ways give the same scores, so the checksum is 0
+    printf("%ld evaluations, pawn table hit rate %.1f%% (checksum %ld)\n", evaluations,
+	   table.getProbes() == 0 ? 0.0 : 100.0 * table.getHits() / table.getProbes(), checksum);
+    printf("%-28s %10.2f M evals/s\n", "evaluate() without table", evaluations / directSeconds / 1e6);
+    printf("%-28s %10.2f M evals/s\n", "evaluate() with table", evaluations / cachedSeconds / 1e6);
+
+    for (bool pawnHash : {false, true}) {
+      SearchOptions options;
+      options.pawnHash = pawnHash;
+      uint64_t nodes = 0, probes = 0, hits = 0;
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+	board.setFen(BENCH_FENS[i]);
+	Search search(board);
+	search.setSearchOptions(options);
+	search.searchDepth(depth);
+	nodes += search.getStats().nodes;
+	probes += search.getStats().pawnProbes;
+	hits += search.getStats().pawnHits;
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-28s %10llu nodes %8.2f s %10.0f nodes/s", pawnHash ? "search with table" : "search without table",
+	     static_cast<unsigned long long>(nodes), seconds, nodes / seconds);
+      if (pawnHash) {
+	printf(", hit rate %.1f%%", probes == 0 ? 0.0 : 100.0 * hits / probes);
+      }
+      printf("\n");
+    }
+  }
+
+  /** Counts the leaf nodes of the legal move tree, the last ply from the size of the move list. */
+  uint64_t perft(ChessBoard & board, const int depth) {
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (depth <= 1) {
+      return depth == 1 ? moves.size() : 1;
+    }
+    uint64_t nodes = 0;
+    for (int i = 0; i < moves.size(); i++) {
+      MoveUndo undo;
+      board.doMove(moves[i], undo);
+      nodes += perft(board, depth - 1);
+      board.undoMove(moves[i], undo);
+    }
+    return nodes;
+  }
+
+  /** Positions with published perft counts, deep enough that rook moves and captures take castling rights away. */
+  struct PerftPosition {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+  };
+  const PerftPosition PERFT_SUITE[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609ULL},
+    {"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", 5, 7594526ULL},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083ULL},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292ULL},
+    {"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 5, 15833292ULL},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 5, 89941194ULL},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690ULL},
+  };
+  const int PERFT_SUITE_COUNT = sizeof(PERFT_SUITE) / sizeof(PERFT_SUITE[0]);
+
+  /** Checks the move generator against the known counts of PERFT_SUITE.
+   *  @return True if every count matches.
+   */
+  bool perftCheck() {
+    printf("Perft check\n");
+    bool allMatch = true;
+    for (int i = 0; i < PERFT_SUITE_COUNT; i++) {
+      ChessBoard board;
+      board.setFen(PERFT_SUITE[i].fen);
+      uint64_t nodes = perft(board, PERFT_SUITE[i].depth);
+      bool match = nodes == PERFT_SUITE[i].nodes;
+      printf("%-72s depth %d %12llu %s\n", PERFT_SUITE[i].fen, PERFT_SUITE[i].depth,
+	     static_cast<unsigned long long>(nodes), match ? "ok" : "MISMATCH");
+      if (!match) {
+	printf("%-72s expected %12llu\n", "", static_cast<unsigned long long>(PERFT_SUITE[i].nodes));
+	allMatch = false;
+      }
+    }
+    return allMatch;
+  }
+
+  /** Times move generation with perft on the bench positions. */
+  void perftBench(const int depth) {
+    printf("Perft, depth %d\n", depth);
+    uint64_t total = 0;
+    double totalSeconds = 0;
+    for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+      ChessBoard board;
+      board.setFen(BENCH_FENS[i]);
+      auto start = std::chrono::steady_clock::now();
+      uint64_t nodes = perft(board, depth);
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-72s %12llu %8.2f s\n", BENCH_FENS[i], static_cast<unsigned long long>(nodes), seconds);
+      total += nodes;
+      totalSeconds += seconds;
+    }
+    printf("%-72s %12llu %8.2f s %10.0f nodes/s\n", "all", static_cast<unsigned long long>(total), totalSeconds,
+	   total / totalSeconds);
+  }
+
+  /** Sets up game sessions from the bench positions, each a few random plies further on. */
+  std::vector<std::unique_ptr<ChessBoard>> makeSessions(const int games) {
+    std::vector<std::unique_ptr<ChessBoard>> sessions;
+    MoveList moves;
+    for (int game = 0; game < games; game++) {
+      sessions.emplace_back(new ChessBoard());
+      ChessBoard & board = *sessions.back();
+      board.setFen(BENCH_FENS[game % BENCH_FEN_COUNT]);
+      uint64_t seed = 0x9E3779B97F4A7C15ULL * (game + 1);
+      for (int ply = 0; ply < game / BENCH_FEN_COUNT % 8; ply++) {
+	board.generateLegalMoves(moves);
+	if (moves.empty()) {
+	  break;
+	}
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	board.makeMove(moves[seed % moves.size()]);
+      }
+    }
+    return sessions;
+  }
+
+  /** Prints the mean and largest of some latencies in milliseconds. */
+  void printLatencies(const char* label, const std::vector<double> & latencies) {
+    double total = 0, largest = 0;
+    for (double latency : latencies) {
+      total += latency;
+      largest = latency > largest ? latency : largest;
+    }
+    printf("%-28s mean %8.1f ms, max %8.1f ms\n", label, latencies.empty() ? 0.0 : total / latencies.size(), largest);
+  }
+
+  /** Runs node limited searches of many game sessions one after the other, with a thread per
+   *  search and on a SearchScheduler, then with a quarter of them given a deadline.
+   */
+  void schedulerBench(const int games, const int threads, const uint64_t nodes) {
+    printf("Search scheduler, %d games of %llu nodes, %d threads, slices of %llu nodes\n", games,
+	   static_cast<unsigned long long>(nodes), threads, static_cast<unsigned long long>(SearchScheduler::DEFAULT_SLICE_NODES));
+    std::vector<std::unique_ptr<ChessBoard>> sessions = makeSessions(games);
+    SearchLimits limits;
+    limits.nodes = nodes;
+
+    // Reference results, searched one after the other
+    std::vector<SearchResult> expected(games);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < games; i++) {
+      Search search(*sessions[i], 1);
+      expected[i] = search.search(limits);
+    }
+    double sequentialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-28s %8.2f s\n", "one after the other", sequentialSeconds);
+
+    // A thread per search, as many as there are games
+    {
+      std::vector<std::unique_ptr<Search>> searches;
+      for (int i = 0; i < games; i++) {
+	searches.emplace_back(new Search(*sessions[i], 1));
+      }
+      std::vector<std::thread> searchThreads;
+      start = std::chrono::steady_clock::now();
+      for (int i = 0; i < games; i++) {
+	searchThreads.emplace_back([&searches, &limits, i]() { searches[i]->search(limits); });
+      }
+      for (std::thread & thread : searchThreads) {
+	thread.join();
+      }
+      double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      printf("%-28s %8.2f s\n", "a thread per search", seconds);
+    }
+
+    std::vector<std::unique_ptr<SearchTask>> tasks;
+    for (int i = 0; i < games; i++) {
+      tasks.emplace_back(new SearchTask(*sessions[i], 1));
+    }
+    std::vector<double> finishedMs(games);
+    SearchScheduler scheduler(threads);
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < games; i++) {
+      tasks[i]->start(limits);
+      scheduler.submit(*tasks[i], [&finishedMs, start, i](SearchTask &) {
+	finishedMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      });
+    }
+    scheduler.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    int mismatches = 0;
+    for (int i = 0; i < games; i++) {
+      const SearchResult & result = tasks[i]->getResult();
+      mismatches += result.bestMove != expected[i].bestMove || result.score != expected[i].score;
+    }
+    printf("%-28s %8.2f s, %llu slices, %d results differ\n", "scheduler", seconds,
+	   static_cast<unsigned long long>(scheduler.getSlices()), mismatches);
+    printLatencies("  latency", finishedMs);
+
+    // Every fourth game needs its move by a deadline that leaves those games twice the time
+    // they take on their own; the others have none and wait for them
+    SearchClock::time_point deadlineStart = SearchClock::now();
+    SearchClock::time_point deadline = deadlineStart +
+      std::chrono::microseconds(static_cast<int64_t>(2e6 * sequentialSeconds / 4));
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < games; i++) {
+      tasks[i]->getSearch().clear();
+      tasks[i]->start(limits, i % 4 == 0 ? deadline : SearchClock::time_point());
+      scheduler.submit(*tasks[i], [&finishedMs, start, i](SearchTask &) {
+	finishedMs[i] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      });
+    }
+    scheduler.wait();
+    std::vector<double> urgent, background;
+    int cutShort = 0;
+    for (int i = 0; i < games; i++) {
+      if (i % 4 == 0) {
+	urgent.push_back(finishedMs[i]);
+	cutShort += tasks[i]->getSearch().getStats().nodes < nodes && tasks[i]->getResult().depth < MAX_PLY;
+      } else {
+	background.push_back(finishedMs[i]);
+      }
+    }
+    printf("deadline %.1f ms for every fourth game, %d of %zu stopped by it\n",
+	   std::chrono::duration<double, std::milli>(deadline - deadlineStart).count(), cutShort, urgent.size());
+    printLatencies("  with a deadline", urgent);
+    printLatencies("  without", background);
+  }
+
+  /** Reads the anonymous memory of the process that is backed by transparent huge pages, in KB. */
+  long anonHugePagesKB() {
+    FILE* file = fopen("/proc/self/smaps_rollup", "r");
+    if (file == nullptr) {
+      return -1;
+    }
+    char line[256];
+    long kilobytes = -1;
+    while (fgets(line, sizeof(line), file) != nullptr) {
+      if (sscanf(line, "AnonHugePages: %ld", &kilobytes) == 1) {
+	break;
+      }
+    }
+    fclose(file);
+    return kilobytes;
+  }
+
+  /** Compares transposition table allocations, first with random probes of a table filled
+   *  beforehand, where the TLB misses show, then with searches of the bench positions.
+   */
+  void hugePagesBench(const int megabytes, const int depth) {
+    printf("Transposition table of %d MB, %d NUMA node(s), depth %d searches\n", megabytes, LargeMemory::nodeCount(), depth);
+    const long probes = 4000000;
+    for (HugePages pages : {HugePagesOff, HugePagesTransparent, HugePagesExplicit}) {
+      for (NumaPolicy numa : {NumaFirstTouch, NumaInterleave}) {
+	MemoryOptions memory;
+	memory.hugePages = pages;
+	memory.numa = numa;
+	TranspositionTable tt(megabytes, memory);
+	long hugeKB = anonHugePagesKB();
+	uint64_t seed = 0x9E3779B97F4A7C15ULL;
+	for (size_t i = 0; i < tt.getSize(); i++) {
+	  seed ^= seed << 13;
+	  seed ^= seed >> 7;
+	  seed ^= seed << 17;
+	  tt.store(seed, Move(), 0, 1, BoundExact);
+	}
+	hugeKB = anonHugePagesKB() - hugeKB;
+	// Random keys over the whole table, so nearly every probe misses the caches and, on 4 KB
+	// pages, the TLB as well
+	uint64_t key = 1;
+	auto start = std::chrono::steady_clock::now();
+	for (long i = 0; i < probes; i++) {
+	  key = key * 6364136223846793005ULL + 1442695040888963407ULL + (tt.probe(key) != nullptr);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%-12s %-12s %-12s %8.1f ns/probe, %6ld MB on huge pages%s\n", LargeMemory::hugePagesName(pages),
+	       numa == NumaInterleave ? "interleave" : "first touch", LargeMemory::hugePagesName(tt.getMemory().getHugePages()),
+	       1e9 * seconds / probes, hugeKB / 1024, tt.getMemory().isInterleaved() ? ", interleaved" : "");
+      }
+    }
+
+    for (HugePages pages : {HugePagesOff, HugePagesTransparent}) {
+      for (bool prefetch : {false, true}) {
+	MemoryOptions memory;
+	memory.hugePages = pages;
+	SearchOptions options;
+	options.prefetch = prefetch;
+	uint64_t nodes = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < BENCH_FEN_COUNT; i++) {
+	  ChessBoard board;
+	  board.setFen(BENCH_FENS[i]);
+	  Search search(board, megabytes, memory);
+	  search.setSearchOptions(options);
+	  search.searchDepth(depth);
+	  nodes += search.getStats().nodes;
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("search %-12s %-12s %10llu nodes %8.2f s %10.0f nodes/s\n", LargeMemory::hugePagesName(pages),
+	       prefetch ? "prefetch" : "no prefetch", static_cast<unsigned long long>(nodes), seconds, nodes / seconds);
+      }
+    }
+  }
+
+  void usage() {
+    cout << "Usage: bench ordering [depth]\n"
+	 << "       bench fen [count]\n"
+	 << "       bench ponder [movetime ms] [plies]\n"
+	 << "       bench index [games] [threads]\n"
+	 << "       bench packed [count]\n"
+	 << "       bench memory [games]\n"
+	 << "       bench checks [games]\n"
+	 << "       bench multipv [depth] [lines]\n"
+	 << "       bench nnue [network file or -] [games]\n"
+	 << "       bench quiescence [depth]\n"
+	 << "       bench stats [depth] [trace events]\n"
+	 << "       bench history [games]\n"
+	 << "       bench pawnhash [games] [depth]\n"
+	 << "       bench hugepages [megabytes] [depth]\n"
+	 << "       bench perft [depth]\n"
+	 << "       bench scheduler [games] [threads] [nodes]\n"
+	 << "       bench pruning [depth]\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  const char* mode = argc > 1 ? argv[1] : "ordering";
+
+  if (strcmp(mode, "ordering") == 0) {
+    orderingBench(argc > 2 ? atoi(argv[2]) : 4);
+  } else if (strcmp(mode, "fen") == 0) {
+    fenBench(argc > 2 ? atol(argv[2]) : 2000000);
+  } else if (strcmp(mode, "ponder") == 0) {
+    ponderBench(argc > 2 ? atoi(argv[2]) : 50, argc > 3 ? atoi(argv[3]) : 20);
+  } else if (strcmp(mode, "index") == 0) {
+    indexBench(argc > 2 ? atoi(argv[2]) : 5000, argc > 3 ? atoi(argv[3]) : 4);
+  } else if (strcmp(mode, "packed") == 0) {
+    packedBench(argc > 2 ? atol(argv[2]) : 1000000);
+  } else if (strcmp(mode, "memory") == 0) {
+    memoryBench(argc > 2 ? atoi(argv[2]) : 10000);
+  } else if (strcmp(mode, "checks") == 0) {
+    checksBench(argc > 2 ? atoi(argv[2]) : 5000);
+  } else if (strcmp(mode, "multipv") == 0) {
+    multiPVBench(argc > 2 ? atoi(argv[2]) : 5, argc > 3 ? atoi(argv[3]) : 4);
+  } else if (strcmp(mode, "quiescence") == 0) {
+    quiescenceBench(argc > 2 ? atoi(argv[2]) : 4);
+  } else if (strcmp(mode, "stats") == 0) {
+    statsBench(argc > 2 ? atoi(argv[2]) : 5, argc > 3 ? atoi(argv[3]) : 0);
+  } else if (strcmp(mode, "history") == 0) {
+    historyBench(argc > 2 ? atoi(argv[2]) : 20);
+  } else if (strcmp(mode, "pawnhash") == 0) {
+    pawnHashBench(argc > 2 ? atoi(argv[2]) : 20, argc > 3 ? atoi(argv[3]) : 6);
+  } else if (strcmp(mode, "hugepages") == 0) {
+    hugePagesBench(argc > 2 ? atoi(argv[2]) : 256, argc > 3 ? atoi(argv[3]) : 6);
+  } else if (strcmp(mode, "perft") == 0) {
+    perftBench(argc > 2 ? atoi(argv[2]) : 4);
+    if (!perftCheck()) {
+      return 1;
+    }
+  } else if (strcmp(mode, "scheduler") == 0) {
+    schedulerBench(argc > 2 ? atoi(argv[2]) : 200, argc > 3 ? atoi(argv[3]) : 1, argc > 4 ? atol(argv[4]) : 20000);
+  } else if (strcmp(mode, "pruning") == 0) {
+    pruningBench(argc > 2 ? atoi(argv[2]) : 6);
+  } else if (strcmp(mode, "nnue") == 0) {
+    nnueBench(argc > 2 && strcmp(argv[2], "-") != 0 ? argv[2] : nullptr, argc > 3 ? atoi(argv[3]) : 200);
+  } else {
+    usage();
+    return 1;
+  }
+  return 0;
+}
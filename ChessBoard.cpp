@@ -1,56 +1,83 @@
 #include"Pieces.h"
 #include"ChessBoard.h"
+#include"Zobrist.h"
+#include"AttackTables.h"
 #include<iostream>
 #include<cstring>
 #include<cctype>
 
 using namespace std;
 
-ChessBoard::ChessBoard() {
-  // Initialise an 8x8 board with all pointers set to nullptr indicating empty squares
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      piecesBoard[row][col] = nullptr;
-    }
+namespace {
+  /** The values of pieceValue() by PieceType, for staticExchange(). */
+  const int EXCHANGE_VALUES[7] = {0, 100, 320, 330, 500, 900, 20000};
+  /** Row and column steps of the lines from a square, the straight ones first. */
+  const int LINE_STEPS[8][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+
+  /** The move rules of each piece type, shared by every board. Pawns, rooks and kings have one
+   *  class per colour, reached with pawnRules<C>() and the like, the others are indexed by Colour.
+   */
+  const Pawn<White> WHITE_PAWN;
+  const Pawn<Black> BLACK_PAWN;
+  const Knight KNIGHTS[2] = {Knight(White), Knight(Black)};
+  const Bishop BISHOPS[2] = {Bishop(White), Bishop(Black)};
+  const Rook<White> WHITE_ROOK;
+  const Rook<Black> BLACK_ROOK;
+  const Queen QUEENS[2] = {Queen(White), Queen(Black)};
+  const King<White> WHITE_KING;
+  const King<Black> BLACK_KING;
+
+  template<Colour C> const Pawn<C> & pawnRules() {
+    if constexpr (C == White) return WHITE_PAWN; else return BLACK_PAWN;
   }
+  template<Colour C> const Rook<C> & rookRules() {
+    if constexpr (C == White) return WHITE_ROOK; else return BLACK_ROOK;
+  }
+  template<Colour C> const King<C> & kingRules() {
+    if constexpr (C == White) return WHITE_KING; else return BLACK_KING;
+  }
+}
+
+ChessBoard::ChessBoard() {
+  // Start with every square empty
+  clearBoard();
+  FenPosition position;
+  getPosition(position);
+  history.reset(position, hashKey);
 }
 
 void ChessBoard::clearBoard() {
-  // Loop through each square of the board and delete pieces to prevent memory leaks
-  // Set pointers to nullptr after deletion to mark the squares as empty
-  for (int row = 0; row < 8; row++) {
-    for (int col = 0; col < 8; col++) {
-      if (piecesBoard[row][col] != nullptr) {
-        delete piecesBoard[row][col];
-        piecesBoard[row][col] = nullptr;
-      }
-    }
-  }
+  memset(mailbox, 0, sizeof(mailbox));
 }
 
-ChessBoard::~ChessBoard() {
-  // Ensure all dynamic memory is cleaned up
-  clearBoard(); 
+const Pieces* ChessBoard::pieceForCode(const uint8_t code) const {
+  Colour pieceColour = pieceCodeColour(code);
+  switch (pieceCodeType(code)) {
+    case PawnType:   return pieceColour == White ? static_cast<const Pieces*>(&WHITE_PAWN) : &BLACK_PAWN;
+    case KnightType: return &KNIGHTS[pieceColour];
+    case BishopType: return &BISHOPS[pieceColour];
+    case RookType:   return pieceColour == White ? static_cast<const Pieces*>(&WHITE_ROOK) : &BLACK_ROOK;
+    case QueenType:  return &QUEENS[pieceColour];
+    case KingType:   return pieceColour == White ? static_cast<const Pieces*>(&WHITE_KING) : &BLACK_KING;
+    default :        return nullptr;
+  }
 }
 
 bool ChessBoard::canCastle(const int direction, const Colour colour) const {
-  return canCastleArray[colour == White ?
-			// If white and positive direction = whiteKingSide
-			(direction == 1 ? whiteKingSide : whiteQueenSide) :
-			// If black and positive direction = blackKingSide
-			(direction == 1 ? blackKingSide : blackQueenSide)];
+  // A positive direction is king side
+  return canCastleArray[castleIndex(colour, direction == 1)];
 }
 
 const char * ChessBoard::getPosType(const int pos[2]) const {
-   return piecesBoard[pos[0]][pos[1]]->getType();
+   return pieceAt(toSquare(pos[0], pos[1]))->getType();
 }
 
 Colour ChessBoard::getPosColour(const int pos[2]) const {
-    return piecesBoard[pos[0]][pos[1]]->getColour();
+    return pieceCodeColour(mailbox[toSquare(pos[0], pos[1])]);
 }
 
 bool ChessBoard::isPosEmpty(const int pos[2]) const {
-  return (isInsideBoard(pos[0], pos[1]) && piecesBoard[pos[0]][pos[1]] == nullptr);
+  return (isInsideBoard(pos[0], pos[1]) && mailbox[toSquare(pos[0], pos[1])] == 0);
 }
 
 void ChessBoard::rowColToString(char * square, const int pos[2]) const {
@@ -75,90 +102,244 @@ void ChessBoard::rowColToString(char * square, const int pos[2]) const {
 
 void ChessBoard::movePiece(const int sourcePos[2], const int destinationPos[2]) {
    // Check if destination square is valid and handle capture if there's an opponent's piece
+  int source = toSquare(sourcePos[0], sourcePos[1]);
+  int destination = toSquare(destinationPos[0], destinationPos[1]);
   if (isInsideBoard(destinationPos[0], destinationPos[1]) && !isPosEmpty(destinationPos)) {
-    cout << " taking " << piecesBoard[destinationPos[0]][destinationPos[1]]->getColourString()
-	 << "'s " << piecesBoard[destinationPos[0]][destinationPos[1]]->getType();
-    delete piecesBoard[destinationPos[0]][destinationPos[1]]; // Delete the captured piece
+    cout << " taking " << pieceAt(destination)->getColourString() << "'s " << pieceAt(destination)->getType();
+    togglePieceKey(destinationPos[0], destinationPos[1]);
+    if (network != nullptr) {
+      featureChanges.remove(mailbox[destination], destination);
+    }
+  }
+  togglePieceKey(sourcePos[0], sourcePos[1]);
+  // Move the piece code from the source to the destination square, overwriting a captured piece
+  mailbox[destination] = mailbox[source] | PIECE_MOVED;
+  // Set the source square to 0 to indicate it's now empty
+  mailbox[source] = 0;
+  togglePieceKey(destinationPos[0], destinationPos[1]);
+  // The king and the castling rook both come through here, so both reach the accumulators
+  if (network != nullptr) {
+    featureChanges.remove(mailbox[destination], source);
+    featureChanges.add(mailbox[destination], destination);
+  }
+}
+
+void ChessBoard::togglePieceKey(const int row, const int col) {
+  uint8_t code = mailbox[toSquare(row, col)];
+  if (code != 0) {
+    uint64_t key = Zobrist::pieceKey(Zobrist::pieceIndex(pieceCodeSymbol(code), pieceCodeColour(code)), toSquare(row, col));
+    hashKey ^= key;
+    if (pieceCodeType(code) == PawnType) {
+      pawnKey ^= key;
+    }
+  }
+}
+
+void ChessBoard::computeHashKey() {
+  hashKey = 0;
+  pawnKey = 0;
+  for (int row = 0; row < 8; row++) {
+    for (int col = 0; col < 8; col++) {
+      togglePieceKey(row, col);
+    }
+  }
+  for (int k = 0; k < 4; k++) {
+    if (canCastleArray[k]) {
+      hashKey ^= Zobrist::castleKey(k);
+    }
+  }
+  if (enPassantSquare != -1) {
+    hashKey ^= Zobrist::enPassantKey(squareCol(enPassantSquare));
+  }
+  if (colour == Black) {
+    hashKey ^= Zobrist::sideKey();
   }
-  // Move the piece pointer from the source to the destination square  
-  piecesBoard[destinationPos[0]][destinationPos[1]] = piecesBoard[sourcePos[0]][sourcePos[1]];
-  // Set the source square pointer to nullptr to indicate it's now empty
-  piecesBoard[sourcePos[0]][sourcePos[1]] = nullptr;
 }
 
 void ChessBoard::loadState(const char * fen) {
+  // Validate before anything is cleared, so a bad string keeps the current state
+  FenError error = setFen(fen);
+  if (error != FenOk) {
+    cout << "Invalid FEN string (" << fenErrorString(error) << "), the board state is unchanged.";
+    return;
+  }
   // Load a new board state from a FEN string representation
   cout << "A new board state is loaded!";
-  // Clear the current board state to ensure no residual pieces
-  clearBoard(); 
-  boardToArray(fen);
-  isGameOver = false;
   
   // Check if game over on load
-  checkGameOver();
-}
-
-void ChessBoard::boardToArray(const char * fen) {
-  int row = 0, col = 0;
-  // Index to iterate through the FEN string
-  int i = 0; 
-
-  // Process each character in the FEN string
-  while (fen[i] != ' ' && fen[i] != '\0') {
-    if (fen[i] == '/') {
-      // Move to the next row and reset column to the beginning
-      row++;
-      col = 0;
-    } else if (isdigit(fen[i])) {
-        // Handle consecutive empty squares
-        int emptySquares = fen[i] - '0';
-        for (int j = 0; j < emptySquares; j++) {
-	  // No piece in the square
-          piecesBoard[row][col++] = nullptr; 
-        }
-    } else {
-        // Create the piece object directly and place it on the board
-        Colour colour = isupper(fen[i]) ? White : Black; // If uppercase, set to White, else Black
-        piecesBoard[row][col] = PieceFactory::createPiece(tolower(fen[i]), colour, this);
-        col++;
-      }
-    i++;
+  checkGameOver(isKingInCheck(colour));
+}
+
+FenError ChessBoard::setFen(const char * fen) {
+  FenPosition position;
+  FenError error = parseFen(fen, position);
+  if (error != FenOk) {
+    return error;
   }
+  setPosition(position);
+  return FenOk;
+}
 
-  // Skip the space after the board part of FEN
-  i++;
+void ChessBoard::setPosition(const FenPosition & position) {
+  loadPosition(position);
+  history.reset(position, hashKey);
+}
 
-  // Set the colour for the next player to move
-  if (fen[i] != '\0') {
-    this->colour = (fen[i] == 'w') ? White : Black;
+void ChessBoard::loadPosition(const FenPosition & position) {
+  // Clear the current board state to ensure no residual pieces
+  clearBoard();
+  boardToArray(position);
+  computeHashKey();
+  gamePly = 0;
+  hashHistory[0] = hashKey;
+  isGameOver = false;
+  if (network != nullptr) {
+    refreshAccumulators();
   }
+}
 
-  i += 2; // Skip the "w"/"b" and white space
+void ChessBoard::recordGameMove(const Move & move) {
+  history.push(move, hashKey);
+  if (history.needsSnapshot()) {
+    FenPosition position;
+    getPosition(position);
+    history.addSnapshot(position);
+  }
+}
 
-  // Ensure castling availability to false
-  for (int k = 0; k < 4; k++) {
-    canCastleArray[k] = false;
+void ChessBoard::recordMadeMove(const Move & move, const FenPosition & position, const uint64_t positionKey) {
+  history.push(move, positionKey);
+  if (history.needsSnapshot()) {
+    history.addSnapshot(position);
+  }
+}
+
+bool ChessBoard::undoGameMove() {
+  return seekGamePly(history.getCursor() - 1);
+}
+
+bool ChessBoard::redoGameMove() {
+  return seekGamePly(history.getCursor() + 1);
+}
+
+bool ChessBoard::seekGamePly(const int ply) {
+  if (ply < 0 || ply > history.getLength()) {
+    return false;
+  }
+  FenPosition position;
+  int snapshotPly = history.getSnapshot(ply, position);
+  loadPosition(position);
+
+  // Number the plies from the game's start and restore the keys before the snapshot, so
+  // repetitions across it are still found
+  gamePly = snapshotPly;
+  int first = snapshotPly - (HASH_HISTORY_SIZE - 1) > 0 ? snapshotPly - (HASH_HISTORY_SIZE - 1) : 0;
+  for (int k = first; k <= snapshotPly; k++) {
+    hashHistory[k & (HASH_HISTORY_SIZE - 1)] = history.getHashKey(k);
+  }
+  if (network != nullptr) {
+    refreshAccumulators();
+  }
+  for (int k = snapshotPly; k < ply; k++) {
+    MoveUndo undo;
+    doMove(history.getMove(k), undo);
+  }
+  history.setCursor(ply);
+  isGameOver = history.isFinished() && ply == history.getLength();
+  return true;
+}
+
+void ChessBoard::setNetwork(const Network* _network) {
+  network = _network;
+  if (network == nullptr) {
+    accumulators.clear();
+    accumulators.shrink_to_fit();
+    return;
+  }
+  if (accumulators.empty()) {
+    accumulators.resize(ACCUMULATOR_HISTORY_SIZE);
   }
+  refreshAccumulators();
+}
 
-  // Now process the castling availability
-  if (fen[i] != ' ') {
-    // If there is no castling available, skip the loop
-    if (fen[i] == '-') {
-      i++;
+void ChessBoard::refreshAccumulators() {
+  Accumulator & current = accumulators[gamePly & (ACCUMULATOR_HISTORY_SIZE - 1)];
+  network->refresh(mailbox, White, current);
+  network->refresh(mailbox, Black, current);
+}
+
+void ChessBoard::updateAccumulators(const uint8_t movedPiece, const Move & move) {
+  const Accumulator & previous = accumulators[(gamePly - 1) & (ACCUMULATOR_HISTORY_SIZE - 1)];
+  Accumulator & current = accumulators[gamePly & (ACCUMULATOR_HISTORY_SIZE - 1)];
+  for (Colour perspective : {White, Black}) {
+    // A king that moves to another bucket changes every feature of its side's view
+    if (pieceCodeType(movedPiece) == KingType && pieceCodeColour(movedPiece) == perspective &&
+	Network::changesBucket(perspective, move.from(), move.to())) {
+      network->refresh(mailbox, perspective, current);
     } else {
-      // Otherwise, process the characters for castling availability
-      while (fen[i] != ' ' && fen[i] != '\0') {
-	switch (fen[i]) {
-        case 'K': canCastleArray[0] = true; break; // White kingside
-        case 'Q': canCastleArray[1] = true; break; // White queenside
-        case 'k': canCastleArray[2] = true; break; // Black kingside
-        case 'q': canCastleArray[3] = true; break; // Black queenside
-        default: break; // Other characters are not relevant
-	}
-	i++;
-      }
+      network->update(previous, current, perspective, featureChanges);
     }
-  }  
+  }
+}
+
+void ChessBoard::boardToArray(const FenPosition & position) {
+  for (int square = 0; square < 64; square++) {
+    char symbol = position.squares[square];
+    // Place the piece code on the board, or 0 for an empty square
+    Colour pieceColour = isupper(symbol) ? White : Black; // If uppercase, set to White, else Black
+    mailbox[square] = symbol == '\0' ? 0 : makePieceCode(symbol, pieceColour);
+  }
+  this->colour = position.sideToMove;
+  for (int k = 0; k < 4; k++) {
+    canCastleArray[k] = position.castling[k];
+  }
+  enPassantSquare = position.enPassantSquare;
+  halfmoveClock = position.halfmoveClock;
+  fullmoveNumber = position.fullmoveNumber;
+}
+
+int ChessBoard::toFen(char* fen) const {
+  FenPosition position;
+  getPosition(position);
+  return writeFen(position, fen);
+}
+
+void ChessBoard::getPosition(FenPosition & position) const {
+  for (int square = 0; square < 64; square++) {
+    position.squares[square] = getPieceSymbol(square);
+  }
+  position.sideToMove = colour;
+  for (int k = 0; k < 4; k++) {
+    position.castling[k] = canCastleArray[k];
+  }
+  position.enPassantSquare = enPassantSquare;
+  position.halfmoveClock = halfmoveClock;
+  position.fullmoveNumber = fullmoveNumber;
+}
+
+void ChessBoard::recordMove(const bool irreversible) {
+  halfmoveClock = irreversible ? 0 : halfmoveClock + 1;
+  // colour has already been switched, so Black has just moved when White is to play
+  if (colour == White) {
+    fullmoveNumber++;
+  }
+  gamePly++;
+  hashHistory[gamePly & (HASH_HISTORY_SIZE - 1)] = hashKey;
+}
+
+int ChessBoard::getRepetitionCount() const {
+  // Positions before the load or the last irreversible move cannot repeat
+  int window = halfmoveClock < gamePly ? halfmoveClock : gamePly;
+  if (window > HASH_HISTORY_SIZE - 1) {
+    window = HASH_HISTORY_SIZE - 1;
+  }
+  int count = 0;
+  for (int back = 4; back <= window; back += 2) {
+    if (hashHistory[(gamePly - back) & (HASH_HISTORY_SIZE - 1)] == hashKey) {
+      count++;
+    }
+  }
+  return count;
 }
 
 void ChessBoard::convertToRowCol(const char* square, int position[2]) const {
@@ -187,115 +368,213 @@ const char * ChessBoard::getColourString() const {
   return (colour == Black) ? "Black" : "White";
 }
 
-bool ChessBoard::isKingInCheck(const Colour kingColour) {
-  // Find king position
-  int kingPos[2];
-  for (int x = 0; x < 8; x++) {
-    for (int y = 0; y < 8; y++) {
-      int tempPos[2] = {x, y};
-      if (!isPosEmpty(tempPos) && getPosColour(tempPos) == kingColour && 
-	  strcmp(piecesBoard[x][y]->getType(), "King") == 0) {
-        kingPos[0] = x;
-        kingPos[1] = y;
-	break;
-      }
+int ChessBoard::findKing(const Colour kingColour) const {
+  uint8_t king = makePieceCode('k', kingColour);
+  for (int square = 0; square < 64; square++) {
+    if ((mailbox[square] & ~PIECE_MOVED) == king) {
+      return square;
     }
   }
+  return -1;
+}
+
+template<Colour KingColour>
+bool ChessBoard::isKingInCheckFor() {
+  // Find king position
+  int kingSquare = findKing(KingColour);
+  if (kingSquare == -1) {
+    return false;
+  }
+  int kingPos[2] = {squareRow(kingSquare), squareCol(kingSquare)};
 
-  // Expected to be overwritten
-  int currentPos[2] = {-1, -1};
-    
   // Check if any opposing piece can move to the king's position
-  for (int x = 0; x < 8; x++) {
-    for (int y = 0; y < 8; y++) {
-      if (isInsideBoard(x, y)) {
-	int tempPos[2] = {x, y};
-        // If there is an opposing piece
-        if (!isPosEmpty(tempPos) && getPosColour(tempPos) != kingColour) {
-          currentPos[0] = x;
-          currentPos[1] = y;
-          // If opposing piece can move to the King's position, they are in check
-          if (piecesBoard[x][y]->isValidMove(currentPos, kingPos)) {
-	    // King is in check
-	    return true; 
-          }
-        }
+  return isSquareAttackedBy<KingColour == White ? Black : White>(kingPos);
+}
+
+bool ChessBoard::isKingInCheck(const Colour kingColour) {
+  return kingColour == White ? isKingInCheckFor<White>() : isKingInCheckFor<Black>();
+}
+
+int ChessBoard::firstPieceOnLine(const int from, const int through) const {
+  int dy = squareRow(through) - squareRow(from);
+  int dx = squareCol(through) - squareCol(from);
+  // Only squares on the same row, column or diagonal are on a line
+  if ((dy == 0 && dx == 0) || (dy != 0 && dx != 0 && abs(dy) != abs(dx))) {
+    return -1;
+  }
+  int stepY = (dy > 0) - (dy < 0);
+  int stepX = (dx > 0) - (dx < 0);
+  for (int row = squareRow(from) + stepY, col = squareCol(from) + stepX; isInsideBoard(row, col);
+       row += stepY, col += stepX) {
+    if (mailbox[toSquare(row, col)] != 0) {
+      return toSquare(row, col);
+    }
+  }
+  return -1;
+}
+
+bool ChessBoard::doesPieceAttack(const int square, const int target) const {
+  uint8_t code = mailbox[square];
+  switch (pieceCodeType(code)) {
+    case PawnType:   return AttackTables::contains(AttackTables::PAWN_ATTACKS[pieceCodeColour(code)][square], target);
+    case KnightType: return AttackTables::contains(AttackTables::KNIGHT_ATTACKS[square], target);
+    case KingType:   return AttackTables::contains(AttackTables::KING_ATTACKS[square], target);
+    case NoPiece:    return false;
+    default :        break;
+  }
+  // A slider attacks along its own kind of line when nothing stands in between
+  if (firstPieceOnLine(square, target) != target) {
+    return false;
+  }
+  bool straight = squareRow(square) == squareRow(target) || squareCol(square) == squareCol(target);
+  return pieceCodeType(code) == QueenType || (pieceCodeType(code) == RookType) == straight;
+}
+
+bool ChessBoard::isDiscoveredAttack(const int kingSquare, const int vacated, const Colour attackerColour) const {
+  // Only the first piece seen from the king along the line can attack it
+  int square = firstPieceOnLine(kingSquare, vacated);
+  return square != -1 && pieceCodeColour(mailbox[square]) == attackerColour && doesPieceAttack(square, kingSquare);
+}
+
+bool ChessBoard::lastMoveGivesCheck(const Move & move) const {
+  Colour mover = colour == White ? Black : White;
+  int kingSquare = findKing(colour);
+  if (kingSquare == -1) {
+    return false;
+  }
+
+  // The moved piece itself, which is the new piece after a promotion
+  if (doesPieceAttack(move.to(), kingSquare)) {
+    return true;
+  }
+
+  // A slider behind the square the piece left
+  if (isDiscoveredAttack(kingSquare, move.from(), mover)) {
+    return true;
+  }
+
+  // En passant also empties the captured pawn's square
+  if (move.flag() == FlagEnPassant &&
+      isDiscoveredAttack(kingSquare, toSquare(squareRow(move.from()), squareCol(move.to())), mover)) {
+    return true;
+  }
+
+  // Castling also moves the rook, which may check from its new square or uncover a check from its old one
+  if (move.flag() == FlagCastle) {
+    bool kingSide = move.to() > move.from();
+    int rookFrom = toSquare(squareRow(move.from()), kingSide ? 7 : 0);
+    int rookTo = toSquare(squareRow(move.from()), kingSide ? 5 : 3);
+    return doesPieceAttack(rookTo, kingSquare) || isDiscoveredAttack(kingSquare, rookFrom, mover);
+  }
+  return false;
+}
+
+bool ChessBoard::isLeaperOnSquares(uint64_t squares, const char symbol, const Colour pieceColour) const {
+  uint8_t leaper = makePieceCode(symbol, pieceColour);
+  while (squares != 0) {
+    int square = __builtin_ctzll(squares);
+    squares &= squares - 1;
+    if ((mailbox[square] & ~PIECE_MOVED) == leaper) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template<Colour Attacker>
+bool ChessBoard::isSquareAttackedBy(const int pos[2]) const {
+  int square = toSquare(pos[0], pos[1]);
+  constexpr Colour defenderColour = Attacker == White ? Black : White;
+
+  // Leapers: only the few squares in the compile time tables can hold an attacker.
+  // A pawn attacks the square if it stands where a defending pawn on the square would capture.
+  if (isLeaperOnSquares(AttackTables::KNIGHT_ATTACKS[square], 'n', Attacker) ||
+      isLeaperOnSquares(AttackTables::KING_ATTACKS[square], 'k', Attacker) ||
+      isLeaperOnSquares(AttackTables::PAWN_ATTACKS[defenderColour][square], 'p', Attacker)) {
+    return true;
+  }
+
+  // Sliders: only the first piece along each line from the square can attack it, a queen on
+  // any line, a rook on a straight one and a bishop on a diagonal
+  constexpr uint8_t colourBit = Attacker == White ? 0 : PIECE_BLACK;
+  for (int line = 0; line < 8; line++) {
+    int stepY = LINE_STEPS[line][0], stepX = LINE_STEPS[line][1];
+    uint8_t slider = (line < 4 ? RookType : BishopType) | colourBit;
+    for (int row = pos[0] + stepY, col = pos[1] + stepX; isInsideBoard(row, col); row += stepY, col += stepX) {
+      uint8_t code = mailbox[toSquare(row, col)] & ~PIECE_MOVED;
+      if (code != 0) {
+	if (code == slider || code == (QueenType | colourBit)) {
+	  return true;
+	}
+	break;
       }
     }
   }
-  // King is not in check
   return false; 
 }
 
+bool ChessBoard::isSquareAttacked(const int pos[2], const Colour attackerColour) const {
+  return attackerColour == White ? isSquareAttackedBy<White>(pos) : isSquareAttackedBy<Black>(pos);
+}
+
 void ChessBoard::setCastleArray(const int index, const bool value) {
   if (index >= 0 && index < 4) {
+    // Keep the hash in step with the castling rights
+    if (canCastleArray[index] != value) {
+      hashKey ^= Zobrist::castleKey(index);
+    }
     canCastleArray[index] = value;
   }
 }
 
 bool ChessBoard::canEscapeCheck(const Colour kingColour) {
-  // Iterate through all pieces of the given colour
-  for (int x = 0; x < 8; x++) {
-    for (int y = 0; y < 8; y++) {
-      Pieces* piece = piecesBoard[x][y];
-      
-      // If there is a piece on the same team/colour
-      if (piece != nullptr && piece->getColour() == kingColour) {
-        // Check all possible moves for this piece
-        for (int destX = 0; destX < 8; destX++) {
-          for (int destY = 0; destY < 8; destY++) {
-            int sourcePos[2] = {x, y};
-            int destPos[2] = {destX, destY};
-            // For all possible positions check if it is a valid move
-	    if (piece->isValidMove(sourcePos, destPos)) {
-              // Simulate the move
-	      Pieces* temp = piecesBoard[destX][destY];
-              piecesBoard[destX][destY] = piece;
-              piecesBoard[x][y] = nullptr;
-                            
-              // Check if the king is still in check after simulating the move
-              bool stillInCheck = isKingInCheck(kingColour);
-
-	      // Revert the move
-              piecesBoard[x][y] = piece;
-              piecesBoard[destX][destY] = temp;
-                            
-              if (!stillInCheck) {
-		// Found a move that gets the king out of check or is a legal move
-                return true;
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-  // No move found to get out of check or no legal moves available
-  return false; 
+  // Any legal move will do, so stop at the first one
+  MoveList moves;
+  return generateMoves(moves, kingColour, ~0ULL, ~0ULL, true);
 }
 
-bool ChessBoard::doesMoveCauseCheck(const int sourcePos[2], int destinationPos[2], Colour colour) {
+template<Colour Side>
+bool ChessBoard::leavesKingInCheck(const int sourcePos[2], const int destinationPos[2]) {
   if (!isInsideBoard(destinationPos[0], destinationPos[1]) && !isInsideBoard(sourcePos[0], sourcePos[1])) {
     // If not inside board, return true to ensure move not done
     return true;
   }
-  Pieces* piece = piecesBoard[sourcePos[0]][sourcePos[1]];
-  Pieces* capturedPiece = piecesBoard[destinationPos[0]][destinationPos[1]];
+  int source = toSquare(sourcePos[0], sourcePos[1]);
+  int destination = toSquare(destinationPos[0], destinationPos[1]);
+  uint8_t piece = mailbox[source];
+  uint8_t capturedPiece = mailbox[destination];
+
+  // An en passant capture also removes the pawn beside the source square
+  int enPassantPawnSquare = toSquare(sourcePos[0], destinationPos[1]);
+  uint8_t enPassantPawn = 0;
+  if (capturedPiece == 0 && pieceCodeType(piece) == PawnType &&
+      sourcePos[1] != destinationPos[1] && isEnPassantTarget(destinationPos)) {
+    enPassantPawn = mailbox[enPassantPawnSquare];
+    mailbox[enPassantPawnSquare] = 0;
+  }
 
   // Simulate the move
-  piecesBoard[destinationPos[0]][destinationPos[1]] = piece;
-  piecesBoard[sourcePos[0]][sourcePos[1]] = nullptr;
+  mailbox[destination] = piece;
+  mailbox[source] = 0;
 
   // Check if this move would put the player's king in check
-  bool causesCheck = isKingInCheck(colour);
+  bool causesCheck = isKingInCheckFor<Side>();
 
   // Revert the move
-  piecesBoard[sourcePos[0]][sourcePos[1]] = piece;
-  piecesBoard[destinationPos[0]][destinationPos[1]] = capturedPiece;
+  mailbox[source] = piece;
+  mailbox[destination] = capturedPiece;
+  if (enPassantPawn != 0) {
+    mailbox[enPassantPawnSquare] = enPassantPawn;
+  }
 
   return causesCheck;
 }
 
+bool ChessBoard::doesMoveCauseCheck(const int sourcePos[2], int destinationPos[2], Colour colour) {
+  return colour == White ? leavesKingInCheck<White>(sourcePos, destinationPos)
+                         : leavesKingInCheck<Black>(sourcePos, destinationPos);
+}
+
 
 bool ChessBoard::isInBounds(int * sourcePos, int * destinationPos) {
   // Check for out-of-range values
@@ -307,7 +586,7 @@ bool ChessBoard::isInBounds(int * sourcePos, int * destinationPos) {
   return true;
  }
 
-bool ChessBoard::isValidStartPosition(Pieces* startPosition, const char* sourceSquare) {
+bool ChessBoard::isValidStartPosition(const Pieces* startPosition, const char* sourceSquare) {
   if (!startPosition) {
     cout << "There is no piece at position " << sourceSquare << "!";
     return false;
@@ -315,7 +594,7 @@ bool ChessBoard::isValidStartPosition(Pieces* startPosition, const char* sourceS
   return true;
 }
 
-bool ChessBoard::isValidTurn(Pieces* startPosition) {
+bool ChessBoard::isValidTurn(const Pieces* startPosition) {
   if (colour != startPosition->getColour()) {
       cout << "\nIt is not " << startPosition->getColourString() << "'s turn to move!" << endl;
       return false;
@@ -323,9 +602,12 @@ bool ChessBoard::isValidTurn(Pieces* startPosition) {
   return true;
 }
 
-bool ChessBoard::isValidMove(Pieces* startPosition, int sourcePos[], int destinationPos[], const char* destinationSquare) {
+bool ChessBoard::isValidMove(const Pieces* startPosition, const Move & move, const char* destinationSquare) {
+  int sourcePos[2] = {squareRow(move.from()), squareCol(move.from())};
+  int destinationPos[2] = {squareRow(move.to()), squareCol(move.to())};
+
   // Uses overriden isValidMove() depending on the subclass of Piece e.g. Pawn
-  if (!startPosition->isValidMove(sourcePos, destinationPos)) {
+  if (!startPosition->isValidMove(*this, sourcePos, destinationPos)) {
     cout << "\n" << startPosition->getColourString() << "'s " << startPosition->getType() << " cannot move to " << destinationSquare << "!" << endl;
     return false;
   }
@@ -338,40 +620,76 @@ bool ChessBoard::isValidMove(Pieces* startPosition, int sourcePos[], int destina
   return true;
 }
 
-void ChessBoard::executeMove(Pieces* startPosition, int sourcePos[], int destinationPos[]) {
-    startPosition->makeMove(sourcePos, destinationPos);
-    // Update the colour to go after executing the move
-    this->colour = (colour == White) ? Black : White;
+void ChessBoard::executeMove(const Pieces* startPosition, const Move & move) {
+  int sourcePos[2] = {squareRow(move.from()), squareCol(move.from())};
+  int destinationPos[2] = {squareRow(move.to()), squareCol(move.to())};
+  char sourceSquare[3] = {'\0'};
+  char destinationSquare[3] = {'\0'};
+  rowColToString(sourceSquare, sourcePos);
+  rowColToString(destinationSquare, destinationPos);
+
+  cout << "\n" << startPosition->getColourString() << "'s " << startPosition->getType() << " moves from " << sourceSquare << " to " << destinationSquare;
+
+  // doMove() makes the move silently and updates the colour to go, the history keeps it for undo
+  MoveUndo undo;
+  doMove(move, undo);
+  recordGameMove(move);
+  if (undo.captured != 0) {
+    const Pieces* captured = pieceForCode(undo.captured);
+    cout << " taking " << captured->getColourString() << "'s " << captured->getType();
+  }
+  if (move.isPromotion()) {
+    cout << " and promotes to a " << pieceAt(move.to())->getType();
+  }
 }
 
-bool ChessBoard::checkGameOver() {
+void ChessBoard::makeMove(const Move & move) {
+  MoveUndo undo;
+  doMove(move, undo);
+  recordGameMove(move);
+}
+
+bool ChessBoard::checkGameOver(const bool inCheck) {
   if (!canEscapeCheck(colour)) {
-    if (isKingInCheck(colour)) {
+    if (inCheck) {
       cout << "\n" << getColourString() << " is in checkmate" << endl;
     } else {
       cout << "\nIt is a stalemate" << endl;
     }
+    // The final position stays on the board and in the history
     isGameOver = true;
-    clearBoard();
+    history.setFinished(true);
+    return true;
+  }
+  if (halfmoveClock >= 100 || getRepetitionCount() >= 2) {
+    if (halfmoveClock >= 100) {
+      cout << "\nIt is a draw by the fifty-move rule" << endl;
+    } else {
+      cout << "\nIt is a draw by threefold repetition" << endl;
+    }
+    isGameOver = true;
+    history.setFinished(true);
     return true;
   }
   return false;
 }
 
-void ChessBoard::postMoveChecks() {
+void ChessBoard::postMoveChecks(const Move & move) {
   const char* colourString = (colour == White) ? "White" : "Black";
 
-  if (checkGameOver()) {
+  // Only the squares the move changed can give check
+  bool inCheck = lastMoveGivesCheck(move);
+  if (checkGameOver(inCheck)) {
     // Skip print statement for in check
     return; 
   }
 
-  if (isKingInCheck(colour)) {
+  if (inCheck) {
     cout << "\n" << colourString << " is in check";
   }
 }
 
-void ChessBoard::submitMove(const char * sourceSquare, const char * destinationSquare) {
+void ChessBoard::submitMove(const char * sourceSquare, const char * destinationSquare, const char promotion) {
   // Prevent moves after end of game
   if (isGameOver){
     cout << "The Game is over" << endl;
@@ -388,8 +706,31 @@ void ChessBoard::submitMove(const char * sourceSquare, const char * destinationS
     return; 
   }
 
+  Move move = createMove(toSquare(sourcePos[0], sourcePos[1]), toSquare(destinationPos[0], destinationPos[1]), promotion);
+  playMove(move, sourceSquare, destinationSquare);
+}
+
+void ChessBoard::submitMove(const Move & move) {
+  // Prevent moves after end of game
+  if (isGameOver){
+    cout << "The Game is over" << endl;
+    return;
+  }
+
+  int sourcePos[2] = {squareRow(move.from()), squareCol(move.from())};
+  int destinationPos[2] = {squareRow(move.to()), squareCol(move.to())};
+  char sourceSquare[3] = {'\0'};
+  char destinationSquare[3] = {'\0'};
+  rowColToString(sourceSquare, sourcePos);
+  rowColToString(destinationSquare, destinationPos);
+
+  char promotion = move.isPromotion() ? move.promotionSymbol() : 'q';
+  playMove(createMove(move.from(), move.to(), promotion), sourceSquare, destinationSquare);
+}
+
+void ChessBoard::playMove(const Move & move, const char* sourceSquare, const char* destinationSquare) {
   // Ensures there is a piece at the starting position
-  Pieces* startPosition = piecesBoard[sourcePos[0]][sourcePos[1]];
+  const Pieces* startPosition = pieceAt(move.from());
   if (!isValidStartPosition(startPosition, sourceSquare)) {
     return; 
   }
@@ -400,14 +741,531 @@ void ChessBoard::submitMove(const char * sourceSquare, const char * destinationS
   }
 
   // Validate the move, this calls an overriden function specific to the piece type
-  if (!isValidMove(startPosition, sourcePos, destinationPos, destinationSquare)) {
+  if (!isValidMove(startPosition, move, destinationSquare)) {
     return; 
   }
 
   // Make the move and update the colour to go
-  executeMove(startPosition, sourcePos, destinationPos);
+  executeMove(startPosition, move);
 
   // Post-move checks (checkmate, stalemate, check)
-  postMoveChecks();
+  postMoveChecks(move);
 }
   
+
+
+namespace {
+  /** Squares White and Black pawns promote on. */
+  const uint64_t WHITE_PROMOTION_SQUARES = 0xFFULL;
+  const uint64_t BLACK_PROMOTION_SQUARES = 0xFFULL << 56;
+}
+
+uint64_t ChessBoard::occupiedBy(const Colour side) const {
+  uint64_t occupied = 0;
+  for (int square = 0; square < 64; square++) {
+    if (mailbox[square] != 0 && pieceCodeColour(mailbox[square]) == side) {
+      occupied |= 1ULL << square;
+    }
+  }
+  return occupied;
+}
+
+template<Colour Side>
+bool ChessBoard::isPseudoLegalFor(const uint8_t code, const int sourcePos[2], const int destinationPos[2]) {
+  // The classes are final, so these calls are not virtual
+  switch (pieceCodeType(code)) {
+    case PawnType:   return pawnRules<Side>().isValidMove(*this, sourcePos, destinationPos);
+    case KnightType: return KNIGHTS[Side].isValidMove(*this, sourcePos, destinationPos);
+    case BishopType: return BISHOPS[Side].isValidMove(*this, sourcePos, destinationPos);
+    case RookType:   return rookRules<Side>().isValidMove(*this, sourcePos, destinationPos);
+    case QueenType:  return QUEENS[Side].isValidMove(*this, sourcePos, destinationPos);
+    case KingType:   return kingRules<Side>().isValidMove(*this, sourcePos, destinationPos);
+    default :        return false;
+  }
+}
+
+template<Colour Side>
+bool ChessBoard::generateMovesFor(MoveList & moves, uint64_t targets, uint64_t pawnTargets, const bool stopAtFirst) {
+  moves.clear();
+  for (int from = 0; from < 64; from++) {
+    int x = squareRow(from), y = squareCol(from);
+    uint8_t code = mailbox[from];
+    if (code == 0 || pieceCodeColour(code) != Side) {
+      continue;
+    }
+
+    // Narrow the destinations to the squares the piece could reach
+    uint64_t destinations = targets;
+    PieceType type = pieceCodeType(code);
+    if (type == PawnType) {
+      uint64_t pushes = Side == White ? (1ULL << from) >> 8 | (1ULL << from) >> 16
+	                              : (1ULL << from) << 8 | (1ULL << from) << 16;
+      destinations = pawnTargets & (AttackTables::PAWN_ATTACKS[Side][from] | pushes);
+    } else if (type == KnightType) {
+      destinations &= AttackTables::KNIGHT_ATTACKS[from];
+    } else if (type == KingType) {
+      // Castling moves the king two squares along its row
+      uint64_t castles = (y + 2 < 8 ? 1ULL << (from + 2) : 0) | (y - 2 >= 0 ? 1ULL << (from - 2) : 0);
+      destinations &= AttackTables::KING_ATTACKS[from] | castles;
+    }
+
+    int sourcePos[2] = {x, y};
+    while (destinations != 0) {
+      int to = __builtin_ctzll(destinations);
+      destinations &= destinations - 1;
+      int destPos[2] = {squareRow(to), squareCol(to)};
+      // Pseudo-legal for the piece, and does not leave our own king in check
+      if (!isPseudoLegalFor<Side>(code, sourcePos, destPos) || leavesKingInCheck<Side>(sourcePos, destPos)) {
+	continue;
+      }
+      if (stopAtFirst) {
+	return true;
+      }
+      Move move = createMove(from, to);
+      if (move.isPromotion()) {
+	// One move per promotion piece
+	moves.add(Move(from, to, FlagPromoQueen));
+	moves.add(Move(from, to, FlagPromoKnight));
+	moves.add(Move(from, to, FlagPromoRook));
+	moves.add(Move(from, to, FlagPromoBishop));
+      } else {
+	moves.add(move);
+      }
+    }
+  }
+  return !moves.empty();
+}
+
+bool ChessBoard::generateMoves(MoveList & moves, const Colour side, uint64_t targets, uint64_t pawnTargets,
+			       const bool stopAtFirst) {
+  return side == White ? generateMovesFor<White>(moves, targets, pawnTargets, stopAtFirst)
+                       : generateMovesFor<Black>(moves, targets, pawnTargets, stopAtFirst);
+}
+
+void ChessBoard::generateLegalMoves(MoveList & moves) {
+  generateMoves(moves, colour, ~0ULL, ~0ULL, false);
+}
+
+void ChessBoard::generateNoisyMoves(MoveList & moves) {
+  uint64_t enemies = occupiedBy(colour == White ? Black : White);
+  uint64_t promotions = colour == White ? WHITE_PROMOTION_SQUARES : BLACK_PROMOTION_SQUARES;
+  uint64_t enPassant = enPassantSquare >= 0 ? 1ULL << enPassantSquare : 0;
+  generateMoves(moves, colour, enemies, enemies | promotions | enPassant, false);
+}
+
+void ChessBoard::generateQuietMoves(MoveList & moves) {
+  uint64_t empty = ~(occupiedBy(White) | occupiedBy(Black));
+  uint64_t promotions = colour == White ? WHITE_PROMOTION_SQUARES : BLACK_PROMOTION_SQUARES;
+  uint64_t enPassant = enPassantSquare >= 0 ? 1ULL << enPassantSquare : 0;
+  generateMoves(moves, colour, empty, empty & ~promotions & ~enPassant, false);
+}
+
+void ChessBoard::generateCheckingMoves(MoveList & moves) {
+  moves.clear();
+  Colour enemy = colour == White ? Black : White;
+  int kingSquare = findKing(enemy);
+  if (kingSquare == -1) {
+    return;
+  }
+
+  // Walk the lines out from the king. The squares up to and including the first piece are where a
+  // slider checks from; if that piece is ours and one of our sliders of the line's kind is next,
+  // moving it off the line uncovers check.
+  uint64_t straight = 0, diagonal = 0;
+  int discoverers[8];
+  uint64_t discovererLines[8];
+  int discovererCount = 0;
+  for (int k = 0; k < 8; k++) {
+    bool isStraight = k < 4;
+    uint64_t line = 0;
+    int blocker = -1;
+    for (int row = squareRow(kingSquare) + LINE_STEPS[k][0], col = squareCol(kingSquare) + LINE_STEPS[k][1];
+	 isInsideBoard(row, col); row += LINE_STEPS[k][0], col += LINE_STEPS[k][1]) {
+      int square = toSquare(row, col);
+      uint8_t code = mailbox[square];
+      line |= 1ULL << square;
+      if (blocker == -1) {
+	(isStraight ? straight : diagonal) |= 1ULL << square;
+	if (code == 0) {
+	  continue;
+	}
+	blocker = square;
+	if (pieceCodeColour(code) != colour) {
+	  break;
+	}
+      } else if (code != 0) {
+	PieceType type = pieceCodeType(code);
+	if (pieceCodeColour(code) == colour && (type == QueenType || type == (isStraight ? RookType : BishopType))) {
+	  discoverers[discovererCount] = blocker;
+	  discovererLines[discovererCount++] = line;
+	}
+	break;
+      }
+    }
+  }
+
+  // A discoverer may go anywhere, otherwise only the checking squares, the promotion and en passant
+  // squares and the castling king's squares are destinations
+  uint64_t pawnChecks = AttackTables::PAWN_ATTACKS[enemy][kingSquare];
+  uint64_t knightChecks = AttackTables::KNIGHT_ATTACKS[kingSquare];
+  uint64_t targets = ~0ULL, pawnTargets = ~0ULL;
+  if (discovererCount == 0) {
+    int ownKing = findKing(colour);
+    uint64_t castles = 0;
+    if (ownKing != -1 && (canCastle(1, colour) || canCastle(-1, colour))) {
+      castles = (squareCol(ownKing) + 2 < 8 ? 1ULL << (ownKing + 2) : 0) |
+	(squareCol(ownKing) - 2 >= 0 ? 1ULL << (ownKing - 2) : 0);
+    }
+    targets = straight | diagonal | knightChecks | castles;
+    pawnTargets = pawnChecks | (colour == White ? WHITE_PROMOTION_SQUARES : BLACK_PROMOTION_SQUARES) |
+      (enPassantSquare >= 0 ? 1ULL << enPassantSquare : 0);
+  }
+  MoveList candidates;
+  generateMoves(candidates, colour, targets, pawnTargets, false);
+
+  for (const Move & move : candidates) {
+    bool givesCheck = false;
+    if (move.isPromotion() || move.flag() == FlagEnPassant || move.flag() == FlagCastle) {
+      // The piece that checks is not the one that moved, or a second square is emptied
+      MoveUndo undo;
+      doMove(move, undo);
+      givesCheck = lastMoveGivesCheck(move);
+      undoMove(move, undo);
+    } else {
+      for (int d = 0; d < discovererCount && !givesCheck; d++) {
+	givesCheck = move.from() == discoverers[d] && !AttackTables::contains(discovererLines[d], move.to());
+      }
+      switch (pieceCodeType(mailbox[move.from()])) {
+        case PawnType:   givesCheck |= AttackTables::contains(pawnChecks, move.to()); break;
+        case KnightType: givesCheck |= AttackTables::contains(knightChecks, move.to()); break;
+        case BishopType: givesCheck |= AttackTables::contains(diagonal, move.to()); break;
+        case RookType:   givesCheck |= AttackTables::contains(straight, move.to()); break;
+        case QueenType:  givesCheck |= AttackTables::contains(straight | diagonal, move.to()); break;
+        default :        break;
+      }
+    }
+    if (givesCheck) {
+      moves.add(move);
+    }
+  }
+}
+
+bool ChessBoard::isLegalMove(const Move & move) {
+  if (move.isNull()) {
+    return false;
+  }
+  const Pieces* piece = pieceAt(move.from());
+  if (piece == nullptr || piece->getColour() != colour ||
+      createMove(move.from(), move.to(), move.isPromotion() ? move.promotionSymbol() : 'q') != move) {
+    return false;
+  }
+  int sourcePos[2] = {squareRow(move.from()), squareCol(move.from())};
+  int destPos[2] = {squareRow(move.to()), squareCol(move.to())};
+  if (colour == White) {
+    return isPseudoLegalFor<White>(mailbox[move.from()], sourcePos, destPos) && !leavesKingInCheck<White>(sourcePos, destPos);
+  }
+  return isPseudoLegalFor<Black>(mailbox[move.from()], sourcePos, destPos) && !leavesKingInCheck<Black>(sourcePos, destPos);
+}
+
+Move ChessBoard::createMove(const int from, const int to, const char promotion) const {
+  PieceType type = pieceCodeType(mailbox[from]);
+  if (type == NoPiece) {
+    return Move(from, to);
+  }
+  int dy = squareRow(to) - squareRow(from);
+  int dx = squareCol(to) - squareCol(from);
+
+  if (type == KingType && dy == 0 && abs(dx) == 2) {
+    return Move(from, to, FlagCastle);
+  }
+  if (type == PawnType) {
+    // Reaching the first or last row can only be a promotion
+    if (squareRow(to) == 0 || squareRow(to) == 7) {
+      return Move(from, to, Move::promotionFlag(promotion));
+    }
+    if (abs(dy) == 2) {
+      return Move(from, to, FlagDoublePush);
+    }
+    if (dx != 0 && to == enPassantSquare && mailbox[to] == 0) {
+      return Move(from, to, FlagEnPassant);
+    }
+  }
+  return Move(from, to);
+}
+
+bool ChessBoard::isCapture(const Move & move) const {
+  return move.flag() == FlagEnPassant || mailbox[move.to()] != 0;
+}
+
+int ChessBoard::leastValuableAttacker(const int target, const Colour side, const uint64_t occupied) const {
+  uint8_t pieceColour = side == White ? 0 : PIECE_BLACK;
+  // A pawn attacks the target from the squares a pawn of the other colour would attack
+  uint64_t candidates = AttackTables::PAWN_ATTACKS[side == White ? Black : White][target] & occupied;
+  for (; candidates != 0; candidates &= candidates - 1) {
+    int square = __builtin_ctzll(candidates);
+    if ((mailbox[square] & (PIECE_TYPE_MASK | PIECE_BLACK)) == (PawnType | pieceColour)) {
+      return square;
+    }
+  }
+  for (candidates = AttackTables::KNIGHT_ATTACKS[target] & occupied; candidates != 0; candidates &= candidates - 1) {
+    int square = __builtin_ctzll(candidates);
+    if ((mailbox[square] & (PIECE_TYPE_MASK | PIECE_BLACK)) == (KnightType | pieceColour)) {
+      return square;
+    }
+  }
+
+  // The first piece still in the exchange on each line, the cheapest slider moving along it wins
+  int best = -1;
+  PieceType bestType = KingType;
+  int targetRow = squareRow(target), targetCol = squareCol(target);
+  for (int line = 0; line < 8; line++) {
+    int row = targetRow + LINE_STEPS[line][0], col = targetCol + LINE_STEPS[line][1];
+    while (isInsideBoard(row, col) && !((occupied >> toSquare(row, col)) & 1)) {
+      row += LINE_STEPS[line][0];
+      col += LINE_STEPS[line][1];
+    }
+    if (!isInsideBoard(row, col)) {
+      continue;
+    }
+    uint8_t code = mailbox[toSquare(row, col)];
+    PieceType type = pieceCodeType(code);
+    bool slides = type == QueenType || type == (line < 4 ? RookType : BishopType);
+    if (slides && pieceCodeColour(code) == side && type < bestType) {
+      best = toSquare(row, col);
+      bestType = type;
+    }
+  }
+  if (best != -1) {
+    return best;
+  }
+
+  for (candidates = AttackTables::KING_ATTACKS[target] & occupied; candidates != 0; candidates &= candidates - 1) {
+    int square = __builtin_ctzll(candidates);
+    if ((mailbox[square] & (PIECE_TYPE_MASK | PIECE_BLACK)) == (KingType | pieceColour)) {
+      return square;
+    }
+  }
+  return -1;
+}
+
+int ChessBoard::staticExchange(const Move & move) const {
+  int target = move.to();
+  int square = move.from();
+  uint64_t occupied = occupiedBy(White) | occupiedBy(Black);
+  // gain[d] is the material won by the side making the d-th capture if the exchange stops after it
+  int gain[32];
+  int depth = 0;
+  if (move.flag() == FlagEnPassant) {
+    occupied &= ~(1ULL << toSquare(squareRow(move.from()), squareCol(target)));
+    gain[0] = EXCHANGE_VALUES[PawnType];
+  } else {
+    gain[0] = EXCHANGE_VALUES[pieceCodeType(mailbox[target])];
+  }
+  int attackerValue = EXCHANGE_VALUES[pieceCodeType(mailbox[square])];
+  Colour side = pieceCodeColour(mailbox[square]);
+
+  while (depth < 31) {
+    depth++;
+    // What the other side wins if it takes the piece that has just captured
+    gain[depth] = attackerValue - gain[depth - 1];
+    // Neither side can do better by going on, so the outcome is already known
+    if (max(-gain[depth - 1], gain[depth]) < 0) {
+      break;
+    }
+    occupied &= ~(1ULL << square);
+    side = side == White ? Black : White;
+    square = leastValuableAttacker(target, side, occupied);
+    if (square == -1) {
+      break;
+    }
+    attackerValue = EXCHANGE_VALUES[pieceCodeType(mailbox[square])];
+  }
+  // Each side only makes its capture if it comes out ahead of stopping before it
+  while (--depth > 0) {
+    gain[depth - 1] = -max(-gain[depth - 1], gain[depth]);
+  }
+  return gain[0];
+}
+
+void ChessBoard::doMove(const Move & move, MoveUndo & undo) {
+  int sourcePos[2] = {squareRow(move.from()), squareCol(move.from())};
+  int destinationPos[2] = {squareRow(move.to()), squareCol(move.to())};
+  uint8_t piece = mailbox[move.from()];
+
+  // Save everything the move can change
+  undo.hashKey = hashKey;
+  undo.pawnKey = pawnKey;
+  undo.movedPiece = piece;
+  for (int k = 0; k < 4; k++) {
+    undo.canCastleArray[k] = canCastleArray[k];
+  }
+  undo.rookFrom = -1;
+  undo.rookTo = -1;
+  undo.halfmoveClock = halfmoveClock;
+  undo.fullmoveNumber = fullmoveNumber;
+  undo.enPassantSquare = enPassantSquare;
+  bool irreversible = isCapture(move) || pieceCodeType(piece) == PawnType;
+  featureChanges.clear();
+
+  // Lift the captured piece off the board so movePiece() neither prints nor deletes it.
+  // An en passant capture takes the pawn beside the source square, not on the destination,
+  // and never anything but an enemy pawn.
+  int capturedRow = move.flag() == FlagEnPassant ? sourcePos[0] : destinationPos[0];
+  undo.captured = mailbox[toSquare(capturedRow, destinationPos[1])];
+  if (move.flag() == FlagEnPassant &&
+      (pieceCodeType(undo.captured) != PawnType || pieceCodeColour(undo.captured) == pieceCodeColour(piece))) {
+    undo.captured = 0;
+  }
+  if (undo.captured != 0) {
+    togglePieceKey(capturedRow, destinationPos[1]);
+    mailbox[toSquare(capturedRow, destinationPos[1])] = 0;
+    if (network != nullptr) {
+      featureChanges.remove(undo.captured, toSquare(capturedRow, destinationPos[1]));
+    }
+    // A rook taken on its corner takes its side's castling right with it
+    Colour capturedColour = pieceCodeColour(undo.captured);
+    if (pieceCodeType(undo.captured) == RookType && capturedRow == (capturedColour == White ? 7 : 0) &&
+	(destinationPos[1] == 0 || destinationPos[1] == 7)) {
+      setCastleArray(castleIndex(capturedColour, destinationPos[1] == 7), false);
+    }
+  }
+
+  // A king moving two columns is castling, remember the rook so it can be moved back
+  int dx = destinationPos[1] - sourcePos[1];
+  if (pieceCodeType(piece) == KingType && abs(dx) == 2) {
+    int rookFrom = toSquare(sourcePos[0], dx == 2 ? 7 : 0);
+    int rookTo = toSquare(sourcePos[0], dx == 2 ? 5 : 3);
+    if (mailbox[rookFrom] != 0) {
+      undo.rookFrom = rookFrom;
+      undo.rookTo = rookTo;
+    }
+  }
+
+  pieceAt(move.from())->applyMove(*this, sourcePos, destinationPos);
+
+  // The rook is only moved if it belonged to the castling king
+  if (undo.rookFrom != -1 && mailbox[undo.rookFrom] != 0) {
+    undo.rookFrom = -1;
+    undo.rookTo = -1;
+  }
+
+  // Replace a promoting pawn with the new piece, undoMove() puts the pawn back from undo.movedPiece
+  if (move.isPromotion()) {
+    togglePieceKey(destinationPos[0], destinationPos[1]);
+    if (network != nullptr) {
+      featureChanges.remove(mailbox[move.to()], move.to());
+    }
+    mailbox[move.to()] = makePieceCode(move.promotionSymbol(), pieceCodeColour(piece)) | PIECE_MOVED;
+    togglePieceKey(destinationPos[0], destinationPos[1]);
+    if (network != nullptr) {
+      featureChanges.add(mailbox[move.to()], move.to());
+    }
+  }
+
+  // Only a double pawn push leaves an en passant square behind
+  if (enPassantSquare != -1) {
+    hashKey ^= Zobrist::enPassantKey(squareCol(enPassantSquare));
+    enPassantSquare = -1;
+  }
+  if (move.flag() == FlagDoublePush) {
+    enPassantSquare = toSquare((sourcePos[0] + destinationPos[0]) / 2, sourcePos[1]);
+    hashKey ^= Zobrist::enPassantKey(sourcePos[1]);
+  }
+
+  colour = (colour == White) ? Black : White;
+  hashKey ^= Zobrist::sideKey();
+  recordMove(irreversible);
+  if (network != nullptr) {
+    updateAccumulators(piece, move);
+  }
+}
+
+void ChessBoard::undoMove(const Move & move, const MoveUndo & undo) {
+  // The saved code restores the moved flag, and the pawn if the move promoted
+  mailbox[move.from()] = undo.movedPiece;
+  mailbox[move.to()] = 0;
+  if (undo.captured != 0) {
+    int capturedRow = move.flag() == FlagEnPassant ? squareRow(move.from()) : squareRow(move.to());
+    mailbox[toSquare(capturedRow, squareCol(move.to()))] = undo.captured;
+  }
+
+  // A rook that castles has never moved, or the castling right would be gone
+  if (undo.rookFrom != -1) {
+    mailbox[undo.rookFrom] = mailbox[undo.rookTo] & ~PIECE_MOVED;
+    mailbox[undo.rookTo] = 0;
+  }
+
+  for (int k = 0; k < 4; k++) {
+    canCastleArray[k] = undo.canCastleArray[k];
+  }
+  colour = (colour == White) ? Black : White;
+  hashKey = undo.hashKey;
+  pawnKey = undo.pawnKey;
+  halfmoveClock = undo.halfmoveClock;
+  fullmoveNumber = undo.fullmoveNumber;
+  enPassantSquare = undo.enPassantSquare;
+  gamePly--;
+}
+
+void ChessBoard::doNullMove(MoveUndo & undo) {
+  undo.hashKey = hashKey;
+  undo.halfmoveClock = halfmoveClock;
+  undo.fullmoveNumber = fullmoveNumber;
+  undo.enPassantSquare = enPassantSquare;
+  if (enPassantSquare != -1) {
+    hashKey ^= Zobrist::enPassantKey(squareCol(enPassantSquare));
+    enPassantSquare = -1;
+  }
+  colour = (colour == White) ? Black : White;
+  hashKey ^= Zobrist::sideKey();
+  // Irreversible, so the repetition check stops at the null move
+  recordMove(true);
+  if (network != nullptr) {
+    accumulators[gamePly & (ACCUMULATOR_HISTORY_SIZE - 1)] = accumulators[(gamePly - 1) & (ACCUMULATOR_HISTORY_SIZE - 1)];
+  }
+}
+
+void ChessBoard::undoNullMove(const MoveUndo & undo) {
+  colour = (colour == White) ? Black : White;
+  hashKey = undo.hashKey;
+  halfmoveClock = undo.halfmoveClock;
+  fullmoveNumber = undo.fullmoveNumber;
+  enPassantSquare = undo.enPassantSquare;
+  gamePly--;
+}
+
+bool ChessBoard::hasNonPawnMaterial(const Colour side) const {
+  for (int square = 0; square < 64; square++) {
+    PieceType type = pieceCodeType(mailbox[square]);
+    if (type != NoPiece && type != PawnType && type != KingType && pieceCodeColour(mailbox[square]) == side) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ChessBoard::hasInsufficientMaterial() const {
+  int minorPieces = 0;
+  for (int square = 0; square < 64; square++) {
+    PieceType type = pieceCodeType(mailbox[square]);
+    if (type == NoPiece || type == KingType) {
+      continue;
+    }
+    // Any pawn, rook or queen, or a second minor piece, can still mate
+    if (type != KnightType && type != BishopType) {
+      return false;
+    }
+    if (++minorPieces > 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+char ChessBoard::getPieceSymbol(const int square) const {
+  uint8_t code = mailbox[square];
+  if (code == 0) {
+    return '\0';
+  }
+  return pieceCodeColour(code) == White ? toupper(pieceCodeSymbol(code)) : pieceCodeSymbol(code);
+}
@@ -2,13 +2,39 @@
 #define CHESSBOARD_H
 
 #include"Pieces.h"
+#include"Move.h"
+#include"Fen.h"
+#include"Nnue.h"
+#include"GameHistory.h"
+#include<cstdint>
 #include<iostream>
+#include<vector>
 #include<cstring>
 #include<cctype>
 
 /** Castle Direction indexes represent the indexes in canCastleArray. */
 enum CastleDirection {whiteKingSide, whiteQueenSide, blackKingSide, blackQueenSide};
 
+/** Gets the CastleDirection of one side's castling right, a constant when the colour is one. */
+constexpr int castleIndex(const Colour colour, const bool kingSide) { return colour * 2 + (kingSide ? 0 : 1); }
+
+/** State saved by ChessBoard::doMove() so the move can be taken back by ChessBoard::undoMove(). */
+struct MoveUndo {
+  /** Piece code of the moving piece before the move, the pawn if the move promotes. */
+  uint8_t movedPiece = 0;
+  /** Piece code of the captured piece, or 0. */
+  uint8_t captured = 0;
+  bool canCastleArray[4] = {false, false, false, false};
+  uint64_t hashKey = 0;
+  uint64_t pawnKey = 0;
+  int halfmoveClock = 0;
+  int fullmoveNumber = 1;
+  int enPassantSquare = -1;
+  /** Rook squares when the move castles, -1 otherwise. */
+  int rookFrom = -1;
+  int rookTo = -1;
+};
+
 /** Abstract class so only Pieces can call the functions below */
 class IChessBoardActions {
 public:
@@ -24,41 +50,263 @@ public:
   virtual void rowColToString(char * square, const int position[2]) const = 0;
   virtual const char * getPosType(const int pos[2]) const = 0;
   virtual bool isKingInCheck(const Colour kingColour) = 0;
+  virtual bool isEnPassantTarget(const int pos[2]) const = 0;
+  virtual bool hasPieceMoved(const int pos[2]) const = 0;
 };
 
 class ChessBoard : public IChessBoardActions {
 public:
  
   /** Default constructor for ChessBoard.
-   *  Initialises an empty 8x8 chessboard with all squares set to nullptr.
+   *  Initialises an empty 8x8 chessboard with every square set to 0.
    */
   ChessBoard();
 
-  /** Destructor for ChessBoard.
-   *  Deallocates all dynamically allocated pieces and clears the board.
+  /** Loads the board state from a given FEN string and reports checkmate or stalemate.
+   *  An invalid FEN string is reported and the current board state is kept.
+   *  @param fen: The FEN string representing the board state.
    */
-  ~ChessBoard();
+  void loadState(const char* fen);
 
-  /** Loads the board state from a given FEN string, a valid board state is assumed.
-   *  Clears the current board state before setting up the new state.
+  /** Loads the board state from a FEN string without printing anything.
+   *  The string is fully validated by parseFen() before the current state is cleared,
+   *  so a malformed string leaves the board unchanged.
    *  Calls the PiecesFactory createPiece() function to create specific piece objects (e.g. Pawns, Kings)
    *  @param fen: The FEN string representing the board state.
+   *  @return FenOk, or the reason the string was rejected.
    */
-  void loadState(const char* fen);
+  FenError setFen(const char* fen);
+
+  /** Loads a decoded position without printing anything.
+   *  @param position: A valid position, e.g. from parseFen() or unpackPosition().
+   */
+  void setPosition(const FenPosition & position);
+
+  /** Gets the current board state as a decoded position, e.g. for writeFen() or packPosition(). */
+  void getPosition(FenPosition & position) const;
+
+  /** Writes the current board state as a six field FEN string.
+   *  @param fen: Buffer of at least MAX_FEN_LENGTH characters.
+   *  @return The length of the string written.
+   */
+  int toFen(char* fen) const;
 
   /** Validates a chess move, based on the board state, if the move would cause check
    *  and uses the Piece's specific isValid().
    *  @param sourceSquare: The source square in algebraic notation (e.g., "e2").
    *  @param destinationSquare: The destination square in algebraic notation (e.g., "e4").
+   *  @param promotion: The piece a pawn promotes to ('q', 'r', 'b' or 'n'), a queen by default.
+   */
+  void submitMove(const char* sourceSquare, const char* destinationSquare, const char promotion = 'q');
+
+  /** Validates and plays a move in the same way as the algebraic notation submitMove().
+   *  @param move: The move to play, its flags are recomputed from the board except the promotion piece.
+   */
+  void submitMove(const Move & move);
+
+  /**
+   * Engine interface used by the search. Moves made here are silent and can be taken back.
+   */
+
+  /** Generates every legal move for the player to move, promotions produce one move per piece.
+   *  @param moves: Cleared and filled with the legal moves.
+   */
+  void generateLegalMoves(MoveList & moves);
+
+  /** Generates the legal captures (including en passant) and promotions, the moves a staged
+   *  move picker tries before any quiet move.
+   *  @param moves: Cleared and filled with the moves.
+   */
+  void generateNoisyMoves(MoveList & moves);
+
+  /** Generates the legal moves that neither capture nor promote, including castling.
+   *  Together with generateNoisyMoves() this gives exactly the moves of generateLegalMoves().
+   *  @param moves: Cleared and filled with the moves.
+   */
+  void generateQuietMoves(MoveList & moves);
+
+  /** Generates the legal moves that give check, e.g. for a mate search.
+   *  Direct checks are found from the squares each kind of piece would check from: the knight
+   *  and pawn tables, and the lines out from the enemy king up to its first blocker. Discovered
+   *  checks come from the pieces that stand alone between the king and one of our sliders, and
+   *  move off that line. Only castling, en passant and promotions are tried on the board.
+   *  @param moves: Cleared and filled with the moves.
+   */
+  void generateCheckingMoves(MoveList & moves);
+
+  /** Checks that a move from outside the current position, e.g. a hash or killer move,
+   *  is legal here with the same flags.
+   */
+  bool isLegalMove(const Move & move);
+
+  /** Builds a move with the flags implied by the board (castle, en passant, double push, promotion).
+   *  @param from: The source square index.
+   *  @param to: The destination square index.
+   *  @param promotion: Promotion piece symbol, used only if a pawn reaches the last rank.
+   *  @return The move, whether or not it is legal.
+   */
+  Move createMove(const int from, const int to, const char promotion = 'q') const;
+
+  /** Checks if a move captures a piece, including en passant. */
+  bool isCapture(const Move & move) const;
+
+  /** Static exchange evaluation: plays out the captures on the move's destination square, each
+   *  side recapturing with its least valuable attacker and free to stop when that is better.
+   *  Attackers are found from the square outwards, so a slider behind a piece that has captured
+   *  joins in. Pins and checks are ignored.
+   *  @param move: A capture, its piece values are those of pieceValue().
+   *  @return The material the side to move wins with the exchange in centipawns, negative if it loses.
+   */
+  int staticExchange(const Move & move) const;
+
+  /** Makes a legal move without printing, saving what is needed to take it back.
+   *  @param move: The move to make, usually from generateLegalMoves().
+   *  @param undo: Receives the state needed by undoMove().
+   */
+  void doMove(const Move & move, MoveUndo & undo);
+
+  /** Takes back a move made with doMove(), restoring the exact previous state.
+   *  @param move: The move passed to doMove().
+   *  @param undo: The state filled in by doMove().
+   */
+  void undoMove(const Move & move, const MoveUndo & undo);
+
+  /** Passes the turn without moving, for the search's null-move pruning. It is not a chess move:
+   *  the side to move must not be in check, and it is taken back with undoNullMove() before any
+   *  other move is taken back. No position before it counts as a repetition after it.
+   *  @param undo: Receives the state needed by undoNullMove().
+   */
+  void doNullMove(MoveUndo & undo);
+
+  /** Takes back a doNullMove(). */
+  void undoNullMove(const MoveUndo & undo);
+
+  /** Makes a legal move permanently without printing, e.g. to play the engine's choice.
+   *  The move is recorded in the game history like a submitted one.
+   *  @param move: The move to make, usually from generateLegalMoves().
+   */
+  void makeMove(const Move & move);
+
+  /** Records in the game history a move made earlier with doMove(), e.g. a ponder move the
+   *  opponent went on to play. A search may be running on the board, so the position after the
+   *  move is passed in rather than read from the board.
+   *  @param move: The move, played from the position at the history's cursor.
+   *  @param position: The position after the move.
+   *  @param positionKey: Its Zobrist key.
+   */
+  void recordMadeMove(const Move & move, const FenPosition & position, const uint64_t positionKey);
+
+  /**
+   * Game history. Moves played with submitMove() or makeMove() since the state was loaded can be
+   * taken back, played again and jumped between. A game that has ended keeps its final position.
    */
-  void submitMove(const char* sourceSquare, const char* destinationSquare);  
+
+  /** Takes back the last move of the game, it can be played again with redoGameMove().
+   *  @return False if the game is at its first position.
+   */
+  bool undoGameMove();
+
+  /** Plays again a move taken back with undoGameMove() or seekGamePly().
+   *  @return False if no move was taken back.
+   */
+  bool redoGameMove();
+
+  /** Sets the board to the position of a ply of the game, from 0 for the loaded position to the
+   *  length of the history. Loads the nearest snapshot before it and replays the moves from there.
+   *  Submitting a move at an earlier ply drops the moves after it.
+   *  @return False if the ply is out of range, the board is then unchanged.
+   */
+  bool seekGamePly(const int ply);
+
+  /** Gets the moves and snapshots of the game. */
+  const GameHistory & getHistory() const { return history; }
+
+  /** Checks if the game has ended by checkmate, stalemate or a draw rule at the current position. */
+  bool isGameFinished() const { return isGameOver; }
+
+  /** Gets the FEN symbol of the piece on a square, uppercase for White.
+   *  @param square: The square index (row * 8 + col).
+   *  @return The FEN character, or '\0' if the square is empty.
+   */
+  char getPieceSymbol(const int square) const;
+
+  /** Gets the colour of the player to move. */
+  Colour getSideToMove() const { return colour; }
+
+  /** Gets the en passant target square index, or -1 if the last move was not a double pawn push. */
+  int getEnPassantSquare() const { return enPassantSquare; }
+
+  /** Gets the Zobrist key of the current position, maintained incrementally. */
+  uint64_t getHashKey() const { return hashKey; }
+
+  /** Gets the Zobrist key of the pawns alone, maintained incrementally, for caching evaluation
+   *  terms that depend only on them.
+   */
+  uint64_t getPawnKey() const { return pawnKey; }
+
+  /** Gets the square index of a king, or -1 if the colour has no king on the board. */
+  int getKingSquare(const Colour kingColour) const { return findKing(kingColour); }
+
+  /** Checks if the player to move is in check. */
+  bool isSideToMoveInCheck() { return isKingInCheck(colour); }
+
+  /** Checks if the move just made gives check, without scanning the whole board.
+   *  Only the moved piece, sliders behind the squares it emptied (the captured pawn's square too
+   *  for en passant) and a castling rook can give check, so only those are looked at.
+   *  @param move: The move just made with doMove() or submitMove().
+   *  @return The same as isSideToMoveInCheck().
+   */
+  bool lastMoveGivesCheck(const Move & move) const;
+
+  /** Counts earlier occurrences of the current position since the last irreversible move.
+   *  Only every second hash in the history can match (same side to move), and the scan stops
+   *  at the last capture or pawn move, so the cost is O(halfmove clock).
+   *  @return 0 if the position is new, 2 or more means threefold repetition.
+   */
+  int getRepetitionCount() const;
+
+  /** Checks for a draw by threefold repetition or the fifty-move rule.
+   *  @return True if either draw rule applies to the current position.
+   */
+  bool isDrawByRule() const { return halfmoveClock >= 100 || getRepetitionCount() >= 2; }
+
+  /** Checks if neither side can possibly checkmate: bare kings, or a single knight or bishop
+   *  against a bare king.
+   */
+  bool hasInsufficientMaterial() const;
+
+  /** Checks if a side has a piece other than its king and pawns. Without one, zugzwang is common. */
+  bool hasNonPawnMaterial(const Colour side) const;
+
+  /** Gets the number of plies since the last capture or pawn move. */
+  int getHalfmoveClock() const { return halfmoveClock; }
+
+  /** Gets the FEN fullmove number, incremented after each Black move. */
+  int getFullmoveNumber() const { return fullmoveNumber; }
+
+  /** Attaches an evaluation network. Its accumulators are then updated from the pieces each
+   *  doMove() takes off and puts on, and undoMove() steps back to the ones saved before the move.
+   *  @param _network: The network, it must outlive the board; nullptr to detach it.
+   */
+  void setNetwork(const Network* _network);
+
+  /** Gets the attached network, or nullptr. */
+  const Network* getNetwork() const { return network; }
+
+  /** Scores the current position with the attached network, which must be set.
+   *  @return Score in centipawns, positive if the side to move is better.
+   */
+  int evaluateNetwork() const { return network->evaluate(getAccumulator(), colour); }
+
+  /** Gets the accumulators of the current position, only meaningful with a network attached. */
+  const Accumulator & getAccumulator() const { return accumulators[gamePly & (ACCUMULATOR_HISTORY_SIZE - 1)]; }
   
 protected:
-  /** Converts the FEN string to the board array.
-   *  Sets up the board and updates the current player's colour based on the FEN string.
-   *  @param fen: The FEN string representing the board state.
+  /** Converts a parsed FEN position to the board array.
+   *  Sets up the board, the current player's colour, castling rights, en passant square and clocks.
+   *  @param position: The position decoded by parseFen().
    */
-  void boardToArray(const char* fen);
+  void boardToArray(const FenPosition & position);
 
   /**
    * Functions only accessible to Pieces class via abstract Class IChessBoardActions: 
@@ -73,7 +321,7 @@ protected:
 
   /** Checks if a given position on the board is empty.
    *  @param pos: Array containing the position (row, column) to check.
-   *  @return True if the position is empty (nullptr), false if it contains a piece.
+   *  @return True if the position is empty, false if it contains a piece.
    */
   bool isPosEmpty(const int pos[2]) const override;
 
@@ -99,7 +347,7 @@ protected:
   bool doesMoveCauseCheck(const int sourcePos[2], int destinationPos[2], Colour colour) override;
   
   /** Moves a piece from the source position to the destination position.
-   *  Handles piece capture if the destination contains an opponent's piece.
+   *  Handles piece capture if the destination contains an opponent's piece, and marks the piece as moved.
    *  @param sourcePos: Array containing the source position (row, column).
    *  @param destinationPos: Array containing the destination position (row, column).
    */
@@ -110,6 +358,57 @@ protected:
    *  @return True if the king is in check, false otherwise.
    */
   bool isKingInCheck(const Colour kingColour) override;
+
+  /** Checks if any piece of a colour attacks a position.
+   *  Knights, kings and pawns are found with the compile time tables in AttackTables.h,
+   *  rooks, bishops and queens by walking the eight lines out from the position.
+   *  @param pos: Array containing the position (row, column) to check.
+   *  @param attackerColour: The colour of the attacking pieces.
+   *  @return True if the position is attacked.
+   */
+  bool isSquareAttacked(const int pos[2], const Colour attackerColour) const;
+
+  /** Checks if a piece of the given type and colour stands on any square of a set.
+   *  @param squares: Set of square indexes, as stored in AttackTables.h.
+   *  @param symbol: The lowercase FEN symbol of the piece type.
+   *  @param pieceColour: The colour of the piece.
+   */
+  bool isLeaperOnSquares(uint64_t squares, const char symbol, const Colour pieceColour) const;
+
+  /** Finds the square index of a king, or -1 if the colour has no king on the board. */
+  int findKing(const Colour kingColour) const;
+
+  /** Walks from a square towards another along their row, column or diagonal.
+   *  @param from: The square index to start from, not itself looked at.
+   *  @param through: A square index giving the direction, the walk continues past it.
+   *  @return The first occupied square index, or -1 if the squares are not on a line or none is occupied.
+   */
+  int firstPieceOnLine(const int from, const int through) const;
+
+  /** Checks if the piece on a square attacks a target square, sliders only through empty squares.
+   *  @param square: The square index of the piece, an empty square attacks nothing.
+   *  @param target: The attacked square index.
+   */
+  bool doesPieceAttack(const int square, const int target) const;
+
+  /** Checks if emptying a square opened a line from an attacker's slider to a king.
+   *  @param kingSquare: The square index of the king.
+   *  @param vacated: The square index that has just been emptied.
+   *  @param attackerColour: The colour of the slider.
+   */
+  bool isDiscoveredAttack(const int kingSquare, const int vacated, const Colour attackerColour) const;
+
+  /** Checks if a position is the square a pawn can capture en passant on.
+   *  @param pos: Array containing the position (row, column) to check.
+   *  @return True if the last move was a double pawn push over this square.
+   */
+  bool isEnPassantTarget(const int pos[2]) const override { return enPassantSquare == toSquare(pos[0], pos[1]); }
+
+  /** Checks if the piece on a position has moved since the board state was loaded.
+   *  @param pos: Array containing the position (row, column) of a piece.
+   *  @return True if the piece has moved, e.g. a king that can no longer castle.
+   */
+  bool hasPieceMoved(const int pos[2]) const override { return mailbox[toSquare(pos[0], pos[1])] & PIECE_MOVED; }
     
   /** Sets the availability of castling in a specific direction.
    *  @param index: The index representing the castling direction.
@@ -137,11 +436,11 @@ protected:
   void rowColToString(char * square, const int position[2]) const override;
   
 private:
-  /** Each element points to a chess piece or is nullptr for an empty square. */
-  Pieces* piecesBoard[8][8];
+  /** One piece code per square index (row * 8 + col), 0 for an empty square. */
+  uint8_t mailbox[64];
 
   /** Enum Colour of the player who is currently to move, White or Black. */
-  Colour colour;
+  Colour colour = White;
 
   /** Array storing the availability of castling for both players and both sides.
    *  Index 0 and 1 correspond to white's king-side and queen-side castling.
@@ -153,11 +452,134 @@ private:
    *  Set to true when the game reaches checkmate or stalemate.
    */
   bool isGameOver = false;
+
+  /** Zobrist key of the current position, see Zobrist.h. */
+  uint64_t hashKey = 0;
+
+  /** XOR of the piece keys of the pawns. */
+  uint64_t pawnKey = 0;
+
+  /** Moves of the game since the state was loaded, with snapshots for seekGamePly(). */
+  GameHistory history;
+
+  /** Square a pawn can capture en passant on, or -1 if the last move was not a double pawn push. */
+  int enPassantSquare = -1;
+
+  /** Number of plies since the last capture or pawn move, for the fifty-move rule. */
+  int halfmoveClock = 0;
+
+  /** FEN fullmove number, starts at 1 and is incremented after each Black move. */
+  int fullmoveNumber = 1;
+
+  /** Size of the position hash ring buffer. Must be a power of two larger than the 100 plies
+   *  of the fifty-move rule plus the deepest search line, so no needed entry is overwritten.
+   */
+  static const int HASH_HISTORY_SIZE = 256;
+
+  /** Ring buffer of position hashes indexed by gamePly, the current position is at gamePly. */
+  uint64_t hashHistory[HASH_HISTORY_SIZE];
+
+  /** Number of plies played since the state was loaded. */
+  int gamePly = 0;
+
+  /** Size of the accumulator ring buffer, a power of two larger than the deepest line of moves
+   *  that is taken back, so the accumulators of every position on it are still there.
+   */
+  static const int ACCUMULATOR_HISTORY_SIZE = 128;
+
+  /** The attached evaluation network, or nullptr. */
+  const Network* network = nullptr;
+
+  /** Ring buffer of accumulators indexed by gamePly, only allocated while a network is attached. */
+  std::vector<Accumulator> accumulators;
+
+  /** Pieces the move being made has taken off and put on, filled by movePiece() and doMove(). */
+  FeatureChanges featureChanges;
+
+  /** Computes the accumulators of the current position from the move just made.
+   *  @param movedPiece: The piece code of the moving piece before the move.
+   *  @param move: The move just made.
+   */
+  void updateAccumulators(const uint8_t movedPiece, const Move & move);
+
+  /** Computes the accumulators of the current position from scratch. */
+  void refreshAccumulators();
+
+  /** Loads a position without touching the game history, setPosition() without the reset. */
+  void loadPosition(const FenPosition & position);
+
+  /** Records a move just made with doMove() in the game history, with a snapshot when one is due. */
+  void recordGameMove(const Move & move);
+
+  /** Updates the clocks and records the new position hash after a move.
+   *  @param irreversible: True for captures and pawn moves, which reset the halfmove clock.
+   */
+  void recordMove(const bool irreversible);
+
+  /** Recomputes hashKey from scratch, used after a new state is loaded. */
+  void computeHashKey();
+
+  /** XORs the key of the piece on a square into hashKey, adding or removing it from the hash,
+   *  and into pawnKey for a pawn.
+   */
+  void togglePieceKey(const int row, const int col);
   
-  /** Clears the chessboard, deallocating all pieces.
-   *  Iterates over the board and deletes any dynamically allocated piece, setting pointers to nullptr.
+  /** Clears the chessboard, setting every square to 0. */
+  void clearBoard();
+
+  /** Gets the piece object with the move rules for a piece code.
+   *  @param code: A piece code from the mailbox.
+   *  @return The piece object, or nullptr for an empty square.
+   */
+  const Pieces* pieceForCode(const uint8_t code) const;
+
+  /** Gets the piece object for the piece on a square index, or nullptr for an empty square. */
+  const Pieces* pieceAt(const int square) const { return pieceForCode(mailbox[square]); }
+
+  /** Generates the legal moves of a colour to a set of destination squares.
+   *  Each piece only tries the destinations it could reach, so leapers and pawns look at a
+   *  handful of squares instead of all 64.
+   *  @param moves: Cleared and filled with the moves.
+   *  @param side: The colour to move.
+   *  @param targets: Destination squares for pieces other than pawns, one bit per square index.
+   *  @param pawnTargets: Destination squares for pawns.
+   *  @param stopAtFirst: Return as soon as one legal move is found.
+   *  @return True if at least one legal move was found.
    */
-  void clearBoard();  
+  bool generateMoves(MoveList & moves, const Colour side, uint64_t targets, uint64_t pawnTargets,
+		     const bool stopAtFirst);
+
+  /** The colour specialised code behind generateMoves(), doesMoveCauseCheck(), isKingInCheck()
+   *  and isSquareAttacked(). Those pick the instance once, so the loops below them test no
+   *  colour at run time and call the piece rules without virtual dispatch.
+   */
+  template<Colour Side>
+  bool generateMovesFor(MoveList & moves, uint64_t targets, uint64_t pawnTargets, const bool stopAtFirst);
+
+  /** Checks a move against the rules of the piece of colour Side with code code, on its own. */
+  template<Colour Side>
+  bool isPseudoLegalFor(const uint8_t code, const int sourcePos[2], const int destinationPos[2]);
+
+  template<Colour Side>
+  bool leavesKingInCheck(const int sourcePos[2], const int destinationPos[2]);
+
+  template<Colour KingColour>
+  bool isKingInCheckFor();
+
+  template<Colour Attacker>
+  bool isSquareAttackedBy(const int pos[2]) const;
+
+  /** Gets the set of squares occupied by a colour, one bit per square index. */
+  uint64_t occupiedBy(const Colour side) const;
+
+  /** Finds the least valuable piece of a colour attacking a square, for staticExchange().
+   *  @param target: The square index attacked.
+   *  @param side: The colour of the attacker.
+   *  @param occupied: The pieces still on the board, one bit per square index; the others are
+   *  ignored and sliders see through them.
+   *  @return The attacker's square index, or -1 if there is none.
+   */
+  int leastValuableAttacker(const int target, const Colour side, const uint64_t occupied) const;
 
   /** Checks if a player can escape from check.
    *  Evaluates if any move can remove the king from check.
@@ -188,43 +610,51 @@ private:
    * @param sourceSquare The source square in string format (e.g., "E2").
    * @return true if there is a piece at the start position, false otherwise.
    */
-  bool isValidStartPosition(Pieces* startPosition, const char* sourceSquare);
+  bool isValidStartPosition(const Pieces* startPosition, const char* sourceSquare);
 
   /**
    * Checks if it is the correct turn for the piece at the start position.
    * @param startPosition Pointer to the piece at the start position.
    * @return true if it is the correct turn for the piece, false otherwise.
    */
-  bool isValidTurn(Pieces* startPosition);
+  bool isValidTurn(const Pieces* startPosition);
+
+  /**
+   * Runs the submitMove() checks on a move and plays it if it is legal.
+   * @param move The move with its flags set by createMove().
+   * @param sourceSquare The source square in string format (e.g., "E2"), used in messages.
+   * @param destinationSquare The destination square in string format (e.g., "E4"), used in messages.
+   */
+  void playMove(const Move & move, const char* sourceSquare, const char* destinationSquare);
 
   /**
    * Validates if the move from the source position to the destination position is valid.
    * @param startPosition Pointer to the piece at the start position.
-   * @param sourcePos Array representing the source position.
-   * @param destinationPos Array representing the destination position.
+   * @param move The move to validate.
    * @param destinationSquare The destination square in string format (e.g., "E4").
    * @return true if the move is valid, false otherwise.
    */
-  bool isValidMove(Pieces* startPosition, int sourcePos[], int destinationPos[], const char* destinationSquare);
+  bool isValidMove(const Pieces* startPosition, const Move & move, const char* destinationSquare);
 
   /**
-   * Executes the move from the source position to the destination position.
+   * Prints and executes the move, reporting any captured piece.
    * @param startPosition Pointer to the piece at the start position.
-   * @param sourcePos Array representing the source position.
-   * @param destinationPos Array representing the destination position.
+   * @param move The move to execute.
    */
-  void executeMove(Pieces* startPosition, int sourcePos[], int destinationPos[]);
+  void executeMove(const Pieces* startPosition, const Move & move);
 
   /**
    * Checks if the game is over due to checkmate or stalemate.
+   * @param inCheck Whether the player to move is in check.
    * @return true if the game is over, false otherwise.
    */
-  bool checkGameOver();
+  bool checkGameOver(const bool inCheck);
 
   /**
    * Performs checks after a move is made, such as check, checkmate, or stalemate.
+   * @param move The move just made.
    */
-  void postMoveChecks();
+  void postMoveChecks(const Move & move);
 };
 
 #endif // CHESSBOARD_H
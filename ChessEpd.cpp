@@ -0,0 +1,382 @@
+#include"ChessBoard.h"
+#include"Pgn.h"
+#include"Search.h"
+
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fstream>
+#include<iostream>
+#include<sstream>
+#include<string>
+#include<thread>
+#include<vector>
+
+using std::cout;
+
+namespace {
+  /** One line of an EPD file: four FEN fields followed by operations such as bm, am and id. */
+  struct EpdPosition {
+    std::string fen;
+    std::string id;
+    /** Operands of the bm and am operations, in SAN. */
+    std::vector<std::string> bestMoves, avoidMoves;
+  };
+
+  /** Outcome of searching one position. */
+  struct EpdResult {
+    std::string error;
+    Move move;
+    bool solved = false;
+    /** Time and nodes from the start of the search to the iteration from which the best move
+     *  stayed a solution, only meaningful if solved.
+     */
+    double solutionSeconds = 0.0;
+    uint64_t solutionNodes = 0;
+    int depth = 0;
+    int score = 0;
+    uint64_t nodes = 0;
+    double seconds = 0.0;
+  };
+
+  struct Settings {
+    SearchLimits limits;
+    unsigned threads = 1;
+    size_t hashMegabytes = 16;
+    MemoryOptions memory;
+    SearchOptions options;
+    bool json = false;
+  };
+
+  /** Splits an operand list on spaces, dropping the quotes of a string operand. */
+  std::vector<std::string> splitOperands(const std::string & operands) {
+    std::vector<std::string> words;
+    std::istringstream in(operands);
+    std::string word;
+    while (in >> word) {
+      if (word.size() >= 2 && word.front() == '"' && word.back() == '"') {
+	word = word.substr(1, word.size() - 2);
+      }
+      words.push_back(word);
+    }
+    return words;
+  }
+
+  /** Parses an EPD line.
+   *  @return False if the line has fewer than four fields.
+   */
+  bool parseEpd(const std::string & line, EpdPosition & position) {
+    std::istringstream in(line);
+    std::string fields[4];
+    for (std::string & field : fields) {
+      if (!(in >> field)) {
+	return false;
+      }
+    }
+    position.fen = fields[0] + " " + fields[1] + " " + fields[2] + " " + fields[3];
+
+    std::string rest;
+    std::getline(in, rest);
+    size_t start = 0;
+    while (start < rest.size()) {
+      size_t end = rest.find(';', start);
+      if (end == std::string::npos) {
+	end = rest.size();
+      }
+      std::string operation = rest.substr(start, end - start);
+      start = end + 1;
+      std::vector<std::string> words = splitOperands(operation);
+      if (words.empty()) {
+	continue;
+      }
+      const std::string & opcode = words[0];
+      if (opcode == "bm") {
+	position.bestMoves.assign(words.begin() + 1, words.end());
+      } else if (opcode == "am") {
+	position.avoidMoves.assign(words.begin() + 1, words.end());
+      } else if (opcode == "id") {
+	// The id is one string operand that may hold spaces, taken between its quotes
+	size_t open = operation.find('"'), close = operation.rfind('"');
+	position.id = open != close ? operation.substr(open + 1, close - open - 1) : (words.size() > 1 ? words[1] : "");
+      }
+    }
+    return true;
+  }
+
+  /** Converts SAN moves to moves of the board.
+   *  @return False if one of them is not a legal move, its text is then put in bad.
+   */
+  bool toMoves(ChessBoard & board, const std::vector<std::string> & sans, std::vector<Move> & moves,
+	       std::string & bad) {
+    for (const std::string & san : sans) {
+      Move move = sanToMove(board, san.c_str());
+      if (move.isNull()) {
+	bad = san;
+	return false;
+      }
+      moves.push_back(move);
+    }
+    return true;
+  }
+
+  /** Checks if a move solves a position: it is one of the best moves and none of the moves to avoid. */
+  bool isSolution(const Move & move, const std::vector<Move> & bestMoves, const std::vector<Move> & avoidMoves) {
+    for (const Move & avoid : avoidMoves) {
+      if (move == avoid) {
+	return false;
+      }
+    }
+    if (bestMoves.empty()) {
+      return !move.isNull();
+    }
+    for (const Move & best : bestMoves) {
+      if (move == best) {
+	return true;
+      }
+    }
+    return false;
+  }
+
+  /** Searches one position with the worker's board and search. */
+  EpdResult runPosition(const EpdPosition & position, ChessBoard & board, Search & search,
+			const SearchLimits & limits) {
+    EpdResult result;
+    FenError error = board.setFen(position.fen.c_str());
+    if (error != FenOk) {
+      result.error = fenErrorString(error);
+      return result;
+    }
+    std::vector<Move> bestMoves, avoidMoves;
+    std::string bad;
+    if (!toMoves(board, position.bestMoves, bestMoves, bad) || !toMoves(board, position.avoidMoves, avoidMoves, bad)) {
+      result.error = "illegal move " + bad;
+      return result;
+    }
+    if (bestMoves.empty() && avoidMoves.empty()) {
+      result.error = "no bm or am";
+      return result;
+    }
+
+    // The solution time is that of the first iteration of the run of solving iterations that ends the search
+    auto start = std::chrono::steady_clock::now();
+    bool solving = false;
+    search.setIterationCallback([&](const SearchResult & iteration) {
+      bool solves = isSolution(iteration.bestMove, bestMoves, avoidMoves);
+      if (solves && !solving) {
+	result.solutionSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.solutionNodes = search.getStats().nodes;
+      }
+      solving = solves;
+    });
+    search.clear();
+    SearchResult found = search.search(limits);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    search.setIterationCallback(nullptr);
+
+    result.move = found.bestMove;
+    result.depth = found.depth;
+    result.score = found.score;
+    result.nodes = search.getStats().nodes;
+    result.solved = isSolution(found.bestMove, bestMoves, avoidMoves);
+    if (result.solved && !solving) {
+      // Only an interrupted iteration found it
+      result.solutionSeconds = result.seconds;
+      result.solutionNodes = result.nodes;
+    }
+    return result;
+  }
+
+  /** Writes a string as a JSON string literal. */
+  void printJsonString(const std::string & text) {
+    putchar('"');
+    for (char c : text) {
+      if (c == '"' || c == '\\') {
+	putchar('\\');
+      }
+      putchar(c);
+    }
+    putchar('"');
+  }
+
+  void printResult(const int index, const EpdPosition & position, const EpdResult & result, const bool json) {
+    char move[6];
+    result.move.toString(move);
+    if (json) {
+      printf("{\"index\":%d,\"id\":", index);
+      printJsonString(position.id);
+      if (!result.error.empty()) {
+	printf(",\"error\":");
+	printJsonString(result.error);
+	printf("}\n");
+	return;
+      }
+      printf(",\"move\":\"%s\",\"solved\":%s,\"solutionSeconds\":%.4f,\"solutionNodes\":%llu,\"depth\":%d,"
+	     "\"score\":%d,\"nodes\":%llu,\"seconds\":%.4f}\n", move, result.solved ? "true" : "false",
+	     result.solved ? result.solutionSeconds : 0.0,
+	     static_cast<unsigned long long>(result.solved ? result.solutionNodes : 0), result.depth,
+	     result.score, static_cast<unsigned long long>(result.nodes), result.seconds);
+      return;
+    }
+    if (!result.error.empty()) {
+      printf("%d\t%s\terror\t%s\n", index, position.id.c_str(), result.error.c_str());
+      return;
+    }
+    printf("%d\t%s\t%s\t%s", index, position.id.c_str(), result.solved ? "solved" : "failed", move);
+    if (result.solved) {
+      printf("\tafter %.3fs %llu nodes", result.solutionSeconds, static_cast<unsigned long long>(result.solutionNodes));
+    }
+    printf("\tdepth: %d\tscore: %d\tnodes: %llu\ttime: %.3fs\n", result.depth, result.score,
+	   static_cast<unsigned long long>(result.nodes), result.seconds);
+  }
+
+  bool parsePages(const char* name, HugePages & pages) {
+    for (HugePages candidate : {HugePagesOff, HugePagesTransparent, HugePagesExplicit}) {
+      if (strcmp(name, LargeMemory::hugePagesName(candidate)) == 0) {
+	pages = candidate;
+	return true;
+      }
+    }
+    return false;
+  }
+
+  bool parseNuma(const char* name, NumaPolicy & numa) {
+    if (strcmp(name, "local") == 0) {
+      numa = NumaFirstTouch;
+    } else if (strcmp(name, "interleave") == 0) {
+      numa = NumaInterleave;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  void usage() {
+    cout << "Usage: epd <suite file> [options]\n"
+	 << "  Each line of the suite is an EPD record with a bm or am operation, e.g.\n"
+	 << "  2rr3k/pp3pp1/1nnqbN1p/3pN3/2pP4/2P3Q1/PPB4P/R4RK1 w - - bm Qg6; id \"WAC.001\";\n"
+	 << "Options:\n"
+	 << "  --nodes N          nodes per position (100000)\n"
+	 << "  --time MS          milliseconds per position instead of a node limit\n"
+	 << "  --depth N          depth limit per position\n"
+	 << "  --threads N        positions searched at once (1)\n"
+	 << "  --hash MB          transposition table of each thread (16)\n"
+	 << "  --pages P          pages of the tables: off, transparent or explicit (transparent)\n"
+	 << "  --numa P           placement of the tables: local or interleave (local)\n"
+	 << "  --no-null-move     no null-move pruning\n"
+	 << "  --no-lmr           no late move reductions\n"
+	 << "  --no-futility      no futility pruning\n"
+	 << "  --no-reverse-futility  no reverse futility pruning\n"
+	 << "  --json             one JSON object per position and one for the suite\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    usage();
+    return 1;
+  }
+  Settings settings;
+  settings.limits.nodes = 100000;
+  for (int i = 2; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--nodes") == 0 && hasValue) settings.limits.nodes = strtoull(argv[++i], nullptr, 10);
+    else if (strcmp(argv[i], "--time") == 0 && hasValue) {
+      settings.limits.moveTimeMs = atoi(argv[++i]);
+      settings.limits.nodes = 0;
+    }
+    else if (strcmp(argv[i], "--depth") == 0 && hasValue) settings.limits.depth = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && hasValue) settings.threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--hash") == 0 && hasValue) settings.hashMegabytes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--pages") == 0 && hasValue && parsePages(argv[i + 1], settings.memory.hugePages)) i++;
+    else if (strcmp(argv[i], "--numa") == 0 && hasValue && parseNuma(argv[i + 1], settings.memory.numa)) i++;
+    else if (strcmp(argv[i], "--no-null-move") == 0) settings.options.nullMove = false;
+    else if (strcmp(argv[i], "--no-lmr") == 0) settings.options.lateMoveReductions = false;
+    else if (strcmp(argv[i], "--no-futility") == 0) settings.options.futility = false;
+    else if (strcmp(argv[i], "--no-reverse-futility") == 0) settings.options.reverseFutility = false;
+    else if (strcmp(argv[i], "--json") == 0) settings.json = true;
+    else {
+      usage();
+      return 1;
+    }
+  }
+  if (settings.threads < 1 || settings.limits.depth < 1 || settings.hashMegabytes < 1) {
+    usage();
+    return 1;
+  }
+
+  std::ifstream file(argv[1]);
+  if (!file) {
+    cout << "Cannot open " << argv[1] << "\n";
+    return 1;
+  }
+  std::vector<EpdPosition> positions;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    EpdPosition position;
+    if (!parseEpd(line, position)) {
+      cout << "Bad EPD line: " << line << "\n";
+      return 1;
+    }
+    if (position.id.empty()) {
+      position.id = std::to_string(positions.size() + 1);
+    }
+    positions.push_back(position);
+  }
+
+  // Workers take the next position, results are printed in input order
+  std::vector<EpdResult> results(positions.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    // Each worker maps its own table, so with first touch its pages land on the worker's node
+    ChessBoard board;
+    Search search(board, settings.hashMegabytes, settings.memory);
+    search.setSearchOptions(settings.options);
+    for (size_t i = next++; i < positions.size(); i = next++) {
+      results[i] = runPosition(positions[i], board, search, settings.limits);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < settings.threads; t++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  int solved = 0, errors = 0;
+  uint64_t nodes = 0;
+  double solutionSeconds = 0.0;
+  for (size_t i = 0; i < positions.size(); i++) {
+    printResult(static_cast<int>(i + 1), positions[i], results[i], settings.json);
+    errors += !results[i].error.empty();
+    solved += results[i].solved;
+    nodes += results[i].nodes;
+    if (results[i].solved) {
+      solutionSeconds += results[i].solutionSeconds;
+    }
+  }
+  double nps = seconds > 0 ? nodes / seconds : 0.0;
+  if (settings.json) {
+    printf("{\"suite\":");
+    printJsonString(argv[1]);
+    printf(",\"positions\":%zu,\"errors\":%d,\"solved\":%d,\"meanSolutionSeconds\":%.4f,\"nodes\":%llu,"
+	   "\"seconds\":%.3f,\"nps\":%.0f,\"threads\":%u,\"nodeLimit\":%llu,\"timeLimitMs\":%lld,\"depthLimit\":%d}\n",
+	   positions.size(), errors, solved, solved > 0 ? solutionSeconds / solved : 0.0,
+	   static_cast<unsigned long long>(nodes), seconds, nps, settings.threads,
+	   static_cast<unsigned long long>(settings.limits.nodes), static_cast<long long>(settings.limits.moveTimeMs),
+	   settings.limits.depth);
+  } else {
+    printf("%d / %zu solved, %d errors, mean time to solution %.3fs, %llu nodes, %.3fs, %.0f nodes/s, %u threads\n",
+	   solved, positions.size(), errors, solved > 0 ? solutionSeconds / solved : 0.0,
+	   static_cast<unsigned long long>(nodes), seconds, nps, settings.threads);
+  }
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include"ChessBoard.h"
+#include"MateSolver.h"
+
+#include<atomic>
+#include<chrono>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fstream>
+#include<iostream>
+#include<string>
+#include<thread>
+#include<vector>
+
+using std::cout;
+
+namespace {
+  /** One line of the batch file: "<FEN>" or "<FEN>;<N>" to override the default N. */
+  struct Puzzle {
+    std::string fen;
+    int maxMoves;
+  };
+
+  /** Solves one puzzle and formats its report line. */
+  std::string solvePuzzle(const Puzzle & puzzle, const int index, const bool checksOnly) {
+    char buffer[256];
+    ChessBoard board;
+    FenError error = board.setFen(puzzle.fen.c_str());
+    if (error != FenOk) {
+      snprintf(buffer, sizeof(buffer), "%d\terror\t%s\n", index, fenErrorString(error));
+      return buffer;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    MateSolver solver(board, checksOnly);
+    MateResult result = solver.solve(puzzle.maxMoves);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::string report = std::to_string(index) + "\t";
+    if (result.mateIn == 0) {
+      report += "no mate in " + std::to_string(puzzle.maxMoves);
+    } else {
+      report += "mate in " + std::to_string(result.mateIn);
+      report += result.keyMoves.size() == 1 ? "\tunique" : "\tnot unique";
+      char move[6];
+      report += "\tkeys:";
+      for (const Move & key : result.keyMoves) {
+	key.toString(move);
+	report += std::string(" ") + move;
+      }
+      report += "\tline:";
+      for (const Move & lineMove : result.line) {
+	lineMove.toString(move);
+	report += std::string(" ") + move;
+      }
+    }
+    snprintf(buffer, sizeof(buffer), "\tnodes: %llu\ttime: %.3fs\n",
+	     static_cast<unsigned long long>(result.nodes), seconds);
+    return report + buffer;
+  }
+
+  void usage() {
+    cout << "Usage: mate <N> <batch file> [threads] [--checks]\n"
+	 << "  Each line of the batch file is a FEN, optionally followed by ;N to override N.\n"
+	 << "  --checks restricts every attacker move to checks (faster, misses quiet keys).\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+  int defaultMoves = atoi(argv[1]);
+  unsigned threadCount = std::thread::hardware_concurrency();
+  bool checksOnly = false;
+  for (int i = 3; i < argc; i++) {
+    if (strcmp(argv[i], "--checks") == 0) {
+      checksOnly = true;
+    } else {
+      threadCount = static_cast<unsigned>(atoi(argv[i]));
+    }
+  }
+  if (defaultMoves < 1 || threadCount < 1) {
+    usage();
+    return 1;
+  }
+
+  std::ifstream file(argv[2]);
+  if (!file) {
+    cout << "Cannot open " << argv[2] << "\n";
+    return 1;
+  }
+  std::vector<Puzzle> puzzles;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    Puzzle puzzle = {line, defaultMoves};
+    size_t separator = line.find(';');
+    if (separator != std::string::npos) {
+      puzzle.fen = line.substr(0, separator);
+      puzzle.maxMoves = atoi(line.c_str() + separator + 1);
+    }
+    puzzles.push_back(puzzle);
+  }
+
+  // Workers take the next unsolved puzzle, results are printed in input order
+  std::vector<std::string> reports(puzzles.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < puzzles.size(); i = next++) {
+      reports[i] = solvePuzzle(puzzles[i], static_cast<int>(i + 1), checksOnly);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < threadCount; t++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  for (const std::string & report : reports) {
+    cout << report;
+  }
+  printf("%zu puzzles, %u threads, %.3fs\n", puzzles.size(), threadCount, seconds);
+  return 0;
+}
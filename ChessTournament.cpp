@@ -0,0 +1,431 @@
+#include"ChessBoard.h"
+#include"Pgn.h"
+#include"Search.h"
+
+#include<atomic>
+#include<cmath>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<fstream>
+#include<iostream>
+#include<memory>
+#include<mutex>
+#include<string>
+#include<thread>
+#include<vector>
+
+using std::cout;
+
+namespace {
+  /** Balanced openings used when no suite is given, each is played with both colours. */
+  const char* DEFAULT_OPENINGS[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pppp1ppp/8/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R b KQkq - 1 2",
+    "rnbqkb1r/pppppppp/5n2/8/3P4/8/PPP1PPPP/RNBQKBNR w KQkq - 1 2",
+    "rnbqkbnr/ppp1pppp/8/3p4/2PP4/8/PP2PPPP/RNBQKBNR b KQkq - 0 2",
+    "rnbqkbnr/pppp1ppp/4p3/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pp1ppppp/2p5/8/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2",
+    "rnbqkbnr/pppppppp/8/8/2P5/8/PP1PPPPP/RNBQKBNR b KQkq - 0 1",
+  };
+
+  /** An engine configuration taking part in the match. */
+  struct Player {
+    std::string name;
+    OrderingOptions ordering;
+    /** Evaluate with the match's network instead of the handcrafted evaluation. */
+    bool network = false;
+  };
+
+  /** Match settings from the command line. */
+  struct Settings {
+    int games = 100;
+    unsigned threads = 1;
+    SearchLimits limits;
+    /** Clock of each player at the start of a game and the increment per move, 0 to play without clocks. */
+    int64_t clockMs = 0;
+    int64_t incrementMs = 0;
+    size_t hashMegabytes = 4;
+    int maxPlies = 400;
+    std::vector<std::string> openings;
+    const char* pgnPath = nullptr;
+    bool sprt = false;
+    double elo0 = 0.0, elo1 = 5.0, alpha = 0.05, beta = 0.05;
+    Player players[2];
+    /** Network of the players that use one, loaded once and shared by every game. */
+    std::unique_ptr<Network> network;
+  };
+
+  /** A finished game, from the point of view of the first player. */
+  struct Game {
+    int round = 0;
+    bool firstIsWhite = true;
+    std::string startFen;
+    std::vector<Move> moves;
+    const char* result = "*";
+    const char* termination = nullptr;
+    /** 1, 0.5 or 0 for the first player. */
+    double score = 0.5;
+    /** Least time either clock showed after a move, in milliseconds. */
+    double lowestClockMs = 0.0;
+  };
+
+  /** Running totals of the match for the first player. */
+  struct Tally {
+    int wins = 0, draws = 0, losses = 0;
+    int timeForfeits = 0;
+    double lowestClockMs = 0.0;
+
+    int games() const { return wins + draws + losses; }
+    double score() const { return games() == 0 ? 0.5 : (wins + 0.5 * draws) / games(); }
+
+    /** Per game variance of the score. */
+    double variance() const {
+      if (games() == 0) return 0.0;
+      double s = score();
+      return (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games();
+    }
+  };
+
+  double scoreToElo(const double score) {
+    if (score <= 0.0) return -999.0;
+    if (score >= 1.0) return 999.0;
+    return -400.0 * log10(1.0 / score - 1.0);
+  }
+
+  double eloToScore(const double elo) { return 1.0 / (1.0 + pow(10.0, -elo / 400.0)); }
+
+  /** Log-likelihood ratio of elo1 against elo0, using the normal approximation to the
+   *  trinomial (win/draw/loss) distribution of the game results.
+   */
+  double sprtLlr(const Tally & tally, const double elo0, const double elo1) {
+    double variance = tally.variance();
+    if (tally.games() == 0 || variance <= 0.0) {
+      return 0.0;
+    }
+    double s0 = eloToScore(elo0), s1 = eloToScore(elo1);
+    return tally.games() * (s1 - s0) * (2 * tally.score() - s0 - s1) / (2 * variance);
+  }
+
+  /** Parses a player: "default" or a comma separated list of nohash, nomvv, nokillers, nohistory and nnue. */
+  bool parsePlayer(const char* spec, Player & player) {
+    player.name = spec;
+    std::string token;
+    std::string list = std::string(spec) + ",";
+    for (char c : list) {
+      if (c != ',') {
+	token += c;
+	continue;
+      }
+      if (token == "nohash") player.ordering.hashMove = false;
+      else if (token == "nomvv") player.ordering.mvvLva = false;
+      else if (token == "nokillers") player.ordering.killers = false;
+      else if (token == "nohistory") player.ordering.history = false;
+      else if (token == "nnue") player.network = true;
+      else if (token != "default") return false;
+      token.clear();
+    }
+    return true;
+  }
+
+  /** Plays one game to the end, adjudicated by the ChessBoard rules. */
+  Game playGame(const Settings & settings, const std::string & opening, const int round, const bool firstIsWhite) {
+    Game game;
+    game.round = round;
+    game.firstIsWhite = firstIsWhite;
+    game.startFen = opening;
+
+    ChessBoard board;
+    board.setFen(opening.c_str());
+    if (settings.network) {
+      board.setNetwork(settings.network.get());
+    }
+    Search first(board, settings.hashMegabytes), second(board, settings.hashMegabytes);
+    first.setOrderingOptions(settings.players[0].ordering);
+    second.setOrderingOptions(settings.players[1].ordering);
+    first.setUseNetwork(settings.players[0].network);
+    second.setUseNetwork(settings.players[1].network);
+    Search* white = firstIsWhite ? &first : &second;
+    Search* black = firstIsWhite ? &second : &first;
+
+    // Result from White's point of view
+    double whiteScore = 0.5;
+    MoveList moves;
+    // Clocks in microseconds, indexed by Colour
+    int64_t clocks[2] = {settings.clockMs * 1000, settings.clockMs * 1000};
+    game.lowestClockMs = static_cast<double>(settings.clockMs);
+    while (true) {
+      board.generateLegalMoves(moves);
+      if (moves.empty()) {
+	if (board.isSideToMoveInCheck()) {
+	  whiteScore = board.getSideToMove() == White ? 0.0 : 1.0;
+	  game.termination = "checkmate";
+	} else {
+	  game.termination = "stalemate";
+	}
+	break;
+      }
+      if (board.getHalfmoveClock() >= 100) {
+	game.termination = "fifty-move rule";
+	break;
+      }
+      if (board.getRepetitionCount() >= 2) {
+	game.termination = "threefold repetition";
+	break;
+      }
+      if (board.hasInsufficientMaterial()) {
+	game.termination = "insufficient material";
+	break;
+      }
+      if (static_cast<int>(game.moves.size()) >= settings.maxPlies) {
+	game.termination = "move limit";
+	break;
+      }
+
+      Colour side = board.getSideToMove();
+      Search* mover = side == White ? white : black;
+      SearchLimits limits = settings.limits;
+      if (settings.clockMs > 0) {
+	limits.clock.remainingMs = clocks[side] / 1000;
+	limits.clock.incrementMs = settings.incrementMs;
+      }
+      auto start = SearchClock::now();
+      Move move = mover->search(limits).bestMove;
+      if (settings.clockMs > 0) {
+	clocks[side] -= std::chrono::duration_cast<std::chrono::microseconds>(SearchClock::now() - start).count();
+	if (clocks[side] < 1000 * game.lowestClockMs) {
+	  game.lowestClockMs = clocks[side] / 1000.0;
+	}
+	if (clocks[side] < 0) {
+	  whiteScore = side == White ? 0.0 : 1.0;
+	  game.termination = "time forfeit";
+	  break;
+	}
+	clocks[side] += settings.incrementMs * 1000;
+      }
+      game.moves.push_back(move);
+      board.makeMove(move);
+    }
+
+    game.result = whiteScore == 1.0 ? "1-0" : (whiteScore == 0.0 ? "0-1" : "1/2-1/2");
+    game.score = firstIsWhite ? whiteScore : 1.0 - whiteScore;
+    return game;
+  }
+
+  void printStatus(const Settings & settings, const Tally & tally) {
+    double score = tally.score();
+    double error = 1.96 * sqrt(tally.variance() / (tally.games() > 0 ? tally.games() : 1));
+    printf("Games %d: +%d =%d -%d  score %.1f%%  Elo %.1f [%.1f, %.1f]", tally.games(), tally.wins,
+	   tally.draws, tally.losses, 100.0 * score, scoreToElo(score), scoreToElo(score - error),
+	   scoreToElo(score + error));
+    if (settings.sprt) {
+      printf("  LLR %.2f [%.2f, %.2f]", sprtLlr(tally, settings.elo0, settings.elo1),
+	     log(settings.beta / (1 - settings.alpha)), log((1 - settings.beta) / settings.alpha));
+    }
+    if (settings.clockMs > 0) {
+      printf("  time forfeits %d, lowest clock %.1f ms", tally.timeForfeits, tally.lowestClockMs);
+    }
+    printf("\n");
+  }
+
+  /** Parses a time control of seconds with an optional increment, e.g. "1" or "2+0.05". */
+  bool parseTimeControl(const char* text, Settings & settings) {
+    char* end;
+    double seconds = strtod(text, &end);
+    double increment = 0.0;
+    if (*end == '+') {
+      increment = strtod(end + 1, &end);
+    }
+    if (*end != '\0' || seconds <= 0.0 || increment < 0.0) {
+      return false;
+    }
+    settings.clockMs = static_cast<int64_t>(seconds * 1000);
+    settings.incrementMs = static_cast<int64_t>(increment * 1000);
+    return true;
+  }
+
+  void usage() {
+    cout << "Usage: tournament [options] <player> <player>\n"
+	 << "  A player is \"default\" or a comma separated list of nohash, nomvv, nokillers, nohistory, nnue.\n"
+	 << "  --games N          games to play, in pairs with colours reversed (100)\n"
+	 << "  --threads N        games played at once (1)\n"
+	 << "  --nodes N          nodes per move\n"
+	 << "  --movetime MS      milliseconds per move (default 20 if no node limit or clock)\n"
+	 << "  --tc SEC[+INC]     clock per game in seconds, with an optional increment per move\n"
+	 << "  --hash MB          transposition table per engine (4)\n"
+	 << "  --max-plies N      adjudicate a draw after N plies (400)\n"
+	 << "  --openings FILE    one FEN per line, # for comments (built-in suite)\n"
+	 << "  --pgn FILE         stream finished games to FILE\n"
+	 << "  --nnue FILE        network of the nnue players (one built from the material values)\n"
+	 << "  --sprt ELO0 ELO1   stop when the SPRT with alpha = beta = 0.05 accepts a hypothesis\n";
+  }
+}
+
+int main(int argc, char* argv[]) {
+  Settings settings;
+  std::vector<const char*> playerSpecs;
+  const char* openingsPath = nullptr;
+  const char* networkPath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--games") == 0 && hasValue) settings.games = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--threads") == 0 && hasValue) settings.threads = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--nodes") == 0 && hasValue) settings.limits.nodes = atoll(argv[++i]);
+    else if (strcmp(argv[i], "--movetime") == 0 && hasValue) settings.limits.moveTimeMs = atoll(argv[++i]);
+    else if (strcmp(argv[i], "--tc") == 0 && hasValue) {
+      if (!parseTimeControl(argv[++i], settings)) {
+	usage();
+	return 1;
+      }
+    }
+    else if (strcmp(argv[i], "--hash") == 0 && hasValue) settings.hashMegabytes = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--max-plies") == 0 && hasValue) settings.maxPlies = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--openings") == 0 && hasValue) openingsPath = argv[++i];
+    else if (strcmp(argv[i], "--pgn") == 0 && hasValue) settings.pgnPath = argv[++i];
+    else if (strcmp(argv[i], "--nnue") == 0 && hasValue) networkPath = argv[++i];
+    else if (strcmp(argv[i], "--sprt") == 0 && i + 2 < argc) {
+      settings.sprt = true;
+      settings.elo0 = atof(argv[++i]);
+      settings.elo1 = atof(argv[++i]);
+    } else if (argv[i][0] != '-') playerSpecs.push_back(argv[i]);
+    else {
+      usage();
+      return 1;
+    }
+  }
+  if (playerSpecs.size() != 2 || settings.games < 1 || settings.threads < 1 ||
+      !parsePlayer(playerSpecs[0], settings.players[0]) || !parsePlayer(playerSpecs[1], settings.players[1])) {
+    usage();
+    return 1;
+  }
+  if (settings.limits.nodes == 0 && settings.limits.moveTimeMs == 0 && settings.clockMs == 0) {
+    settings.limits.moveTimeMs = 20;
+  }
+  if (settings.players[0].network || settings.players[1].network) {
+    settings.network.reset(new Network());
+    if (networkPath == nullptr) {
+      settings.network->setFromMaterial();
+    } else if (!settings.network->load(networkPath)) {
+      cout << "Cannot load network " << networkPath << "\n";
+      return 1;
+    }
+  }
+
+  if (openingsPath != nullptr) {
+    std::ifstream file(openingsPath);
+    if (!file) {
+      cout << "Cannot open " << openingsPath << "\n";
+      return 1;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+      if (line.empty() || line[0] == '#') {
+	continue;
+      }
+      ChessBoard check;
+      FenError error = check.setFen(line.c_str());
+      if (error != FenOk) {
+	cout << "Skipping opening \"" << line << "\": " << fenErrorString(error) << "\n";
+	continue;
+      }
+      settings.openings.push_back(line);
+    }
+  } else {
+    for (const char* fen : DEFAULT_OPENINGS) {
+      settings.openings.push_back(fen);
+    }
+  }
+  if (settings.openings.empty()) {
+    cout << "No openings\n";
+    return 1;
+  }
+
+  FILE* pgn = nullptr;
+  if (settings.pgnPath != nullptr && (pgn = fopen(settings.pgnPath, "w")) == nullptr) {
+    cout << "Cannot open " << settings.pgnPath << "\n";
+    return 1;
+  }
+
+  // Workers take the next game, finished games are tallied and streamed out under the lock
+  Tally tally;
+  std::mutex lock;
+  std::atomic<int> next(0);
+  std::atomic<bool> finished(false);
+  double lower = log(settings.beta / (1 - settings.alpha));
+  double upper = log((1 - settings.beta) / settings.alpha);
+
+  auto worker = [&]() {
+    for (int i = next++; i < settings.games && !finished; i = next++) {
+      const std::string & opening = settings.openings[(i / 2) % settings.openings.size()];
+      Game game = playGame(settings, opening, i + 1, i % 2 == 0);
+
+      std::lock_guard<std::mutex> guard(lock);
+      if (finished) {
+	return;
+      }
+      if (game.score == 1.0) tally.wins++;
+      else if (game.score == 0.0) tally.losses++;
+      else tally.draws++;
+      if (game.termination != nullptr && strcmp(game.termination, "time forfeit") == 0) {
+	tally.timeForfeits++;
+      }
+      if (tally.games() == 1 || game.lowestClockMs < tally.lowestClockMs) {
+	tally.lowestClockMs = game.lowestClockMs;
+      }
+
+      if (pgn != nullptr) {
+	PgnTags tags;
+	tags.event = "tournament";
+	tags.round = game.round;
+	tags.white = settings.players[game.firstIsWhite ? 0 : 1].name.c_str();
+	tags.black = settings.players[game.firstIsWhite ? 1 : 0].name.c_str();
+	tags.result = game.result;
+	tags.termination = game.termination;
+	writePgnGame(pgn, tags, game.startFen.c_str(), game.moves);
+	fflush(pgn);
+      }
+      if (tally.games() % 10 == 0) {
+	printStatus(settings, tally);
+      }
+      if (settings.sprt) {
+	double llr = sprtLlr(tally, settings.elo0, settings.elo1);
+	if (llr <= lower || llr >= upper) {
+	  finished = true;
+	}
+      }
+    }
+  };
+
+  printf("%s vs %s, %d games, %u threads, ", settings.players[0].name.c_str(),
+	 settings.players[1].name.c_str(), settings.games, settings.threads);
+  if (settings.clockMs > 0) {
+    printf("%.3f s + %.3f s per game\n", settings.clockMs / 1000.0, settings.incrementMs / 1000.0);
+  } else if (settings.limits.nodes != 0) {
+    printf("%llu nodes per move\n", static_cast<unsigned long long>(settings.limits.nodes));
+  } else {
+    printf("%lld ms per move\n", static_cast<long long>(settings.limits.moveTimeMs));
+  }
+
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < settings.threads; t++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread & thread : threads) {
+    thread.join();
+  }
+  if (pgn != nullptr) {
+    fclose(pgn);
+  }
+
+  // Every tenth game has already been reported
+  if (tally.games() % 10 != 0) {
+    printStatus(settings, tally);
+  }
+  if (settings.sprt) {
+    double llr = sprtLlr(tally, settings.elo0, settings.elo1);
+    printf("SPRT elo0 %.1f elo1 %.1f: %s\n", settings.elo0, settings.elo1,
+	   llr >= upper ? "H1 accepted" : (llr <= lower ? "H0 accepted" : "inconclusive"));
+  }
+  return 0;
+}
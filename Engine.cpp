@@ -0,0 +1,115 @@
+#include"Engine.h"
+
+Engine::Engine(const size_t ttMegabytes) : search(board, ttMegabytes) {
+  board.setFen(START_FEN);
+}
+
+Engine::~Engine() {
+  stopPondering();
+}
+
+FenError Engine::setPosition(const char* fen) {
+  stopPondering();
+  plannedMove = plannedReply = expectedReply = Move();
+  return board.setFen(fen);
+}
+
+void Engine::stopPondering() {
+  if (!pondering) {
+    return;
+  }
+  search.stop();
+  if (ponderThread.joinable()) {
+    ponderThread.join();
+  }
+  // After a ponder hit the ponder move was played and stays on the board
+  if (!ponderHit) {
+    board.undoMove(ponderMove, ponderUndo);
+  }
+  search.clearStop();
+  search.setDeadline(SearchClock::time_point());
+  pondering = false;
+  ponderHit = false;
+}
+
+bool Engine::startPondering(const SearchLimits & limits) {
+  stopPondering();
+  if (expectedReply.isNull()) {
+    return false;
+  }
+  // The reply came from an earlier position's search, make sure it is still legal
+  MoveList moves;
+  board.generateLegalMoves(moves);
+  if (!moves.contains(expectedReply)) {
+    return false;
+  }
+
+  ponderMove = expectedReply;
+  board.doMove(ponderMove, ponderUndo);
+  board.getPosition(ponderPosition);
+  ponderKey = board.getHashKey();
+  pondering = true;
+  ponderHit = false;
+  ponderStart = SearchClock::now();
+
+  // Only the depth limit applies until think() picks the search up after a ponder hit
+  SearchLimits ponderLimits = limits;
+  ponderLimits.moveTimeMs = 0;
+  ponderLimits.clock = TimeControl();
+  search.clearStop();
+  ponderThread = std::thread([this, ponderLimits]() { ponderResult = search.search(ponderLimits); });
+  return true;
+}
+
+void Engine::playMove(const Move & move) {
+  if (pondering && !ponderHit) {
+    if (move == ponderMove) {
+      // Ponder hit: the move is already on the board and the search goes on, it only has to
+      // join the game history
+      board.recordMadeMove(move, ponderPosition, ponderKey);
+      ponderHit = true;
+      ponderStats.hits++;
+      return;
+    }
+    auto start = SearchClock::now();
+    stopPondering();
+    double micros = std::chrono::duration<double, std::micro>(SearchClock::now() - start).count();
+    ponderStats.misses++;
+    if (micros > ponderStats.maxAbortMicros) {
+      ponderStats.maxAbortMicros = micros;
+    }
+  } else if (pondering) {
+    // A second move after a ponder hit, the ponder search is of no more use
+    stopPondering();
+  }
+  board.makeMove(move);
+  expectedReply = move == plannedMove ? plannedReply : Move();
+  plannedMove = plannedReply = Move();
+}
+
+SearchResult Engine::think(const SearchLimits & limits) {
+  SearchResult result;
+  if (pondering && ponderHit) {
+    // The time spent pondering since the guess counts towards this move
+    if (limits.clock.remainingMs >= 0) {
+      // Our clock only started with the hit, the search has had a head start so the normal time is enough
+      TimeManager timeManager;
+      timeManager.start(limits.clock, SearchClock::now());
+      search.setDeadline(SearchClock::now() + std::chrono::milliseconds(timeManager.getSoftMs()));
+    } else if (limits.moveTimeMs > 0) {
+      SearchClock::time_point deadline = ponderStart + std::chrono::milliseconds(limits.moveTimeMs);
+      search.setDeadline(deadline > SearchClock::now() ? deadline : SearchClock::now());
+    }
+    ponderThread.join();
+    result = ponderResult;
+    // The search has finished, stopPondering() only tidies up
+    stopPondering();
+  } else {
+    stopPondering();
+    search.clearStop();
+    result = search.search(limits);
+  }
+  plannedMove = result.bestMove;
+  plannedReply = result.pvLength > 1 ? result.pv[1] : Move();
+  return result;
+}
@@ -0,0 +1,98 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include"ChessBoard.h"
+#include"Search.h"
+#include<thread>
+
+/** Counters for the ponder searches of an Engine. */
+struct PonderStats {
+  int hits = 0;
+  int misses = 0;
+  /** Longest time a missed ponder search took to stop, in microseconds. */
+  double maxAbortMicros = 0.0;
+};
+
+/** A game-playing engine that owns its board and search, and can ponder.
+ *  After playing its move the engine can search the expected reply (the second move of its
+ *  principal variation) on a background thread. If the opponent plays that move the ponder
+ *  search simply carries on and think() only waits for the rest of its time; otherwise the
+ *  ponder search is stopped, the guessed move is taken back and the real one is played.
+ *  Either way the transposition table keeps what the ponder search found.
+ */
+class Engine {
+public:
+  /** Creates an engine at the standard starting position.
+   *  @param ttMegabytes: Size of the transposition table.
+   */
+  explicit Engine(const size_t ttMegabytes = 16);
+
+  /** Stops any ponder search before the board and search are destroyed. */
+  ~Engine();
+
+  Engine(const Engine &) = delete;
+  Engine & operator=(const Engine &) = delete;
+
+  /** Sets up a new position, stopping any ponder search.
+   *  @param fen: The FEN string of the position.
+   *  @return FenOk, or the reason the string was rejected.
+   */
+  FenError setPosition(const char* fen);
+
+  /** Searches the current position, picking up a ponder search on a ponder hit.
+   *  On a hit the ponder time counts towards limits.moveTimeMs, so the reply can be immediate.
+   *  Under a clock the search carries on for the normal time of a move from the hit.
+   *  @param limits: Depth and time limits of the search.
+   *  @return The result of the search, the move is not played.
+   */
+  SearchResult think(const SearchLimits & limits);
+
+  /** Plays a move of either side, resolving a ponder search as a hit or a miss.
+   *  @param move: A legal move in the current position.
+   */
+  void playMove(const Move & move);
+
+  /** Starts searching the expected reply to the engine's last move in the background.
+   *  Call it after playing the move returned by think().
+   *  @param limits: Limits the search will use when it is picked up by think(), the time limit
+   *  only applies from the ponder hit.
+   *  @return False if there is no expected reply to ponder on.
+   */
+  bool startPondering(const SearchLimits & limits);
+
+  /** Checks if a ponder search is running or waiting for the opponent's move. */
+  bool isPondering() const { return pondering; }
+
+  /** Gets the board, which must not be used while pondering. */
+  ChessBoard & getBoard() { return board; }
+
+  const PonderStats & getPonderStats() const { return ponderStats; }
+
+private:
+  ChessBoard board;
+  Search search;
+
+  /** First two moves of the principal variation of the last think(). */
+  Move plannedMove;
+  Move plannedReply;
+  /** Reply to ponder on, set when the planned move is played. */
+  Move expectedReply;
+
+  std::thread ponderThread;
+  bool pondering = false;
+  /** Set once the opponent played the ponder move, the move stays on the board. */
+  bool ponderHit = false;
+  Move ponderMove;
+  MoveUndo ponderUndo;
+  /** Position after the ponder move and its key, for the game history on a ponder hit. */
+  FenPosition ponderPosition;
+  uint64_t ponderKey = 0;
+  SearchClock::time_point ponderStart;
+  SearchResult ponderResult;
+  PonderStats ponderStats;
+
+  /** Stops and joins the ponder search and takes back the ponder move if it was not played. */
+  void stopPondering();
+};
+
+#endif // ENGINE_H
@@ -0,0 +1,178 @@
+#include"Evaluation.h"
+#include"ChessBoard.h"
+#include"AttackTables.h"
+#include<cctype>
+
+namespace {
+  const int DOUBLED_PENALTY = 12;
+  const int ISOLATED_PENALTY = 15;
+  const int BACKWARD_PENALTY = 8;
+  /** Bonus of a passed pawn by rank, counted from its own side's first rank. */
+  const int PASSED_BONUS[8] = {0, 5, 10, 20, 35, 60, 100, 0};
+  /** Bonus of a pawn in front of its king on the same or a neighbouring file, one and two ranks ahead. */
+  const int SHIELD_BONUS[2] = {12, 6};
+
+  const uint64_t FILE_A = 0x0101010101010101ULL;
+
+  uint64_t fileMask(const int col) { return FILE_A << col; }
+
+  uint64_t adjacentFiles(const int col) {
+    return (col > 0 ? fileMask(col - 1) : 0) | (col < 7 ? fileMask(col + 1) : 0);
+  }
+
+  /** Squares on the rows in front of a row, from a colour's point of view. White moves towards row 0. */
+  uint64_t rowsAhead(const int row, const Colour side) {
+    if (side == White) {
+      return (1ULL << (row * 8)) - 1;
+    }
+    return row == 7 ? 0 : ~0ULL << ((row + 1) * 8);
+  }
+
+  /** Scores one side's pawns, positive is good for that side. */
+  int pawnTerms(const uint64_t own, const uint64_t enemy, const Colour side) {
+    int score = 0;
+    for (int col = 0; col < 8; col++) {
+      int count = __builtin_popcountll(own & fileMask(col));
+      if (count > 1) {
+	score -= DOUBLED_PENALTY * (count - 1);
+      }
+    }
+
+    for (uint64_t pawns = own; pawns != 0; pawns &= pawns - 1) {
+      int square = __builtin_ctzll(pawns);
+      int row = squareRow(square), col = squareCol(square);
+      uint64_t ahead = rowsAhead(row, side);
+      uint64_t adjacent = adjacentFiles(col);
+      if ((own & adjacent) == 0) {
+	score -= ISOLATED_PENALTY;
+      } else {
+	// No pawn beside or behind can support it, and an enemy pawn guards the square it would move to
+	int stop = side == White ? square - 8 : square + 8;
+	if ((own & adjacent & ~ahead) == 0 && (AttackTables::PAWN_ATTACKS[side][stop] & enemy) != 0) {
+	  score -= BACKWARD_PENALTY;
+	}
+      }
+      // Only the front pawn of a file can be passed
+      if ((enemy & (fileMask(col) | adjacent) & ahead) == 0 && (own & fileMask(col) & ahead) == 0) {
+	score += PASSED_BONUS[side == White ? 7 - row : row];
+      }
+    }
+    return score;
+  }
+
+  /** Scores the own pawns in front of a king still on its first two ranks. */
+  int kingShelter(const uint64_t own, const Colour side, const int kingSquare) {
+    if (kingSquare < 0) {
+      return 0;
+    }
+    int kingRow = squareRow(kingSquare), kingCol = squareCol(kingSquare);
+    if ((side == White ? 7 - kingRow : kingRow) > 1) {
+      return 0;
+    }
+    int score = 0;
+    int step = side == White ? -1 : 1;
+    uint64_t files = fileMask(kingCol) | adjacentFiles(kingCol);
+    for (int distance = 1; distance <= 2; distance++) {
+      uint64_t rowMask = 0xFFULL << ((kingRow + step * distance) * 8);
+      score += SHIELD_BONUS[distance - 1] * __builtin_popcountll(own & files & rowMask);
+    }
+    return score;
+  }
+
+  /** Finds the pawns of both sides, indexed by Colour. */
+  void findPawns(const ChessBoard & board, uint64_t pawns[2]) {
+    pawns[White] = pawns[Black] = 0;
+    for (int square = 0; square < 64; square++) {
+      char symbol = board.getPieceSymbol(square);
+      if (symbol == 'P' || symbol == 'p') {
+	pawns[symbol == 'P' ? White : Black] |= 1ULL << square;
+      }
+    }
+  }
+
+  /** The pawn terms of both sides, from White's point of view. */
+  int pawnScore(const uint64_t pawns[2]) {
+    return pawnTerms(pawns[White], pawns[Black], White) - pawnTerms(pawns[Black], pawns[White], Black);
+  }
+
+  int shelterScore(const ChessBoard & board, const uint64_t pawns[2]) {
+    return kingShelter(pawns[White], White, board.getKingSquare(White)) -
+      kingShelter(pawns[Black], Black, board.getKingSquare(Black));
+  }
+}
+
+int pieceValue(const char symbol) {
+  switch (tolower(symbol)) {
+    case 'p': return 100;
+    case 'n': return 320;
+    case 'b': return 330;
+    case 'r': return 500;
+    case 'q': return 900;
+    case 'k': return 20000;
+    default : return 0;
+  }
+}
+
+PawnHashTable::PawnHashTable(const size_t kilobytes) {
+  size_t count = 1;
+  while (count * 2 * sizeof(Entry) <= kilobytes * 1024) {
+    count *= 2;
+  }
+  entries.resize(count);
+  mask = count - 1;
+}
+
+void PawnHashTable::clear() {
+  for (Entry & entry : entries) {
+    entry = Entry();
+  }
+  probes = hits = 0;
+}
+
+int PawnHashTable::probe(const ChessBoard & board) {
+  uint64_t key = board.getPawnKey();
+  Entry & entry = entries[key & mask];
+  probes++;
+  if (entry.used && entry.key == key) {
+    hits++;
+  } else {
+    entry.key = key;
+    findPawns(board, entry.pawns);
+    entry.score = pawnScore(entry.pawns);
+    entry.used = true;
+  }
+  return entry.score + shelterScore(board, entry.pawns);
+}
+
+int evaluateMaterial(const ChessBoard & board) {
+  int score = 0;
+  for (int square = 0; square < 64; square++) {
+    char symbol = board.getPieceSymbol(square);
+    if (symbol == '\0') {
+      continue;
+    }
+    int value = pieceValue(symbol);
+
+    // Minor pieces and pawns are worth a little more near the centre
+    char type = tolower(symbol);
+    if (type == 'n' || type == 'b' || type == 'p') {
+      int row = squareRow(square), col = squareCol(square);
+      int rowDistance = row < 4 ? 3 - row : row - 4;
+      int colDistance = col < 4 ? 3 - col : col - 4;
+      value += 10 - 3 * (rowDistance + colDistance) / 2;
+    }
+    score += isupper(symbol) ? value : -value;
+  }
+  return board.getSideToMove() == White ? score : -score;
+}
+
+int evaluatePawnStructure(const ChessBoard & board) {
+  uint64_t pawns[2];
+  findPawns(board, pawns);
+  return pawnScore(pawns) + shelterScore(board, pawns);
+}
+
+int evaluate(const ChessBoard & board, PawnHashTable* pawnTable) {
+  int pawnScore = pawnTable != nullptr ? pawnTable->probe(board) : evaluatePawnStructure(board);
+  return evaluateMaterial(board) + (board.getSideToMove() == White ? pawnScore : -pawnScore);
+}
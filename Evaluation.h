@@ -0,0 +1,69 @@
+#ifndef EVALUATION_H
+#define EVALUATION_H
+
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+class ChessBoard;
+
+/** Centipawn values indexed by lowercase FEN symbol, shared by evaluation and move ordering. */
+int pieceValue(const char symbol);
+
+/** Caches the pawn structure of positions by their pawn key, see ChessBoard::getPawnKey().
+ *  Pawns move in few of the moves of a search, so nearly every lookup finds its structure.
+ *  An entry keeps the pawns of both sides with their score, so the king shelter, which also
+ *  depends on where the kings are, is added from them without looking at the board again.
+ *  Each searching thread owns one, there is no locking.
+ */
+class PawnHashTable {
+public:
+  /** @param kilobytes: Approximate size of the table, rounded down to a power of two of entries. */
+  explicit PawnHashTable(const size_t kilobytes = 1024);
+
+  /** Gets the pawn structure score of a position, as evaluatePawnStructure() gives it.
+   *  The part without the king shelter is computed and stored on a miss.
+   *  @return Score in centipawns from White's point of view.
+   */
+  int probe(const ChessBoard & board);
+
+  /** Empties the table and its counters. */
+  void clear();
+
+  uint64_t getProbes() const { return probes; }
+  uint64_t getHits() const { return hits; }
+
+private:
+  struct Entry {
+    uint64_t key = 0;
+    /** The pawns of each side, indexed by Colour, one bit per square index. */
+    uint64_t pawns[2] = {0, 0};
+    int score = 0;
+    bool used = false;
+  };
+  std::vector<Entry> entries;
+  size_t mask;
+  uint64_t probes = 0;
+  uint64_t hits = 0;
+};
+
+/** Static evaluation of a position.
+ *  Material, a small centralisation bonus and the pawn structure, scored from the side to move's
+ *  point of view.
+ *  @param board: The board to evaluate.
+ *  @param pawnTable: Table to look the pawn structure up in, nullptr to compute it.
+ *  @return Score in centipawns, positive if the side to move is better.
+ */
+int evaluate(const ChessBoard & board, PawnHashTable* pawnTable = nullptr);
+
+/** The material and centralisation part of evaluate(), without the pawn structure. */
+int evaluateMaterial(const ChessBoard & board);
+
+/** Scores the pawn structure: doubled, isolated, backward and passed pawns, and the pawns
+ *  shielding each king. All but the shield depend only on the pawns, so they are cached by the
+ *  pawn key.
+ *  @return Score in centipawns from White's point of view.
+ */
+int evaluatePawnStructure(const ChessBoard & board);
+
+#endif // EVALUATION_H
@@ -0,0 +1,291 @@
+#include"Fen.h"
+#include"ChessBoard.h"
+
+namespace {
+  bool isPieceSymbol(const char c) {
+    switch (c) {
+      case 'p': case 'n': case 'b': case 'r': case 'q': case 'k':
+      case 'P': case 'N': case 'B': case 'R': case 'Q': case 'K':
+	return true;
+      default:
+	return false;
+    }
+  }
+
+  /** Reads a non-negative number of at most maxDigits digits, advancing i past it.
+   *  @return The number, or -1 if there are no digits or too many.
+   */
+  int readNumber(const char* fen, int & i, const int maxDigits) {
+    int value = 0, digits = 0;
+    while (fen[i] >= '0' && fen[i] <= '9') {
+      if (++digits > maxDigits) {
+	return -1;
+      }
+      value = value * 10 + (fen[i++] - '0');
+    }
+    return digits == 0 ? -1 : value;
+  }
+
+  /** Skips spaces, returning true if at least one was skipped or the end of the string was reached. */
+  bool skipSpaces(const char* fen, int & i) {
+    int start = i;
+    while (fen[i] == ' ') {
+      i++;
+    }
+    return i > start || fen[i] == '\0';
+  }
+
+  /** Writes a non-negative number, returning the number of characters written. */
+  int writeNumber(int value, char* out) {
+    char digits[12];
+    int count = 0;
+    do {
+      digits[count++] = '0' + value % 10;
+      value /= 10;
+    } while (value > 0);
+    for (int k = 0; k < count; k++) {
+      out[k] = digits[count - 1 - k];
+    }
+    return count;
+  }
+}
+
+FenError parseFen(const char* fen, FenPosition & position) {
+  if (fen == nullptr) {
+    return FenEmpty;
+  }
+  int i = 0;
+  while (fen[i] == ' ') {
+    i++;
+  }
+  if (fen[i] == '\0') {
+    return FenEmpty;
+  }
+
+  // Piece placement, rank 8 first. row and col are checked before every write.
+  int row = 0, col = 0;
+  int whiteKings = 0, blackKings = 0;
+  while (fen[i] != ' ' && fen[i] != '\0') {
+    char c = fen[i];
+    if (c == '/') {
+      if (col != 8) {
+	return FenBadRankLength;
+      }
+      if (++row > 7) {
+	return FenBadRankCount;
+      }
+      col = 0;
+    } else if (c >= '1' && c <= '8') {
+      int emptySquares = c - '0';
+      if (col + emptySquares > 8) {
+	return FenBadRankLength;
+      }
+      for (int j = 0; j < emptySquares; j++) {
+	position.squares[toSquare(row, col++)] = '\0';
+      }
+    } else if (isPieceSymbol(c)) {
+      if (col >= 8) {
+	return FenBadRankLength;
+      }
+      if ((c == 'p' || c == 'P') && (row == 0 || row == 7)) {
+	return FenBadPawnRank;
+      }
+      whiteKings += (c == 'K');
+      blackKings += (c == 'k');
+      position.squares[toSquare(row, col++)] = c;
+    } else {
+      return FenBadPiece;
+    }
+    i++;
+  }
+  if (row != 7) {
+    return FenBadRankCount;
+  }
+  if (col != 8) {
+    return FenBadRankLength;
+  }
+  if (whiteKings != 1 || blackKings != 1) {
+    return FenBadKingCount;
+  }
+
+  // Side to move
+  skipSpaces(fen, i);
+  if (fen[i] == 'w') {
+    position.sideToMove = White;
+  } else if (fen[i] == 'b') {
+    position.sideToMove = Black;
+  } else {
+    return FenBadSideToMove;
+  }
+  i++;
+  if (!skipSpaces(fen, i)) {
+    return FenBadSideToMove;
+  }
+
+  // Castling rights, each letter at most once
+  for (int k = 0; k < 4; k++) {
+    position.castling[k] = false;
+  }
+  if (fen[i] == '-') {
+    i++;
+  } else {
+    while (fen[i] != ' ' && fen[i] != '\0') {
+      int index;
+      switch (fen[i]) {
+        case 'K': index = whiteKingSide; break;
+        case 'Q': index = whiteQueenSide; break;
+        case 'k': index = blackKingSide; break;
+        case 'q': index = blackQueenSide; break;
+        default : return FenBadCastling;
+      }
+      if (position.castling[index]) {
+	return FenBadCastling;
+      }
+      position.castling[index] = true;
+      i++;
+    }
+  }
+  if (!skipSpaces(fen, i)) {
+    return FenBadCastling;
+  }
+
+  // En passant square, on rank 6 when White is to move and rank 3 when Black is
+  position.enPassantSquare = -1;
+  if (fen[i] == '-') {
+    i++;
+  } else if (fen[i] >= 'a' && fen[i] <= 'h') {
+    char expectedRank = position.sideToMove == White ? '6' : '3';
+    if (fen[i + 1] != expectedRank) {
+      return FenBadEnPassant;
+    }
+    position.enPassantSquare = toSquare('8' - expectedRank, fen[i] - 'a');
+    i += 2;
+  } else if (fen[i] != '\0') {
+    return FenBadEnPassant;
+  }
+  if (!skipSpaces(fen, i)) {
+    return FenBadEnPassant;
+  }
+
+  // Optional clocks
+  position.halfmoveClock = 0;
+  position.fullmoveNumber = 1;
+  if (fen[i] != '\0') {
+    position.halfmoveClock = readNumber(fen, i, 4);
+    if (position.halfmoveClock < 0 || !skipSpaces(fen, i)) {
+      return FenBadHalfmoveClock;
+    }
+  }
+  if (fen[i] != '\0') {
+    position.fullmoveNumber = readNumber(fen, i, 5);
+    if (position.fullmoveNumber < 1) {
+      return FenBadFullmoveNumber;
+    }
+    skipSpaces(fen, i);
+  }
+  if (fen[i] != '\0') {
+    return FenTrailingCharacters;
+  }
+  return checkCastlingAndEnPassant(position);
+}
+
+FenError checkCastlingAndEnPassant(const FenPosition & position) {
+  // White's pieces start on row 7, Black's on row 0
+  for (int k = 0; k < 4; k++) {
+    if (!position.castling[k]) {
+      continue;
+    }
+    bool white = k == whiteKingSide || k == whiteQueenSide;
+    bool kingSide = k == whiteKingSide || k == blackKingSide;
+    int row = white ? 7 : 0;
+    if (position.squares[toSquare(row, 4)] != (white ? 'K' : 'k') ||
+	position.squares[toSquare(row, kingSide ? 7 : 0)] != (white ? 'R' : 'r')) {
+      return FenBadCastling;
+    }
+  }
+
+  // The pawn that moved two squares stands behind the target, which it crossed from its start square
+  if (position.enPassantSquare != -1) {
+    int row = squareRow(position.enPassantSquare);
+    int col = squareCol(position.enPassantSquare);
+    int step = position.sideToMove == White ? 1 : -1;
+    if (position.squares[toSquare(row + step, col)] != (position.sideToMove == White ? 'p' : 'P') ||
+	position.squares[position.enPassantSquare] != '\0' || position.squares[toSquare(row - step, col)] != '\0') {
+      return FenBadEnPassant;
+    }
+  }
+  return FenOk;
+}
+
+int writeFen(const FenPosition & position, char* out) {
+  int length = 0;
+  for (int row = 0; row < 8; row++) {
+    int empty = 0;
+    for (int col = 0; col < 8; col++) {
+      char symbol = position.squares[toSquare(row, col)];
+      if (symbol == '\0') {
+	empty++;
+	continue;
+      }
+      if (empty > 0) {
+	out[length++] = '0' + empty;
+	empty = 0;
+      }
+      out[length++] = symbol;
+    }
+    if (empty > 0) {
+      out[length++] = '0' + empty;
+    }
+    if (row < 7) {
+      out[length++] = '/';
+    }
+  }
+
+  out[length++] = ' ';
+  out[length++] = position.sideToMove == White ? 'w' : 'b';
+  out[length++] = ' ';
+
+  static const char castleSymbols[4] = {'K', 'Q', 'k', 'q'};
+  int castleStart = length;
+  for (int k = 0; k < 4; k++) {
+    if (position.castling[k]) {
+      out[length++] = castleSymbols[k];
+    }
+  }
+  if (length == castleStart) {
+    out[length++] = '-';
+  }
+  out[length++] = ' ';
+
+  if (position.enPassantSquare == -1) {
+    out[length++] = '-';
+  } else {
+    out[length++] = 'a' + squareCol(position.enPassantSquare);
+    out[length++] = '8' - squareRow(position.enPassantSquare);
+  }
+  out[length++] = ' ';
+  length += writeNumber(position.halfmoveClock, out + length);
+  out[length++] = ' ';
+  length += writeNumber(position.fullmoveNumber, out + length);
+  out[length] = '\0';
+  return length;
+}
+
+const char* fenErrorString(const FenError error) {
+  switch (error) {
+    case FenOk:                 return "no error";
+    case FenEmpty:              return "empty string";
+    case FenBadPiece:           return "unknown piece character";
+    case FenBadRankLength:      return "a rank does not have 8 squares";
+    case FenBadRankCount:       return "the board does not have 8 ranks";
+    case FenBadKingCount:       return "each side needs exactly one king";
+    case FenBadPawnRank:        return "pawn on the first or last rank";
+    case FenBadSideToMove:      return "side to move must be 'w' or 'b'";
+    case FenBadCastling:        return "bad castling field";
+    case FenBadEnPassant:       return "bad en passant square";
+    case FenBadHalfmoveClock:   return "bad halfmove clock";
+    case FenBadFullmoveNumber:  return "bad fullmove number";
+    case FenTrailingCharacters: return "unexpected characters at the end";
+  }
+  return "unknown error";
+}
@@ -0,0 +1,70 @@
+#ifndef FEN_H
+#define FEN_H
+
+#include"Pieces.h"
+
+/** Result of parsing a FEN string, FenOk on success. */
+enum FenError {
+  FenOk,
+  FenEmpty,
+  FenBadPiece,
+  FenBadRankLength,
+  FenBadRankCount,
+  FenBadKingCount,
+  FenBadPawnRank,
+  FenBadSideToMove,
+  FenBadCastling,
+  FenBadEnPassant,
+  FenBadHalfmoveClock,
+  FenBadFullmoveNumber,
+  FenTrailingCharacters
+};
+
+/** Longest FEN toFen() can write, including the null terminator. */
+const int MAX_FEN_LENGTH = 96;
+
+/** The standard starting position. */
+const char* const START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+/** A position decoded from a FEN string, independent of any ChessBoard. */
+struct FenPosition {
+  /** FEN piece symbol per square index (row * 8 + col, A8 first), '\0' for empty squares. */
+  char squares[64];
+  Colour sideToMove = White;
+  /** Castling rights indexed by CastleDirection. */
+  bool castling[4] = {false, false, false, false};
+  /** En passant target square index, or -1. */
+  int enPassantSquare = -1;
+  int halfmoveClock = 0;
+  int fullmoveNumber = 1;
+};
+
+/** Parses and validates a FEN string without allocating.
+ *  The piece placement and side to move are required, the castling, en passant and clock fields
+ *  are optional and default to "- - 0 1". The position is checked for 8 ranks of 8 squares,
+ *  one king per side, no pawns on the first or last rank, and with checkCastlingAndEnPassant().
+ *  @param fen: The FEN string.
+ *  @param position: Receives the decoded position, only meaningful if FenOk is returned.
+ *  @return FenOk, or the first problem found.
+ */
+FenError parseFen(const char* fen, FenPosition & position);
+
+/** Checks that the castling rights and en passant square of a position fit its pieces: each
+ *  right needs the king and the rook on their starting squares, and an en passant square needs
+ *  the pawn that has just made a double move behind it and both squares it crossed empty.
+ *  @param position: A position whose piece placement is valid.
+ *  @return FenOk, FenBadCastling or FenBadEnPassant.
+ */
+FenError checkCastlingAndEnPassant(const FenPosition & position);
+
+/** Writes a position as a full six field FEN string.
+ *  @param position: The position to write.
+ *  @param out: Buffer of at least MAX_FEN_LENGTH characters.
+ *  @return The length of the string written, excluding the null terminator.
+ */
+int writeFen(const FenPosition & position, char* out);
+
+/** Gets a short description of a FEN error, for messages. */
+const char* fenErrorString(const FenError error);
+
+#endif // FEN_H
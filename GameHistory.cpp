@@ -0,0 +1,49 @@
+#include"GameHistory.h"
+
+GameHistory::GameHistory(const int _snapshotInterval)
+  : snapshotInterval(_snapshotInterval > 0 ? _snapshotInterval : DEFAULT_SNAPSHOT_INTERVAL) {}
+
+void GameHistory::reset(const FenPosition & position, const uint64_t hashKey) {
+  start = position;
+  moves.clear();
+  hashKeys.assign(1, hashKey);
+  snapshots.clear();
+  cursor = 0;
+  finished = false;
+  addSnapshot(position);
+}
+
+void GameHistory::push(const Move & move, const uint64_t hashKey) {
+  // A new move from an earlier ply replaces the rest of the game
+  if (cursor < getLength()) {
+    moves.resize(cursor);
+    hashKeys.resize(cursor + 1);
+    snapshots.resize(cursor / snapshotInterval + 1);
+  }
+  moves.push_back(move);
+  hashKeys.push_back(hashKey);
+  cursor++;
+  finished = false;
+}
+
+void GameHistory::addSnapshot(const FenPosition & position) {
+  // A loaded position can have more pieces than a packed one holds, its snapshots are left
+  // empty and seeks replay from the start instead
+  PackedPosition packed;
+  packPosition(position, packed);
+  snapshots.push_back(packed);
+}
+
+int GameHistory::getSnapshot(const int ply, FenPosition & position) const {
+  int index = ply / snapshotInterval;
+  if (index == 0 || unpackPosition(snapshots[index], position) != FenOk) {
+    position = start;
+    return 0;
+  }
+  return index * snapshotInterval;
+}
+
+size_t GameHistory::getMemoryBytes() const {
+  return moves.capacity() * sizeof(Move) + hashKeys.capacity() * sizeof(uint64_t) +
+    snapshots.capacity() * sizeof(PackedPosition);
+}
@@ -0,0 +1,87 @@
+#ifndef GAMEHISTORY_H
+#define GAMEHISTORY_H
+
+#include"Move.h"
+#include"PackedPosition.h"
+#include<cstdint>
+#include<vector>
+
+/** The moves of a game with a packed snapshot of the position every few plies, so any ply can
+ *  be reached by loading the snapshot before it and replaying at most snapshotInterval - 1 moves.
+ *  Each ply costs its 2 byte move and 8 byte hash key, used to restore the repetition history
+ *  after a seek, plus a 32 byte snapshot every snapshotInterval plies.
+ *
+ *  The history only stores positions, ChessBoard does the replaying. The cursor is the ply of
+ *  the position on the board; moves past it are kept for redo until a different move is played.
+ */
+class GameHistory {
+public:
+  /** Plies between two snapshots. */
+  static const int DEFAULT_SNAPSHOT_INTERVAL = 16;
+
+  explicit GameHistory(const int _snapshotInterval = DEFAULT_SNAPSHOT_INTERVAL);
+
+  /** Starts a new game.
+   *  @param position: The position at ply 0.
+   *  @param hashKey: Its Zobrist key.
+   */
+  void reset(const FenPosition & position, const uint64_t hashKey);
+
+  /** Records a move played from the position at the cursor and moves the cursor past it.
+   *  The moves after the cursor are dropped, and the game is no longer finished.
+   *  @param move: The move.
+   *  @param hashKey: The Zobrist key of the position after the move.
+   */
+  void push(const Move & move, const uint64_t hashKey);
+
+  /** Checks if the position at the cursor is due a snapshot, after push(). */
+  bool needsSnapshot() const {
+    return cursor % snapshotInterval == 0 && static_cast<int>(snapshots.size()) <= cursor / snapshotInterval;
+  }
+
+  /** Stores the snapshot of the position at the cursor, when needsSnapshot() says so. */
+  void addSnapshot(const FenPosition & position);
+
+  /** Gets the last snapshot at or before a ply.
+   *  @param ply: The ply wanted, from 0 to getLength().
+   *  @param position: Receives the snapshot's position.
+   *  @return The ply of the snapshot, the moves from it up to ply have to be replayed.
+   */
+  int getSnapshot(const int ply, FenPosition & position) const;
+
+  /** Gets the move played from the position at a ply, 0 <= ply < getLength(). */
+  const Move & getMove(const int ply) const { return moves[ply]; }
+
+  /** Gets the Zobrist key of the position at a ply, 0 <= ply <= getLength(). */
+  uint64_t getHashKey(const int ply) const { return hashKeys[ply]; }
+
+  /** Gets the number of plies recorded, including those after the cursor. */
+  int getLength() const { return static_cast<int>(moves.size()); }
+
+  /** Gets the ply of the position on the board. */
+  int getCursor() const { return cursor; }
+  void setCursor(const int ply) { cursor = ply; }
+
+  int getSnapshotInterval() const { return snapshotInterval; }
+
+  /** Marks the game as ended at its last ply, by checkmate, stalemate or a draw rule. */
+  void setFinished(const bool _finished) { finished = _finished; }
+  bool isFinished() const { return finished; }
+
+  /** Gets the memory the history holds on to, in bytes. */
+  size_t getMemoryBytes() const;
+
+private:
+  int snapshotInterval;
+  /** Position of ply 0, also kept unpacked as it may have too many pieces to pack. */
+  FenPosition start;
+  std::vector<Move> moves;
+  /** Keys of plies 0 to getLength(), one more than the moves. */
+  std::vector<uint64_t> hashKeys;
+  /** Position of ply k * snapshotInterval at index k. */
+  std::vector<PackedPosition> snapshots;
+  int cursor = 0;
+  bool finished = false;
+};
+
+#endif // GAMEHISTORY_H
@@ -0,0 +1,124 @@
+#include"LargeMemory.h"
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<sys/mman.h>
+#include<sys/syscall.h>
+#include<unistd.h>
+
+namespace {
+  const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+  /** MPOL_INTERLEAVE of <numaif.h>, mbind() is called directly so libnuma is not needed. */
+  const int MPOL_INTERLEAVE_MODE = 3;
+  const int MAX_NODES = 64;
+
+  /** Reads the nodes that have memory from sysfs, a list such as "0-1,3", as a bit mask.
+   *  A system without the file is one node.
+   */
+  uint64_t memoryNodes() {
+    FILE* file = fopen("/sys/devices/system/node/has_memory", "r");
+    if (file == nullptr) {
+      return 1;
+    }
+    uint64_t nodes = 0;
+    int first;
+    while (fscanf(file, "%d", &first) == 1) {
+      int last = first;
+      int separator = fgetc(file);
+      if (separator == '-') {
+	if (fscanf(file, "%d", &last) != 1) {
+	  break;
+	}
+	separator = fgetc(file);
+      }
+      for (int node = first; node <= last && node < MAX_NODES; node++) {
+	nodes |= 1ULL << node;
+      }
+      if (separator != ',') {
+	break;
+      }
+    }
+    fclose(file);
+    return nodes == 0 ? 1 : nodes;
+  }
+
+  /** Maps a block aligned to a huge page, which transparent huge pages need, by mapping one
+   *  huge page more than asked and unmapping the ends.
+   */
+  void* mapAligned(const size_t bytes) {
+    size_t size = bytes + HUGE_PAGE_SIZE;
+    void* raw = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+      return nullptr;
+    }
+    uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (aligned > start) {
+      munmap(raw, aligned - start);
+    }
+    size_t tail = start + size - (aligned + bytes);
+    if (tail > 0) {
+      munmap(reinterpret_cast<void*>(aligned + bytes), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+  }
+}
+
+LargeMemory::LargeMemory(const size_t _bytes, const MemoryOptions & options) : bytes(_bytes) {
+  if (options.hugePages == HugePagesOff) {
+    mappedBytes = bytes;
+    void* block = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    memory = block == MAP_FAILED ? nullptr : block;
+  } else {
+    mappedBytes = (bytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    if (options.hugePages == HugePagesExplicit) {
+      // Fails at once when the reserved pool cannot hold the block
+      void* block = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (block != MAP_FAILED) {
+	memory = block;
+	hugePages = HugePagesExplicit;
+      }
+    }
+    if (memory == nullptr) {
+      memory = mapAligned(mappedBytes);
+      if (memory != nullptr && madvise(memory, mappedBytes, MADV_HUGEPAGE) == 0) {
+	hugePages = HugePagesTransparent;
+      }
+    }
+  }
+
+  // The policy only applies to pages not yet touched, which is all of them here
+  if (memory != nullptr && options.numa == NumaInterleave && nodeCount() > 1) {
+    uint64_t nodes = memoryNodes();
+    interleaved = syscall(SYS_mbind, memory, mappedBytes, MPOL_INTERLEAVE_MODE, &nodes, MAX_NODES + 1, 0) == 0;
+  }
+}
+
+LargeMemory::~LargeMemory() {
+  if (memory != nullptr) {
+    munmap(memory, mappedBytes);
+  }
+}
+
+void LargeMemory::clear() {
+  if (memory == nullptr) {
+    return;
+  }
+  // Private anonymous pages read as zeros again once they are dropped, the mapping and its
+  // NUMA policy stay
+  if (hugePages == HugePagesExplicit || madvise(memory, mappedBytes, MADV_DONTNEED) != 0) {
+    memset(memory, 0, bytes);
+  }
+}
+
+int LargeMemory::nodeCount() {
+  return __builtin_popcountll(memoryNodes());
+}
+
+const char* LargeMemory::hugePagesName(const HugePages pages) {
+  switch (pages) {
+    case HugePagesTransparent: return "transparent";
+    case HugePagesExplicit:    return "explicit";
+    default :                  return "off";
+  }
+}
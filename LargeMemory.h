@@ -0,0 +1,84 @@
+#ifndef LARGEMEMORY_H
+#define LARGEMEMORY_H
+
+#include<cstddef>
+
+/** Page size asked for when a table is mapped. */
+enum HugePages {
+  /** Normal 4 KB pages. */
+  HugePagesOff,
+  /** Transparent huge pages: the mapping is 2 MB aligned and marked with madvise(MADV_HUGEPAGE),
+   *  the kernel backs it with huge pages when it has them and normal pages otherwise.
+   */
+  HugePagesTransparent,
+  /** Explicit huge pages with MAP_HUGETLB from the pool reserved in /proc/sys/vm/nr_hugepages,
+   *  transparent huge pages if the pool is too small.
+   */
+  HugePagesExplicit
+};
+
+/** How the pages of a table are spread over the NUMA nodes. */
+enum NumaPolicy {
+  /** Each page goes to the node of the thread that first writes it, the kernel's default. Nothing
+   *  is written when the table is mapped or cleared, so that thread is the one that searches.
+   */
+  NumaFirstTouch,
+  /** Pages go round robin over every node, so threads on all nodes see the same average latency. */
+  NumaInterleave
+};
+
+/** How a large table is allocated. */
+struct MemoryOptions {
+  HugePages hugePages = HugePagesTransparent;
+  NumaPolicy numa = NumaFirstTouch;
+};
+
+/** A zero filled block of memory mapped for a large table, e.g. a transposition table.
+ *  Every option falls back to what the system offers, so the block is always usable as long as
+ *  the memory itself could be mapped.
+ */
+class LargeMemory {
+public:
+  /** Maps a block.
+   *  @param bytes: Size of the block.
+   *  @param options: Page size and NUMA placement to try.
+   */
+  LargeMemory(const size_t bytes, const MemoryOptions & options);
+  ~LargeMemory();
+
+  LargeMemory(const LargeMemory &) = delete;
+  LargeMemory & operator=(const LargeMemory &) = delete;
+
+  /** Gets the start of the block, nullptr if nothing could be mapped. */
+  void* data() const { return memory; }
+
+  /** Fills the block with zeros again. Normal and transparent pages are handed back to the
+   *  kernel instead of written, so clearing costs nothing and the next write places the page
+   *  again, on the node of the thread that makes it.
+   */
+  void clear();
+
+  /** Gets the page size that was mapped: explicit only if MAP_HUGETLB succeeded, transparent
+   *  if the block was marked for huge pages.
+   */
+  HugePages getHugePages() const { return hugePages; }
+
+  /** Checks if the block was interleaved, false on a machine with one node. */
+  bool isInterleaved() const { return interleaved; }
+
+  /** Gets the number of NUMA nodes with memory. */
+  static int nodeCount();
+
+  /** Gets a short name of a page size, for reports. */
+  static const char* hugePagesName(const HugePages pages);
+
+private:
+  void* memory = nullptr;
+  /** Size of the block as asked for and as mapped, rounded up to whole huge pages. */
+  size_t bytes = 0;
+  size_t mappedBytes = 0;
+  HugePages hugePages = HugePagesOff;
+  bool interleaved = false;
+};
+
+#endif // LARGEMEMORY_H
@@ -0,0 +1,186 @@
+#include"MateSolver.h"
+#include"ChessBoard.h"
+
+MateSolver::MateSolver(ChessBoard & _board, const bool _checksOnly)
+  : board(_board), checksOnly(_checksOnly), cache(CACHE_SIZE) {}
+
+void MateSolver::generateAttackerMoves(MoveList & moves, const bool onlyChecks) {
+  // Checking moves go first, they are the most likely to mate
+  board.generateCheckingMoves(moves);
+  if (onlyChecks) {
+    return;
+  }
+  MoveList legal;
+  board.generateLegalMoves(legal);
+  for (const Move & move : legal) {
+    if (!moves.contains(move)) {
+      moves.add(move);
+    }
+  }
+}
+
+bool MateSolver::attackerWins(const int movesLeft) {
+  nodes++;
+  if (movesLeft <= 0) {
+    return false;
+  }
+
+  CacheEntry & entry = cache[board.getHashKey() & (CACHE_SIZE - 1)];
+  if (entry.key == board.getHashKey()) {
+    if (entry.winDepth > 0 && entry.winDepth <= movesLeft) {
+      return true;
+    }
+    if (entry.lossDepth >= movesLeft) {
+      return false;
+    }
+  }
+
+  MoveList moves;
+  // Only a check can mate on the last move
+  generateAttackerMoves(moves, checksOnly || movesLeft == 1);
+
+  bool parentHitDraw = hitDrawByRule;
+  hitDrawByRule = false;
+  bool wins = false;
+  for (const Move & move : moves) {
+    MoveUndo undo;
+    board.doMove(move, undo);
+    wins = defenderLoses(movesLeft);
+    board.undoMove(move, undo);
+    if (wins) {
+      break;
+    }
+  }
+
+  // Store the result, the entry may have been replaced by another position meanwhile
+  CacheEntry & slot = cache[board.getHashKey() & (CACHE_SIZE - 1)];
+  if (slot.key != board.getHashKey()) {
+    slot = CacheEntry();
+    slot.key = board.getHashKey();
+  }
+  if (wins && (slot.winDepth == 0 || movesLeft < slot.winDepth)) {
+    slot.winDepth = movesLeft;
+  } else if (!wins && !hitDrawByRule && movesLeft > slot.lossDepth) {
+    slot.lossDepth = movesLeft;
+  }
+  hitDrawByRule = hitDrawByRule || parentHitDraw;
+  return wins;
+}
+
+bool MateSolver::defenderLoses(const int movesLeft) {
+  nodes++;
+  MoveList replies;
+  board.generateLegalMoves(replies);
+  if (replies.empty()) {
+    // Checkmate wins, stalemate does not
+    return board.isSideToMoveInCheck();
+  }
+  if (movesLeft <= 1) {
+    return false;
+  }
+  // A draw by rule is a successful defence, but only on this path
+  if (board.isDrawByRule()) {
+    hitDrawByRule = true;
+    return false;
+  }
+
+  for (const Move & reply : replies) {
+    MoveUndo undo;
+    board.doMove(reply, undo);
+    bool attackerStillWins = attackerWins(movesLeft - 1);
+    board.undoMove(reply, undo);
+    if (!attackerStillWins) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int MateSolver::shortestMate(const int maxMoves) {
+  for (int n = 1; n <= maxMoves; n++) {
+    if (attackerWins(n)) {
+      return n;
+    }
+  }
+  return 0;
+}
+
+void MateSolver::extractLine(const int movesLeft, std::vector<Move> & line) {
+  if (movesLeft <= 0) {
+    return;
+  }
+
+  // Attacker: the move that mates soonest
+  MoveList moves;
+  generateAttackerMoves(moves, checksOnly || movesLeft == 1);
+  Move best;
+  int bestDepth = 0;
+  for (int n = 1; n <= movesLeft && best.isNull(); n++) {
+    for (const Move & move : moves) {
+      MoveUndo undo;
+      board.doMove(move, undo);
+      bool wins = defenderLoses(n);
+      board.undoMove(move, undo);
+      if (wins) {
+	best = move;
+	bestDepth = n;
+	break;
+      }
+    }
+  }
+  if (best.isNull()) {
+    return;
+  }
+  line.push_back(best);
+  MoveUndo attackerUndo;
+  board.doMove(best, attackerUndo);
+
+  // Defender: the reply that delays mate the longest, none if the move was mate
+  MoveList replies;
+  board.generateLegalMoves(replies);
+  Move longest;
+  int longestDepth = 0;
+  for (const Move & reply : replies) {
+    MoveUndo undo;
+    board.doMove(reply, undo);
+    int depth = shortestMate(bestDepth - 1);
+    board.undoMove(reply, undo);
+    if (depth > longestDepth) {
+      longestDepth = depth;
+      longest = reply;
+    }
+  }
+  if (!longest.isNull()) {
+    line.push_back(longest);
+    MoveUndo defenderUndo;
+    board.doMove(longest, defenderUndo);
+    extractLine(longestDepth, line);
+    board.undoMove(longest, defenderUndo);
+  }
+  board.undoMove(best, attackerUndo);
+}
+
+MateResult MateSolver::solve(const int maxMoves) {
+  nodes = 0;
+  hitDrawByRule = false;
+  MateResult result;
+  result.mateIn = shortestMate(maxMoves);
+
+  if (result.mateIn > 0) {
+    // Every root move that mates within the limit is a key move
+    MoveList moves;
+    generateAttackerMoves(moves, checksOnly || maxMoves == 1);
+    for (const Move & move : moves) {
+      MoveUndo undo;
+      board.doMove(move, undo);
+      bool wins = defenderLoses(maxMoves);
+      board.undoMove(move, undo);
+      if (wins) {
+	result.keyMoves.add(move);
+      }
+    }
+    extractLine(result.mateIn, result.line);
+  }
+  result.nodes = nodes;
+  return result;
+}
@@ -0,0 +1,76 @@
+#ifndef MATESOLVER_H
+#define MATESOLVER_H
+
+#include"Move.h"
+#include<cstdint>
+#include<vector>
+
+class ChessBoard;
+
+/** Result of a mate-in-N search from the side to move's point of view. */
+struct MateResult {
+  /** Smallest number of attacker moves that forces mate, 0 if there is no mate within the limit. */
+  int mateIn = 0;
+  /** Every first move that forces mate within the limit, the puzzle is unique if there is one. */
+  MoveList keyMoves;
+  /** The main line, alternating attacker moves and the defender's longest resistance. */
+  std::vector<Move> line;
+  uint64_t nodes = 0;
+};
+
+/** Depth-limited AND/OR search for forced mates.
+ *  Attacker nodes (OR) succeed if any move forces mate, defender nodes (AND) only if every reply
+ *  loses. The attacker's last move must give check, so only checking moves are generated there;
+ *  with checksOnly set every attacker move must be a check, which is much faster but misses
+ *  mates with a quiet move. Proven and refuted depths are cached per position.
+ */
+class MateSolver {
+public:
+  /** Creates a solver for a board, the board is restored after each solve().
+   *  @param _board: The board holding the puzzle position.
+   *  @param _checksOnly: Restrict every attacker move to checks.
+   */
+  MateSolver(ChessBoard & _board, const bool _checksOnly = false);
+
+  /** Looks for a forced mate in at most maxMoves moves of the side to move.
+   *  @param maxMoves: The N of mate in N.
+   *  @return The shortest mate found, all key moves that mate within maxMoves and the main line.
+   */
+  MateResult solve(const int maxMoves);
+
+private:
+  ChessBoard & board;
+  bool checksOnly;
+  uint64_t nodes = 0;
+
+  /** Cache entry: the position is a mate in winDepth, and not a mate in lossDepth or fewer. */
+  struct CacheEntry {
+    uint64_t key = 0;
+    int winDepth = 0;
+    int lossDepth = -1;
+  };
+  static const int CACHE_SIZE = 1 << 16;
+  std::vector<CacheEntry> cache;
+  /** Set when a draw by rule was found below the current node. Repetitions and the halfmove
+   *  clock depend on the moves that led to a position and are not in its key, so a loss found
+   *  that way only holds on this path and is not cached.
+   */
+  bool hitDrawByRule = false;
+
+  /** OR node: can the side to move force mate in at most movesLeft moves? */
+  bool attackerWins(const int movesLeft);
+
+  /** AND node: does every defender reply lose to a mate in at most movesLeft attacker moves? */
+  bool defenderLoses(const int movesLeft);
+
+  /** Generates the attacker's candidate moves, checks first (and only checks if required). */
+  void generateAttackerMoves(MoveList & moves, const bool onlyChecks);
+
+  /** Finds the smallest number of attacker moves that forces mate, up to maxMoves, or 0. */
+  int shortestMate(const int maxMoves);
+
+  /** Appends the main line from the current position to line. */
+  void extractLine(const int movesLeft, std::vector<Move> & line);
+};
+
+#endif // MATESOLVER_H
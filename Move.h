@@ -0,0 +1,119 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include<cstdint>
+
+/** Square indexes used by the engine are row * 8 + col, matching the ChessBoard array layout.
+ *  Index 0 is A8 and index 63 is H1.
+ */
+inline int toSquare(const int row, const int col) { return row * 8 + col; }
+inline int squareRow(const int square) { return square >> 3; }
+inline int squareCol(const int square) { return square & 7; }
+
+/** Special move kinds stored in the top 4 bits of a Move.
+ *  Captures are not flagged, they are found from the board (see ChessBoard::isCapture()).
+ */
+enum MoveFlag : uint16_t {
+  FlagNone = 0,
+  FlagDoublePush = 1,
+  FlagCastle = 2,
+  FlagEnPassant = 3,
+  FlagPromoKnight = 4,
+  FlagPromoBishop = 5,
+  FlagPromoRook = 6,
+  FlagPromoQueen = 7
+};
+
+/** A move packed into 16 bits: from square (bits 0-5), to square (bits 6-11) and flags (bits 12-15).
+ *  A null move (from == to) marks an empty hash or killer slot.
+ */
+class Move {
+public:
+  Move() : data(0) {}
+  Move(const int from, const int to, const MoveFlag flag = FlagNone)
+    : data(static_cast<uint16_t>(from | (to << 6) | (flag << 12))) {}
+
+  int from() const { return data & 0x3F; }
+  int to() const { return (data >> 6) & 0x3F; }
+  MoveFlag flag() const { return static_cast<MoveFlag>(data >> 12); }
+
+  bool isNull() const { return from() == to(); }
+  bool isPromotion() const { return flag() >= FlagPromoKnight; }
+
+  /** Gets the lowercase FEN symbol of the promotion piece, or '\0' if the move is not a promotion. */
+  char promotionSymbol() const {
+    static const char symbols[4] = {'n', 'b', 'r', 'q'};
+    return isPromotion() ? symbols[flag() - FlagPromoKnight] : '\0';
+  }
+
+  /** Maps a promotion piece symbol ('n', 'b', 'r' or 'q', either case) to its flag, queen by default. */
+  static MoveFlag promotionFlag(const char symbol);
+
+  /** Writes the move in coordinate notation, e.g. "e2e4" or "e7e8q".
+   *  @param out: Buffer of at least 6 characters.
+   */
+  void toString(char out[6]) const;
+
+  /** The raw 16-bit encoding, used when moves are stored in tables. */
+  uint16_t raw() const { return data; }
+
+  bool operator==(const Move & other) const { return data == other.data; }
+  bool operator!=(const Move & other) const { return data != other.data; }
+
+private:
+  uint16_t data;
+};
+
+/** Upper bound on the number of legal moves in any chess position. */
+const int MAX_MOVES = 256;
+
+/** Fixed-capacity list of moves, kept on the stack so move generation never allocates. */
+class MoveList {
+public:
+  void add(const Move & move) { moves[count++] = move; }
+  void clear() { count = 0; }
+  int size() const { return count; }
+  bool empty() const { return count == 0; }
+
+  Move & operator[](const int index) { return moves[index]; }
+  const Move & operator[](const int index) const { return moves[index]; }
+
+  const Move * begin() const { return moves; }
+  const Move * end() const { return moves + count; }
+
+  /** Checks if a move is in the list. */
+  bool contains(const Move & move) const;
+
+private:
+  Move moves[MAX_MOVES];
+  int count = 0;
+};
+
+inline MoveFlag Move::promotionFlag(const char symbol) {
+  switch (symbol | 0x20) {
+    case 'n': return FlagPromoKnight;
+    case 'b': return FlagPromoBishop;
+    case 'r': return FlagPromoRook;
+    default : return FlagPromoQueen;
+  }
+}
+
+inline void Move::toString(char out[6]) const {
+  out[0] = 'a' + squareCol(from());
+  out[1] = '8' - squareRow(from());
+  out[2] = 'a' + squareCol(to());
+  out[3] = '8' - squareRow(to());
+  out[4] = promotionSymbol();
+  out[5] = '\0';
+}
+
+inline bool MoveList::contains(const Move & move) const {
+  for (int i = 0; i < count; i++) {
+    if (moves[i] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif // MOVE_H
@@ -0,0 +1,147 @@
+#include"MoveOrdering.h"
+#include"ChessBoard.h"
+#include"Evaluation.h"
+
+namespace {
+  /** History scores are halved before they grow past this. */
+  const int HISTORY_LIMIT = 300000;
+}
+
+void MoveOrdering::clear() {
+  for (int ply = 0; ply < MAX_PLY; ply++) {
+    killers[ply][0] = Move();
+    killers[ply][1] = Move();
+  }
+  for (int side = 0; side < 2; side++) {
+    for (int from = 0; from < 64; from++) {
+      for (int to = 0; to < 64; to++) {
+	history[side][from][to] = 0;
+      }
+    }
+  }
+}
+
+int MoveOrdering::scoreNoisy(const ChessBoard & board, const Move & move) const {
+  if (!options.mvvLva) {
+    return 0;
+  }
+  // MVV-LVA, victim value dominates and the attacker value breaks ties.
+  // The en passant victim is not on the destination square, it is always a pawn.
+  char victim = move.flag() == FlagEnPassant ? 'p' : board.getPieceSymbol(move.to());
+  int attacker = pieceValue(board.getPieceSymbol(move.from()));
+  int victimValue = pieceValue(victim) + pieceValue(move.promotionSymbol());
+  return victimValue * 10 - attacker / 10;
+}
+
+void MoveOrdering::pickNext(MoveList & moves, int scores[], const int index) {
+  int best = index;
+  for (int i = index + 1; i < moves.size(); i++) {
+    if (scores[i] > scores[best]) {
+      best = i;
+    }
+  }
+  if (best != index) {
+    Move tempMove = moves[index];
+    moves[index] = moves[best];
+    moves[best] = tempMove;
+    int tempScore = scores[index];
+    scores[index] = scores[best];
+    scores[best] = tempScore;
+  }
+}
+
+void MoveOrdering::updateQuietCutoff(const Colour side, const Move & move, const int depth, const int ply) {
+  if (options.killers && ply < MAX_PLY && move != killers[ply][0]) {
+    killers[ply][1] = killers[ply][0];
+    killers[ply][0] = move;
+  }
+
+  if (options.history) {
+    int & entry = history[side][move.from()][move.to()];
+    entry += depth * depth;
+    // Halve the whole table if an entry grows into the killer band
+    if (entry >= HISTORY_LIMIT) {
+      for (int s = 0; s < 2; s++) {
+	for (int from = 0; from < 64; from++) {
+	  for (int to = 0; to < 64; to++) {
+	    history[s][from][to] /= 2;
+	  }
+	}
+      }
+    }
+  }
+}
+
+MovePicker::MovePicker(ChessBoard & _board, const MoveOrdering & _ordering, const Move & _hashMove, const int _ply)
+  : board(_board), ordering(_ordering), ply(_ply) {
+  // The hash move may come from another position with the same key, so it is checked
+  if (ordering.useHashMove() && board.isLegalMove(_hashMove)) {
+    hashMove = _hashMove;
+  }
+  for (int slot = 0; slot < 2; slot++) {
+    Move killer = ordering.getKiller(ply, slot);
+    // Killers come from sibling nodes, only a legal quiet move is used
+    if (killer != hashMove && (slot == 0 || killer != killers[0]) && !killer.isPromotion() && !board.isCapture(killer) && board.isLegalMove(killer)) {
+      killers[slot] = killer;
+    }
+  }
+}
+
+Move MovePicker::next() {
+  switch (stage) {
+  case StageHash:
+    stage = StageNoisyGenerate;
+    if (!hashMove.isNull()) {
+      return hashMove;
+    }
+    // fall through
+  case StageNoisyGenerate:
+    board.generateNoisyMoves(moves);
+    for (int i = 0; i < moves.size(); i++) {
+      scores[i] = ordering.scoreNoisy(board, moves[i]);
+    }
+    index = 0;
+    stage = StageNoisy;
+    // fall through
+  case StageNoisy:
+    while (index < moves.size()) {
+      MoveOrdering::pickNext(moves, scores, index);
+      const Move & move = moves[index++];
+      if (move != hashMove) {
+	return move;
+      }
+    }
+    stage = StageKillers;
+    // fall through
+  case StageKillers:
+    while (killerIndex < 2) {
+      const Move & killer = killers[killerIndex++];
+      if (!killer.isNull()) {
+	return killer;
+      }
+    }
+    stage = StageQuietGenerate;
+    // fall through
+  case StageQuietGenerate:
+    board.generateQuietMoves(moves);
+    for (int i = 0; i < moves.size(); i++) {
+      scores[i] = ordering.scoreQuiet(board.getSideToMove(), moves[i]);
+    }
+    index = 0;
+    stage = StageQuiet;
+    // fall through
+  case StageQuiet:
+    while (index < moves.size()) {
+      MoveOrdering::pickNext(moves, scores, index);
+      const Move & move = moves[index++];
+      if (!isSpecial(move)) {
+	return move;
+      }
+    }
+    stage = StageDone;
+    // fall through
+  case StageDone:
+    break;
+  }
+  return Move();
+}
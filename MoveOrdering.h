@@ -0,0 +1,119 @@
+#ifndef MOVEORDERING_H
+#define MOVEORDERING_H
+
+#include"Move.h"
+#include"Pieces.h"
+
+class ChessBoard;
+
+/** Maximum search depth in plies, sizes the killer table and the search stack. */
+const int MAX_PLY = 64;
+
+/** Which heuristics are used to order moves, so each one can be measured on its own. */
+struct OrderingOptions {
+  bool hashMove = true;
+  bool mvvLva = true;
+  bool killers = true;
+  bool history = true;
+};
+
+/** Killer and history tables and the move scores used by MovePicker.
+ *  Order: hash move, captures and promotions by MVV-LVA (most valuable victim, least valuable attacker),
+ *  the two killer moves of the ply, then quiet moves by their butterfly history score.
+ */
+class MoveOrdering {
+public:
+  MoveOrdering() { clear(); }
+
+  /** Clears killers and history, called before a new search. */
+  void clear();
+
+  /** Sets which heuristics are applied by the move scores. */
+  void setOptions(const OrderingOptions & _options) { options = _options; }
+
+  /** Scores a capture or promotion by MVV-LVA, higher is searched first.
+   *  @param board: The board the move was generated on.
+   *  @param move: The capture or promotion.
+   */
+  int scoreNoisy(const ChessBoard & board, const Move & move) const;
+
+  /** Scores a quiet move by its history, higher is searched first. */
+  int scoreQuiet(const Colour side, const Move & move) const {
+    return options.history ? history[side][move.from()][move.to()] : 0;
+  }
+
+  /** Gets a killer move of a ply, a null move if there is none or killers are disabled.
+   *  @param ply: Distance from the root.
+   *  @param slot: 0 for the most recent killer, 1 for the one before.
+   */
+  Move getKiller(const int ply, const int slot) const {
+    return options.killers && ply < MAX_PLY ? killers[ply][slot] : Move();
+  }
+
+  /** Checks if the hash move is tried first. */
+  bool useHashMove() const { return options.hashMove; }
+
+  /** Swaps the highest scored move from index onwards into position index (selection sort step).
+   *  Picking one move at a time avoids sorting moves that are never searched after a cutoff.
+   */
+  static void pickNext(MoveList & moves, int scores[], const int index);
+
+  /** Records a quiet move that caused a beta cutoff.
+   *  @param side: The colour that played the move.
+   *  @param move: The cutoff move.
+   *  @param depth: Remaining depth, deeper cutoffs get a larger history bonus.
+   *  @param ply: Distance from the root.
+   */
+  void updateQuietCutoff(const Colour side, const Move & move, const int depth, const int ply);
+
+private:
+  OrderingOptions options;
+
+  /** Two killer moves per ply, slot 0 is the most recent. */
+  Move killers[MAX_PLY][2];
+
+  /** Butterfly history table, indexed by colour, from square and to square. */
+  int history[2][64][64];
+};
+
+/** Hands out the moves of a node one at a time in stages, generating each class of move only
+ *  when it is reached: the hash move, then captures and promotions by MVV-LVA, then the killers,
+ *  and only then the quiet moves by history. A node that cuts off on the hash move or a capture
+ *  never generates its quiet moves.
+ */
+class MovePicker {
+public:
+  /** Creates a picker for the current position of a board.
+   *  @param _board: The board, which must be in the same position whenever next() is called.
+   *  @param _ordering: The killer and history tables.
+   *  @param _hashMove: Best move stored in the transposition table, or a null move.
+   *  @param _ply: Distance from the root, selects the killer slots.
+   */
+  MovePicker(ChessBoard & _board, const MoveOrdering & _ordering, const Move & _hashMove, const int _ply);
+
+  /** Gets the next move to search.
+   *  @return The move, or a null move once every legal move has been returned.
+   */
+  Move next();
+
+private:
+  enum Stage { StageHash, StageNoisyGenerate, StageNoisy, StageKillers, StageQuietGenerate, StageQuiet, StageDone };
+
+  ChessBoard & board;
+  const MoveOrdering & ordering;
+  Move hashMove;
+  Move killers[2];
+  int ply;
+  Stage stage = StageHash;
+  int killerIndex = 0;
+
+  /** Moves of the current generated stage, with their scores. */
+  MoveList moves;
+  int scores[MAX_MOVES];
+  int index = 0;
+
+  /** Checks if a move was already returned by the hash or killer stage. */
+  bool isSpecial(const Move & move) const { return move == hashMove || move == killers[0] || move == killers[1]; }
+};
+
+#endif // MOVEORDERING_H
@@ -0,0 +1,431 @@
+#include"Nnue.h"
+#include"Move.h"
+#include<cstdio>
+#include<cstring>
+#include<memory>
+#include<type_traits>
+#include<vector>
+
+#if defined(__AVX2__)
+#include<immintrin.h>
+#elif defined(__SSE2__)
+#include<emmintrin.h>
+#endif
+
+namespace {
+  const uint8_t FILE_MAGIC[4] = {'C', 'N', 'U', 'E'};
+  const uint8_t FILE_VERSION = 1;
+  /** Largest value an activation is clipped to, so a u8 x i8 product pair fits in an int16. */
+  const int ACTIVATION_MAX = 127;
+
+  /** Flips Black's view so both sides see their own pieces from the bottom rows. */
+  int orient(const Colour perspective, const int square) { return perspective == White ? square : square ^ 56; }
+
+  int kingBucket(const Colour perspective, const int kingSquare) {
+    int square = orient(perspective, kingSquare);
+    return (squareRow(square) == 7 ? 0 : 2) + (squareCol(square) >= 4 ? 1 : 0);
+  }
+
+  /** The side's own king is no feature, its square only picks the bucket. */
+  bool isOwnKing(const Colour perspective, const uint8_t piece) {
+    return pieceCodeType(piece) == KingType && pieceCodeColour(piece) == perspective;
+  }
+
+  int featureIndex(const Colour perspective, const int bucket, const uint8_t piece, const int square) {
+    int kind = pieceCodeType(piece) - 1 + (pieceCodeColour(piece) == perspective ? 0 : 6);
+    return (bucket * 12 + kind) * 64 + orient(perspective, square);
+  }
+
+  /** to = from - the removed rows + the added rows, over NNUE_HIDDEN values. */
+  void addRows(const int16_t* from, int16_t* to, const int16_t* const* removed, const int removedCount,
+	       const int16_t* const* added, const int addedCount) {
+#if defined(__AVX2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+      __m256i sum = _mm256_load_si256(reinterpret_cast<const __m256i*>(from + i));
+      for (int r = 0; r < removedCount; r++) {
+	sum = _mm256_sub_epi16(sum, _mm256_load_si256(reinterpret_cast<const __m256i*>(removed[r] + i)));
+      }
+      for (int a = 0; a < addedCount; a++) {
+	sum = _mm256_add_epi16(sum, _mm256_load_si256(reinterpret_cast<const __m256i*>(added[a] + i)));
+      }
+      _mm256_store_si256(reinterpret_cast<__m256i*>(to + i), sum);
+    }
+#elif defined(__SSE2__)
+    for (int i = 0; i < NNUE_HIDDEN; i += 8) {
+      __m128i sum = _mm_load_si128(reinterpret_cast<const __m128i*>(from + i));
+      for (int r = 0; r < removedCount; r++) {
+	sum = _mm_sub_epi16(sum, _mm_load_si128(reinterpret_cast<const __m128i*>(removed[r] + i)));
+      }
+      for (int a = 0; a < addedCount; a++) {
+	sum = _mm_add_epi16(sum, _mm_load_si128(reinterpret_cast<const __m128i*>(added[a] + i)));
+      }
+      _mm_store_si128(reinterpret_cast<__m128i*>(to + i), sum);
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      int16_t sum = from[i];
+      for (int r = 0; r < removedCount; r++) {
+	sum -= removed[r][i];
+      }
+      for (int a = 0; a < addedCount; a++) {
+	sum += added[a][i];
+      }
+      to[i] = sum;
+    }
+#endif
+  }
+
+  /** Clips NNUE_HIDDEN accumulator values to [0, ACTIVATION_MAX]. */
+  void clipAccumulator(const int16_t* values, uint8_t* out) {
+#if defined(__AVX2__)
+    const __m256i maximum = _mm256_set1_epi16(ACTIVATION_MAX);
+    for (int i = 0; i < NNUE_HIDDEN; i += 32) {
+      __m256i low = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + i)), maximum);
+      __m256i high = _mm256_min_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(values + i + 16)), maximum);
+      // packus clips negatives to 0 but interleaves the 128-bit halves, the permute puts them back in order
+      __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8);
+      _mm256_store_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+#elif defined(__SSE2__)
+    const __m128i maximum = _mm_set1_epi16(ACTIVATION_MAX);
+    for (int i = 0; i < NNUE_HIDDEN; i += 16) {
+      __m128i low = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i)), maximum);
+      __m128i high = _mm_min_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i + 8)), maximum);
+      _mm_store_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, high));
+    }
+#else
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      out[i] = values[i] < 0 ? 0 : (values[i] > ACTIVATION_MAX ? ACTIVATION_MAX : values[i]);
+    }
+#endif
+  }
+
+  /** out[k] = biases[k] + the dot product of the input with weight row k.
+   *  SSE2 works on four rows at a time, so each input it widens to int16 serves all four.
+   *  @param inputs: Number of inputs, a multiple of 32, each at most ACTIVATION_MAX.
+   */
+  void dense(const uint8_t* input, const int inputs, const int8_t* weights, const int32_t* biases,
+	     const int outputs, int32_t* out) {
+    int k = 0;
+#if defined(__AVX2__)
+    const __m256i ones = _mm256_set1_epi16(1);
+    // With AVX2 one row at a time measured faster than four
+    for (; k < outputs; k++) {
+      const int8_t* row = weights + k * inputs;
+      __m256i sum = _mm256_setzero_si256();
+      for (int j = 0; j < inputs; j += 32) {
+	__m256i x = _mm256_load_si256(reinterpret_cast<const __m256i*>(input + j));
+	__m256i w = _mm256_load_si256(reinterpret_cast<const __m256i*>(row + j));
+	// Pairs of u8 x i8 products into int16, which cannot saturate with inputs clipped to 127
+	sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(x, w), ones));
+      }
+      __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+      half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+      out[k] = biases[k] + _mm_cvtsi128_si32(half);
+    }
+#elif defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; k + 4 <= outputs; k += 4) {
+      __m128i sums[4] = {zero, zero, zero, zero};
+      for (int j = 0; j < inputs; j += 16) {
+	__m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(input + j));
+	__m128i xLow = _mm_unpacklo_epi8(x, zero);
+	__m128i xHigh = _mm_unpackhi_epi8(x, zero);
+	for (int r = 0; r < 4; r++) {
+	  __m128i w = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + (k + r) * inputs + j));
+	  // SSE2 has no u8 x i8 multiply: widen the inputs with zeros and the weights with their sign
+	  __m128i wLow = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+	  __m128i wHigh = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+	  sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(xLow, wLow));
+	  sums[r] = _mm_add_epi32(sums[r], _mm_madd_epi16(xHigh, wHigh));
+	}
+      }
+      // Transpose and add, leaving the four rows' totals side by side
+      __m128i pair01 = _mm_add_epi32(_mm_unpacklo_epi32(sums[0], sums[1]), _mm_unpackhi_epi32(sums[0], sums[1]));
+      __m128i pair23 = _mm_add_epi32(_mm_unpacklo_epi32(sums[2], sums[3]), _mm_unpackhi_epi32(sums[2], sums[3]));
+      __m128i total = _mm_add_epi32(_mm_unpacklo_epi64(pair01, pair23), _mm_unpackhi_epi64(pair01, pair23));
+      total = _mm_add_epi32(total, _mm_loadu_si128(reinterpret_cast<const __m128i*>(biases + k)));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + k), total);
+    }
+#endif
+    // Rows left over, and all of them without vector kernels
+    for (; k < outputs; k++) {
+      int32_t sum = biases[k];
+      for (int j = 0; j < inputs; j++) {
+	sum += input[j] * weights[k * inputs + j];
+      }
+      out[k] = sum;
+    }
+  }
+
+  /** The activation of a dense layer, applied to its sums. */
+  void activate(const int32_t* sums, uint8_t* out, const int count) {
+    for (int k = 0; k < count; k++) {
+      int32_t value = sums[k] >> NNUE_LAYER_SHIFT;
+      out[k] = value < 0 ? 0 : (value > ACTIVATION_MAX ? ACTIVATION_MAX : value);
+    }
+  }
+
+  template<typename T>
+  bool writeValues(FILE* out, const T* values, const size_t count) {
+    std::vector<uint8_t> bytes(count * sizeof(T));
+    for (size_t i = 0; i < count; i++) {
+      typename std::make_unsigned<T>::type value = values[i];
+      for (size_t b = 0; b < sizeof(T); b++, value >>= 8) {
+	bytes[i * sizeof(T) + b] = static_cast<uint8_t>(value);
+      }
+    }
+    return fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+  }
+
+  template<typename T>
+  bool readValues(FILE* in, T* values, const size_t count) {
+    std::vector<uint8_t> bytes(count * sizeof(T));
+    if (fread(bytes.data(), 1, bytes.size(), in) != bytes.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      typename std::make_unsigned<T>::type value = 0;
+      for (size_t b = sizeof(T); b-- > 0;) {
+	value = value << 8 | bytes[i * sizeof(T) + b];
+      }
+      values[i] = static_cast<T>(value);
+    }
+    return true;
+  }
+}
+
+bool Network::load(const char* path) {
+  FILE* in = fopen(path, "rb");
+  if (in == nullptr) {
+    return false;
+  }
+  // Read into a scratch network so a bad file leaves the weights alone
+  std::unique_ptr<Network> loaded(new Network());
+  uint8_t header[8];
+  uint32_t sizes[3];
+  bool ok = fread(header, 1, sizeof(header), in) == sizeof(header) && memcmp(header, FILE_MAGIC, 4) == 0 &&
+    header[4] == FILE_VERSION && readValues(in, sizes, 3) && sizes[0] == NNUE_FEATURES &&
+    sizes[1] == NNUE_HIDDEN && sizes[2] == NNUE_LAYER_SIZE &&
+    readValues(in, loaded->featureBiases, NNUE_HIDDEN) &&
+    readValues(in, &loaded->featureWeights[0][0], NNUE_FEATURES * NNUE_HIDDEN) &&
+    readValues(in, loaded->layer1Biases, NNUE_LAYER_SIZE) &&
+    readValues(in, &loaded->layer1Weights[0][0], NNUE_LAYER_SIZE * 2 * NNUE_HIDDEN) &&
+    readValues(in, loaded->layer2Biases, NNUE_LAYER_SIZE) &&
+    readValues(in, &loaded->layer2Weights[0][0], NNUE_LAYER_SIZE * NNUE_LAYER_SIZE) &&
+    readValues(in, &loaded->outputBias, 1) && readValues(in, loaded->outputWeights, NNUE_LAYER_SIZE) &&
+    fgetc(in) == EOF;
+  fclose(in);
+  if (ok) {
+    *this = *loaded;
+  }
+  return ok;
+}
+
+bool Network::save(const char* path) const {
+  FILE* out = fopen(path, "wb");
+  if (out == nullptr) {
+    return false;
+  }
+  uint8_t header[8] = {FILE_MAGIC[0], FILE_MAGIC[1], FILE_MAGIC[2], FILE_MAGIC[3], FILE_VERSION, 0, 0, 0};
+  uint32_t sizes[3] = {NNUE_FEATURES, NNUE_HIDDEN, NNUE_LAYER_SIZE};
+  bool ok = fwrite(header, 1, sizeof(header), out) == sizeof(header) && writeValues(out, sizes, 3) &&
+    writeValues(out, featureBiases, NNUE_HIDDEN) &&
+    writeValues(out, &featureWeights[0][0], NNUE_FEATURES * NNUE_HIDDEN) &&
+    writeValues(out, layer1Biases, NNUE_LAYER_SIZE) &&
+    writeValues(out, &layer1Weights[0][0], NNUE_LAYER_SIZE * 2 * NNUE_HIDDEN) &&
+    writeValues(out, layer2Biases, NNUE_LAYER_SIZE) &&
+    writeValues(out, &layer2Weights[0][0], NNUE_LAYER_SIZE * NNUE_LAYER_SIZE) &&
+    writeValues(out, &outputBias, 1) && writeValues(out, outputWeights, NNUE_LAYER_SIZE);
+  return fclose(out) == 0 && ok;
+}
+
+void Network::setFromMaterial() {
+  memset(static_cast<void*>(this), 0, sizeof(*this));
+  // Neurons 0-4 count the own pawns to queens and 5-9 the opposing ones, each piece adding
+  // PER_PIECE of its type. That is as large as it can be without clipping the usual number of
+  // pieces, and the output weight makes PER_PIECE * weight / NNUE_OUTPUT_SCALE the piece value.
+  const int PER_PIECE[6] = {0, 15, 30, 30, 40, 60};
+  const int OUTPUT_WEIGHT[6] = {0, 53, 85, 88, 100, 120};
+  // Neurons 10 and 11 sum the centralisation bonus of the own and opposing minor pieces and pawns
+  const int OWN_CENTRE = 10, OPPOSING_CENTRE = 11;
+
+  for (int bucket = 0; bucket < NNUE_KING_BUCKETS; bucket++) {
+    for (int kind = 0; kind < 12; kind++) {
+      int type = kind % 6 + 1;
+      bool own = kind < 6;
+      if (type == KingType) {
+	continue;
+      }
+      for (int square = 0; square < 64; square++) {
+	int16_t* weights = featureWeights[(bucket * 12 + kind) * 64 + square];
+	weights[(own ? 0 : 5) + type - 1] = PER_PIECE[type];
+	if (type == PawnType || type == KnightType || type == BishopType) {
+	  // The bonus of Evaluation.cpp, which looks the same from both sides of the board
+	  int row = squareRow(square), col = squareCol(square);
+	  int rowDistance = row < 4 ? 3 - row : row - 4;
+	  int colDistance = col < 4 ? 3 - col : col - 4;
+	  weights[own ? OWN_CENTRE : OPPOSING_CENTRE] = 10 - 3 * (rowDistance + colDistance) / 2;
+	}
+      }
+    }
+  }
+  // Both dense layers pass the neurons through unchanged, the side to move's half comes first
+  for (int k = 0; k <= OPPOSING_CENTRE; k++) {
+    layer1Weights[k][k] = 1 << NNUE_LAYER_SHIFT;
+    layer2Weights[k][k] = 1 << NNUE_LAYER_SHIFT;
+  }
+  for (int type = PawnType; type <= QueenType; type++) {
+    outputWeights[type - 1] = OUTPUT_WEIGHT[type];
+    outputWeights[type + 4] = -OUTPUT_WEIGHT[type];
+  }
+  outputWeights[OWN_CENTRE] = NNUE_OUTPUT_SCALE;
+  outputWeights[OPPOSING_CENTRE] = -NNUE_OUTPUT_SCALE;
+}
+
+void Network::randomise(uint64_t seed) {
+  // xorshift64, with values in ranges where the clipped activations are neither all 0 nor all 127
+  auto next = [&seed](const int range) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return static_cast<int>(seed % (2 * range + 1)) - range;
+  };
+  for (int i = 0; i < NNUE_HIDDEN; i++) {
+    featureBiases[i] = next(32);
+  }
+  for (int f = 0; f < NNUE_FEATURES; f++) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      featureWeights[f][i] = next(16);
+    }
+  }
+  for (int k = 0; k < NNUE_LAYER_SIZE; k++) {
+    layer1Biases[k] = next(1024);
+    layer2Biases[k] = next(1024);
+    outputWeights[k] = next(64);
+    for (int j = 0; j < 2 * NNUE_HIDDEN; j++) {
+      layer1Weights[k][j] = next(8);
+    }
+    for (int j = 0; j < NNUE_LAYER_SIZE; j++) {
+      layer2Weights[k][j] = next(32);
+    }
+  }
+  outputBias = 0;
+}
+
+void Network::refresh(const uint8_t mailbox[64], const Colour perspective, Accumulator & accumulator) const {
+  int kingSquare = 0;
+  for (int square = 0; square < 64; square++) {
+    if (isOwnKing(perspective, mailbox[square])) {
+      kingSquare = square;
+    }
+  }
+  accumulator.kingSquares[perspective] = kingSquare;
+  int bucket = kingBucket(perspective, kingSquare);
+  int16_t* values = accumulator.values[perspective];
+  memcpy(values, featureBiases, sizeof(featureBiases));
+  // Add the rows four at a time, so the values make fewer trips through memory
+  const int16_t* rows[4];
+  int count = 0;
+  for (int square = 0; square < 64; square++) {
+    uint8_t piece = mailbox[square];
+    if (piece == 0 || isOwnKing(perspective, piece)) {
+      continue;
+    }
+    rows[count++] = featureWeights[featureIndex(perspective, bucket, piece, square)];
+    if (count == 4) {
+      addRows(values, values, nullptr, 0, rows, count);
+      count = 0;
+    }
+  }
+  addRows(values, values, nullptr, 0, rows, count);
+}
+
+void Network::update(const Accumulator & from, Accumulator & to, const Colour perspective,
+		     const FeatureChanges & changes) const {
+  int bucket = kingBucket(perspective, from.kingSquares[perspective]);
+  to.kingSquares[perspective] = from.kingSquares[perspective];
+  const int16_t* removed[3];
+  const int16_t* added[2];
+  int removedCount = 0, addedCount = 0;
+  for (int i = 0; i < changes.removedCount; i++) {
+    if (!isOwnKing(perspective, changes.removedPieces[i])) {
+      removed[removedCount++] =
+	featureWeights[featureIndex(perspective, bucket, changes.removedPieces[i], changes.removedSquares[i])];
+    }
+  }
+  for (int i = 0; i < changes.addedCount; i++) {
+    if (isOwnKing(perspective, changes.addedPieces[i])) {
+      to.kingSquares[perspective] = changes.addedSquares[i];
+    } else {
+      added[addedCount++] =
+	featureWeights[featureIndex(perspective, bucket, changes.addedPieces[i], changes.addedSquares[i])];
+    }
+  }
+  addRows(from.values[perspective], to.values[perspective], removed, removedCount, added, addedCount);
+}
+
+int Network::evaluate(const Accumulator & accumulator, const Colour sideToMove) const {
+  alignas(64) uint8_t input[2 * NNUE_HIDDEN];
+  alignas(64) uint8_t hidden1[NNUE_LAYER_SIZE];
+  alignas(64) uint8_t hidden2[NNUE_LAYER_SIZE];
+  int32_t sums[NNUE_LAYER_SIZE];
+  int32_t output;
+
+  clipAccumulator(accumulator.values[sideToMove], input);
+  clipAccumulator(accumulator.values[sideToMove == White ? Black : White], input + NNUE_HIDDEN);
+  dense(input, 2 * NNUE_HIDDEN, &layer1Weights[0][0], layer1Biases, NNUE_LAYER_SIZE, sums);
+  activate(sums, hidden1, NNUE_LAYER_SIZE);
+  dense(hidden1, NNUE_LAYER_SIZE, &layer2Weights[0][0], layer2Biases, NNUE_LAYER_SIZE, sums);
+  activate(sums, hidden2, NNUE_LAYER_SIZE);
+  dense(hidden2, NNUE_LAYER_SIZE, outputWeights, &outputBias, 1, &output);
+  return output / NNUE_OUTPUT_SCALE;
+}
+
+int Network::evaluateScalar(const Accumulator & accumulator, const Colour sideToMove) const {
+  uint8_t input[2 * NNUE_HIDDEN];
+  uint8_t hidden1[NNUE_LAYER_SIZE], hidden2[NNUE_LAYER_SIZE];
+  int32_t sums[NNUE_LAYER_SIZE];
+
+  const Colour sides[2] = {sideToMove, sideToMove == White ? Black : White};
+  for (int half = 0; half < 2; half++) {
+    for (int i = 0; i < NNUE_HIDDEN; i++) {
+      int16_t value = accumulator.values[sides[half]][i];
+      input[half * NNUE_HIDDEN + i] = value < 0 ? 0 : (value > ACTIVATION_MAX ? ACTIVATION_MAX : value);
+    }
+  }
+  for (int k = 0; k < NNUE_LAYER_SIZE; k++) {
+    sums[k] = layer1Biases[k];
+    for (int j = 0; j < 2 * NNUE_HIDDEN; j++) {
+      sums[k] += input[j] * layer1Weights[k][j];
+    }
+  }
+  activate(sums, hidden1, NNUE_LAYER_SIZE);
+  for (int k = 0; k < NNUE_LAYER_SIZE; k++) {
+    sums[k] = layer2Biases[k];
+    for (int j = 0; j < NNUE_LAYER_SIZE; j++) {
+      sums[k] += hidden1[j] * layer2Weights[k][j];
+    }
+  }
+  activate(sums, hidden2, NNUE_LAYER_SIZE);
+  int32_t output = outputBias;
+  for (int j = 0; j < NNUE_LAYER_SIZE; j++) {
+    output += hidden2[j] * outputWeights[j];
+  }
+  return output / NNUE_OUTPUT_SCALE;
+}
+
+bool Network::changesBucket(const Colour kingColour, const int fromSquare, const int toSquare) {
+  return kingBucket(kingColour, fromSquare) != kingBucket(kingColour, toSquare);
+}
+
+const char* Network::kernelName() {
+#if defined(__AVX2__)
+  return "AVX2";
+#elif defined(__SSE2__)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
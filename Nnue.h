@@ -0,0 +1,134 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include"Pieces.h"
+#include<cstdint>
+
+/** A small efficiently updatable neural network for evaluating positions.
+ *
+ *  Each side's view of the board is a set of binary features, one per piece other than the own
+ *  king: the piece's type and owner (own or opposing), its square, and which of 4 buckets the own
+ *  king stands in. Black's view is flipped top to bottom so both sides see their pieces from the
+ *  first rank. The features select rows of an int16 weight matrix whose sum, the accumulator,
+ *  is kept up to date move by move: a quiet move changes one row out and one in, so it costs a
+ *  couple of vector adds instead of summing every piece again.
+ *
+ *  To evaluate, both accumulators are clipped to [0, 127], the side to move's first, and go
+ *  through two int8 dense layers of NNUE_LAYER_SIZE neurons with the same clipped activation and
+ *  a final int8 layer to one output, NNUE_OUTPUT_SCALE units per centipawn.
+ *
+ *  The kernels use AVX2 when the compiler targets it (make SIMD_FLAGS=-mavx2), SSE2 on any other
+ *  x86-64 build and plain loops elsewhere. Every path gives exactly the same result.
+ */
+
+/** Neurons of each side's accumulator. */
+const int NNUE_HIDDEN = 256;
+/** Neurons of each of the two dense hidden layers. */
+const int NNUE_LAYER_SIZE = 32;
+/** King buckets: back rank or not, queen side or king side. */
+const int NNUE_KING_BUCKETS = 4;
+/** Features of one side: king bucket x 12 piece kinds (own and opposing) x 64 squares. */
+const int NNUE_FEATURES = NNUE_KING_BUCKETS * 12 * 64;
+/** Network output units per centipawn. */
+const int NNUE_OUTPUT_SCALE = 8;
+/** Dense layer sums are shifted right by this many bits before they are clipped. */
+const int NNUE_LAYER_SHIFT = 6;
+
+/** The accumulators of a position, indexed by the Colour whose view they hold. */
+struct alignas(64) Accumulator {
+  int16_t values[2][NNUE_HIDDEN];
+  /** Square index of each side's king, which picks the bucket of its features. */
+  int kingSquares[2];
+};
+
+/** Pieces a move took off and put on the board, as piece codes and square indexes.
+ *  A castling move with a capture is impossible, so two of each is the most a move needs,
+ *  plus one more removal when a capture promotes.
+ */
+struct FeatureChanges {
+  uint8_t removedPieces[3], addedPieces[2];
+  int removedSquares[3], addedSquares[2];
+  int removedCount = 0, addedCount = 0;
+
+  void clear() { removedCount = addedCount = 0; }
+
+  void remove(const uint8_t piece, const int square) {
+    removedPieces[removedCount] = piece;
+    removedSquares[removedCount++] = square;
+  }
+
+  void add(const uint8_t piece, const int square) {
+    addedPieces[addedCount] = piece;
+    addedSquares[addedCount++] = square;
+  }
+};
+
+/** Weights of an evaluation network, shared read only by any number of boards and threads. */
+class Network {
+public:
+  /** Loads a network file written by save().
+   *  The file is an 8 byte header ("CNUE", version 1, then 3 zero bytes), the layer sizes as
+   *  4 byte integers for checking, then each layer's biases and weights, little endian.
+   *  @param path: The file to read.
+   *  @return False if the file cannot be read or is not a network of this shape, the weights
+   *  are then unchanged.
+   */
+  bool load(const char* path);
+
+  /** Writes the network to a file that load() reads back.
+   *  @return False if the file could not be written.
+   */
+  bool save(const char* path) const;
+
+  /** Sets weights that reproduce evaluateMaterial(), the handcrafted material plus
+   *  centralisation without the pawn structure, to within a few centipawns. It gives the engine a sensible network before a trained one
+   *  is loaded, and a known answer to check the kernels against.
+   */
+  void setFromMaterial();
+
+  /** Sets random weights in the ranges of a trained network, for timing. */
+  void randomise(uint64_t seed);
+
+  /** Computes one side's accumulator from scratch.
+   *  @param mailbox: The 64 piece codes of the board.
+   *  @param perspective: The side whose view is computed.
+   *  @param accumulator: Receives the values of that side.
+   */
+  void refresh(const uint8_t mailbox[64], const Colour perspective, Accumulator & accumulator) const;
+
+  /** Applies the changes of a move to one side's accumulator, reading the accumulator of the
+   *  position before and writing the new one in one pass.
+   *  @param from: The accumulator before the move.
+   *  @param to: Receives the accumulator after the move, may be the same as from.
+   *  @param perspective: The side whose view is updated, its king must not have changed bucket.
+   *  @param changes: The pieces the move took off and put on.
+   */
+  void update(const Accumulator & from, Accumulator & to, const Colour perspective,
+	      const FeatureChanges & changes) const;
+
+  /** Runs the dense layers on up to date accumulators.
+   *  @return Score in centipawns from the side to move's point of view.
+   */
+  int evaluate(const Accumulator & accumulator, const Colour sideToMove) const;
+
+  /** evaluate() with plain loops, kept to check the vector kernels against. */
+  int evaluateScalar(const Accumulator & accumulator, const Colour sideToMove) const;
+
+  /** Checks if a king move between two squares needs its side's accumulator refreshed. */
+  static bool changesBucket(const Colour kingColour, const int fromSquare, const int toSquare);
+
+  /** Gets the name of the vector kernels compiled in: "AVX2", "SSE2" or "scalar". */
+  static const char* kernelName();
+
+private:
+  alignas(64) int16_t featureBiases[NNUE_HIDDEN];
+  alignas(64) int16_t featureWeights[NNUE_FEATURES][NNUE_HIDDEN];
+  alignas(64) int32_t layer1Biases[NNUE_LAYER_SIZE];
+  alignas(64) int8_t layer1Weights[NNUE_LAYER_SIZE][2 * NNUE_HIDDEN];
+  alignas(64) int32_t layer2Biases[NNUE_LAYER_SIZE];
+  alignas(64) int8_t layer2Weights[NNUE_LAYER_SIZE][NNUE_LAYER_SIZE];
+  int32_t outputBias;
+  alignas(64) int8_t outputWeights[NNUE_LAYER_SIZE];
+};
+
+#endif // NNUE_H
@@ -0,0 +1,278 @@
+#include"PackedPosition.h"
+#include"ChessBoard.h"
+#include<cstring>
+
+namespace {
+  /** Piece symbol of each 4-bit code, ' ' for unused codes. */
+  const char PIECE_CODES[] = " PNBRQK  pnbrqk ";
+  const uint8_t NO_EN_PASSANT = 0xFF;
+  const uint8_t FILE_MAGIC[4] = {'C', 'P', 'O', 'S'};
+  const uint8_t FILE_VERSION = 1;
+  const uint8_t FLAG_COMPRESSED = 1;
+  /** Positions per block, 128 KB uncompressed. */
+  const size_t BLOCK_POSITIONS = 4096;
+
+  uint8_t pieceCode(const char symbol) {
+    switch (symbol) {
+      case 'P': return 1;
+      case 'N': return 2;
+      case 'B': return 3;
+      case 'R': return 4;
+      case 'Q': return 5;
+      case 'K': return 6;
+      case 'p': return 9;
+      case 'n': return 10;
+      case 'b': return 11;
+      case 'r': return 12;
+      case 'q': return 13;
+      case 'k': return 14;
+      default : return 0;
+    }
+  }
+
+  void putLittleEndian(uint8_t* out, uint64_t value, const int bytes) {
+    for (int i = 0; i < bytes; i++, value >>= 8) {
+      out[i] = static_cast<uint8_t>(value);
+    }
+  }
+
+  uint64_t getLittleEndian(const uint8_t* in, const int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+      value = value << 8 | in[i];
+    }
+    return value;
+  }
+
+  /** XORs each position with the previous one and replaces zero runs by 0, length - 1. */
+  void compressBlock(const std::vector<uint8_t> & block, std::vector<uint8_t> & payload) {
+    // At most two bytes per input byte, trimmed at the end
+    payload.resize(2 * block.size());
+    uint8_t* out = payload.data();
+    size_t i = 0;
+    while (i < block.size()) {
+      uint8_t value = block[i] ^ (i >= PACKED_POSITION_SIZE ? block[i - PACKED_POSITION_SIZE] : 0);
+      if (value != 0) {
+	*out++ = value;
+	i++;
+	continue;
+      }
+      size_t run = 1;
+      while (run < 256 && i + run < block.size() &&
+	     block[i + run] == (i + run >= PACKED_POSITION_SIZE ? block[i + run - PACKED_POSITION_SIZE] : 0)) {
+	run++;
+      }
+      *out++ = 0;
+      *out++ = static_cast<uint8_t>(run - 1);
+      i += run;
+    }
+    payload.resize(out - payload.data());
+  }
+
+  /** Reverses compressBlock(), the block must decode to exactly count positions. */
+  bool decompressBlock(const std::vector<uint8_t> & payload, const size_t count, std::vector<uint8_t> & block) {
+    size_t size = count * PACKED_POSITION_SIZE;
+    block.resize(size);
+    size_t out = 0;
+    for (size_t i = 0; i < payload.size(); i++) {
+      size_t run = 1;
+      uint8_t value = payload[i];
+      if (value == 0) {
+	if (++i == payload.size()) {
+	  return false;
+	}
+	run = payload[i] + 1;
+      }
+      if (out + run > size) {
+	return false;
+      }
+      for (size_t k = 0; k < run; k++, out++) {
+	block[out] = value ^ (out >= PACKED_POSITION_SIZE ? block[out - PACKED_POSITION_SIZE] : 0);
+      }
+    }
+    return out == size;
+  }
+}
+
+bool packPosition(const FenPosition & position, PackedPosition & packed) {
+  memset(packed.bytes, 0, PACKED_POSITION_SIZE);
+  if (position.halfmoveClock < 0 || position.halfmoveClock > 0xFFFF) {
+    return false;
+  }
+  uint64_t occupancy = 0;
+  int pieces = 0;
+  for (int square = 0; square < 64; square++) {
+    char symbol = position.squares[square];
+    if (symbol == '\0') {
+      continue;
+    }
+    // A 33rd piece code would overwrite the flags byte
+    if (pieces == 32) {
+      memset(packed.bytes, 0, PACKED_POSITION_SIZE);
+      return false;
+    }
+    occupancy |= 1ULL << square;
+    uint8_t code = pieceCode(symbol);
+    packed.bytes[8 + pieces / 2] |= pieces % 2 == 0 ? code : code << 4;
+    pieces++;
+  }
+  putLittleEndian(packed.bytes, occupancy, 8);
+
+  uint8_t flags = position.sideToMove == Black ? 1 : 0;
+  for (int k = 0; k < 4; k++) {
+    flags |= position.castling[k] ? 2 << k : 0;
+  }
+  packed.bytes[24] = flags;
+  packed.bytes[25] = position.enPassantSquare < 0 ? NO_EN_PASSANT : static_cast<uint8_t>(position.enPassantSquare);
+  putLittleEndian(packed.bytes + 26, position.halfmoveClock, 2);
+  putLittleEndian(packed.bytes + 28, position.fullmoveNumber, 4);
+  return true;
+}
+
+FenError unpackPosition(const PackedPosition & packed, FenPosition & position) {
+  uint64_t occupancy = getLittleEndian(packed.bytes, 8);
+  if (__builtin_popcountll(occupancy) > 32) {
+    return FenBadPiece;
+  }
+  memset(position.squares, 0, sizeof(position.squares));
+  int pieces = 0, whiteKings = 0, blackKings = 0;
+  for (uint64_t remaining = occupancy; remaining != 0; remaining &= remaining - 1, pieces++) {
+    int square = __builtin_ctzll(remaining);
+    char symbol = PIECE_CODES[(packed.bytes[8 + pieces / 2] >> (pieces % 2 * 4)) & 0xF];
+    if (symbol == ' ') {
+      return FenBadPiece;
+    }
+    if ((symbol == 'p' || symbol == 'P') && (squareRow(square) == 0 || squareRow(square) == 7)) {
+      return FenBadPawnRank;
+    }
+    whiteKings += symbol == 'K';
+    blackKings += symbol == 'k';
+    position.squares[square] = symbol;
+  }
+  if (whiteKings != 1 || blackKings != 1) {
+    return FenBadKingCount;
+  }
+
+  uint8_t flags = packed.bytes[24];
+  if (flags >> 5 != 0) {
+    return FenBadCastling;
+  }
+  position.sideToMove = flags & 1 ? Black : White;
+  for (int k = 0; k < 4; k++) {
+    position.castling[k] = (flags >> (k + 1)) & 1;
+  }
+
+  // As in a FEN string, the en passant square is on rank 6 with White to move and rank 3 with Black
+  uint8_t enPassant = packed.bytes[25];
+  position.enPassantSquare = -1;
+  if (enPassant != NO_EN_PASSANT) {
+    if (enPassant >= 64 || squareRow(enPassant) != (position.sideToMove == White ? 2 : 5)) {
+      return FenBadEnPassant;
+    }
+    position.enPassantSquare = enPassant;
+  }
+  position.halfmoveClock = static_cast<int>(getLittleEndian(packed.bytes + 26, 2));
+  uint64_t fullmoveNumber = getLittleEndian(packed.bytes + 28, 4);
+  if (fullmoveNumber < 1 || fullmoveNumber > 0x7FFFFFFF) {
+    return FenBadFullmoveNumber;
+  }
+  position.fullmoveNumber = static_cast<int>(fullmoveNumber);
+  return checkCastlingAndEnPassant(position);
+}
+
+PackedWriter::PackedWriter(FILE* _out, const bool _compress) : out(_out), compress(_compress) {
+  uint8_t header[8] = {FILE_MAGIC[0], FILE_MAGIC[1], FILE_MAGIC[2], FILE_MAGIC[3],
+		       FILE_VERSION, static_cast<uint8_t>(compress ? FLAG_COMPRESSED : 0), 0, 0};
+  failed = fwrite(header, 1, sizeof(header), out) != sizeof(header);
+  bytesWritten = sizeof(header);
+  block.reserve(BLOCK_POSITIONS * PACKED_POSITION_SIZE);
+}
+
+void PackedWriter::write(const PackedPosition & packed) {
+  block.insert(block.end(), packed.bytes, packed.bytes + PACKED_POSITION_SIZE);
+  if (block.size() == BLOCK_POSITIONS * PACKED_POSITION_SIZE) {
+    flush();
+  }
+}
+
+bool PackedWriter::write(const ChessBoard & board) {
+  FenPosition position;
+  PackedPosition packed;
+  board.getPosition(position);
+  if (!packPosition(position, packed)) {
+    return false;
+  }
+  write(packed);
+  return true;
+}
+
+bool PackedWriter::flush() {
+  if (block.empty() || failed) {
+    block.clear();
+    return !failed;
+  }
+  const std::vector<uint8_t>* data = &block;
+  if (compress) {
+    compressBlock(block, payload);
+    data = &payload;
+  }
+  uint8_t header[8];
+  putLittleEndian(header, block.size() / PACKED_POSITION_SIZE, 4);
+  putLittleEndian(header + 4, data->size(), 4);
+  failed = fwrite(header, 1, sizeof(header), out) != sizeof(header) ||
+    fwrite(data->data(), 1, data->size(), out) != data->size();
+  bytesWritten += sizeof(header) + data->size();
+  block.clear();
+  return !failed;
+}
+
+PackedReader::PackedReader(FILE* _in) : in(_in) {
+  uint8_t header[8];
+  if (fread(header, 1, sizeof(header), in) == sizeof(header) && memcmp(header, FILE_MAGIC, 4) == 0 &&
+      header[4] == FILE_VERSION) {
+    valid = true;
+    compressed = header[5] & FLAG_COMPRESSED;
+  }
+}
+
+bool PackedReader::readBlock() {
+  uint8_t header[8];
+  if (fread(header, 1, sizeof(header), in) != sizeof(header)) {
+    return false;
+  }
+  size_t count = getLittleEndian(header, 4);
+  size_t size = getLittleEndian(header + 4, 4);
+  // An uncompressed block is never larger than its positions, a compressed one at most twice that
+  if (count == 0 || count > BLOCK_POSITIONS || size > 2 * count * PACKED_POSITION_SIZE ||
+      (!compressed && size != count * PACKED_POSITION_SIZE)) {
+    valid = false;
+    return false;
+  }
+  std::vector<uint8_t> & target = compressed ? payload : block;
+  target.resize(size);
+  if (fread(target.data(), 1, size, in) != size || (compressed && !decompressBlock(payload, count, block))) {
+    valid = false;
+    return false;
+  }
+  next = 0;
+  return true;
+}
+
+bool PackedReader::read(PackedPosition & packed) {
+  if (!valid || (next == block.size() && !readBlock())) {
+    return false;
+  }
+  memcpy(packed.bytes, block.data() + next, PACKED_POSITION_SIZE);
+  next += PACKED_POSITION_SIZE;
+  return true;
+}
+
+bool PackedReader::read(ChessBoard & board) {
+  PackedPosition packed;
+  FenPosition position;
+  if (!read(packed) || unpackPosition(packed, position) != FenOk) {
+    return false;
+  }
+  board.setPosition(position);
+  return true;
+}
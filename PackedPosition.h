@@ -0,0 +1,118 @@
+#ifndef PACKEDPOSITION_H
+#define PACKEDPOSITION_H
+
+#include"Fen.h"
+#include<cstdint>
+#include<cstdio>
+#include<vector>
+
+class ChessBoard;
+
+/** Size of a packed position in bytes. */
+const int PACKED_POSITION_SIZE = 32;
+
+/** A position in a fixed 32 byte binary form, for exporting large numbers of positions.
+ *  Bytes 0-7:   occupancy, bit n set if square index n (row * 8 + col, A8 first) holds a piece.
+ *  Bytes 8-23:  one 4-bit piece code per occupied square in square order, low nibble first.
+ *               Codes 1-6 are White P N B R Q K, 9-14 the same for Black.
+ *  Byte 24:     bit 0 the side to move (1 for Black), bits 1-4 the castling rights.
+ *  Byte 25:     en passant square index, or 0xFF.
+ *  Bytes 26-27: halfmove clock, bytes 28-31 fullmove number.
+ *  Multi-byte fields are little endian, so files are portable.
+ */
+struct PackedPosition {
+  uint8_t bytes[PACKED_POSITION_SIZE];
+};
+
+/** Packs a decoded position.
+ *  @param position: A valid position.
+ *  @param packed: Receives the packed bytes, all zero if the position does not fit.
+ *  @return False if the position has more than 32 pieces or a halfmove clock over 65535.
+ */
+bool packPosition(const FenPosition & position, PackedPosition & packed);
+
+/** Unpacks and validates a packed position, as parseFen() does for FEN strings.
+ *  @param packed: The packed bytes.
+ *  @param position: Receives the position, only meaningful if FenOk is returned.
+ *  @return FenOk, or the first problem found.
+ */
+FenError unpackPosition(const PackedPosition & packed, FenPosition & position);
+
+/** Writes packed positions to a file in blocks.
+ *  The file starts with an 8 byte header ("CPOS", version, flags). Each block is a 4 byte
+ *  position count, a 4 byte payload size and the payload. A compressed payload XORs each
+ *  position with the one before it, which leaves mostly zero bytes for positions from the same
+ *  game, and stores runs of zero bytes as a 0 byte followed by the run length minus one.
+ */
+class PackedWriter {
+public:
+  /** Starts a file, the header is written straight away.
+   *  @param _out: The file to write to, opened in binary mode and kept open by the caller.
+   *  @param _compress: Compress each block.
+   */
+  PackedWriter(FILE* _out, const bool _compress = false);
+
+  /** Writes out the last block. */
+  ~PackedWriter() { flush(); }
+
+  PackedWriter(const PackedWriter &) = delete;
+  PackedWriter & operator=(const PackedWriter &) = delete;
+
+  void write(const PackedPosition & packed);
+
+  /** Packs and writes the current position of a board.
+   *  @return False if the position does not fit the packed format, nothing is written then.
+   */
+  bool write(const ChessBoard & board);
+
+  /** Writes the buffered positions as a block.
+   *  @return False if the file could not be written.
+   */
+  bool flush();
+
+  /** Gets the number of bytes written to the file so far. */
+  uint64_t getBytesWritten() const { return bytesWritten; }
+
+private:
+  FILE* out;
+  bool compress;
+  bool failed = false;
+  uint64_t bytesWritten = 0;
+  std::vector<uint8_t> block;
+  std::vector<uint8_t> payload;
+};
+
+/** Reads the files written by PackedWriter, block by block. */
+class PackedReader {
+public:
+  /** Reads the header.
+   *  @param _in: The file to read from, opened in binary mode and kept open by the caller.
+   */
+  explicit PackedReader(FILE* _in);
+
+  /** Checks if the header was valid and no block has been corrupt so far. */
+  bool isValid() const { return valid; }
+
+  /** Reads the next position.
+   *  @return False at the end of the file or on a corrupt block.
+   */
+  bool read(PackedPosition & packed);
+
+  /** Reads the next position and loads it on a board.
+   *  @return False at the end of the file, on a corrupt block or an invalid position.
+   */
+  bool read(ChessBoard & board);
+
+private:
+  FILE* in;
+  bool valid = false;
+  bool compressed = false;
+  std::vector<uint8_t> block;
+  std::vector<uint8_t> payload;
+  size_t next = 0;
+
+  /** Reads and decodes the next block into block. */
+  bool readBlock();
+};
+
+#endif // PACKEDPOSITION_H
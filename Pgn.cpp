@@ -0,0 +1,145 @@
+#include"Pgn.h"
+#include"ChessBoard.h"
+#include<cctype>
+#include<cstring>
+
+int moveToSan(ChessBoard & board, const Move & move, char* san) {
+  int length = 0;
+  char symbol = tolower(board.getPieceSymbol(move.from()));
+  int fromRow = squareRow(move.from()), fromCol = squareCol(move.from());
+
+  if (move.flag() == FlagCastle) {
+    const char* castle = squareCol(move.to()) > fromCol ? "O-O" : "O-O-O";
+    strcpy(san, castle);
+    length = strlen(castle);
+  } else {
+    bool capture = board.isCapture(move);
+    if (symbol == 'p') {
+      // Pawn captures name the file they come from
+      if (capture) {
+	san[length++] = 'a' + fromCol;
+      }
+    } else {
+      san[length++] = toupper(symbol);
+
+      // Disambiguate between pieces of the same kind that can reach the same square
+      MoveList moves;
+      board.generateLegalMoves(moves);
+      bool ambiguous = false, sameCol = false, sameRow = false;
+      for (const Move & other : moves) {
+	if (other.to() != move.to() || other.from() == move.from() ||
+	    tolower(board.getPieceSymbol(other.from())) != symbol) {
+	  continue;
+	}
+	ambiguous = true;
+	sameCol |= squareCol(other.from()) == fromCol;
+	sameRow |= squareRow(other.from()) == fromRow;
+      }
+      if (ambiguous && (!sameCol || sameRow)) {
+	san[length++] = 'a' + fromCol;
+      }
+      if (ambiguous && sameCol) {
+	san[length++] = '8' - fromRow;
+      }
+    }
+    if (capture) {
+      san[length++] = 'x';
+    }
+    san[length++] = 'a' + squareCol(move.to());
+    san[length++] = '8' - squareRow(move.to());
+    if (move.isPromotion()) {
+      san[length++] = '=';
+      san[length++] = toupper(move.promotionSymbol());
+    }
+  }
+
+  // Check or checkmate
+  MoveUndo undo;
+  board.doMove(move, undo);
+  if (board.isSideToMoveInCheck()) {
+    MoveList replies;
+    board.generateLegalMoves(replies);
+    san[length++] = replies.empty() ? '#' : '+';
+  }
+  board.undoMove(move, undo);
+
+  san[length] = '\0';
+  return length;
+}
+
+namespace {
+  /** Copies a SAN move without its check, mate and annotation marks, with castling as "O-O". */
+  void stripSan(const char* san, char* out) {
+    int length = 0;
+    for (; *san != '\0' && length < MAX_SAN_LENGTH - 1; san++) {
+      if (*san == '+' || *san == '#' || *san == '!' || *san == '?') {
+	continue;
+      }
+      out[length++] = *san == '0' ? 'O' : *san;
+    }
+    out[length] = '\0';
+  }
+}
+
+Move sanToMove(ChessBoard & board, const char* san) {
+  char wanted[MAX_SAN_LENGTH], written[MAX_SAN_LENGTH], stripped[MAX_SAN_LENGTH];
+  stripSan(san, wanted);
+  MoveList moves;
+  board.generateLegalMoves(moves);
+  for (const Move & move : moves) {
+    moveToSan(board, move, written);
+    stripSan(written, stripped);
+    if (strcmp(stripped, wanted) == 0) {
+      return move;
+    }
+  }
+  return Move();
+}
+
+void writePgnGame(FILE* out, const PgnTags & tags, const char* startFen, const std::vector<Move> & moves) {
+  fprintf(out, "[Event \"%s\"]\n[Site \"?\"]\n[Date \"????.??.??\"]\n[Round \"%d\"]\n",
+	  tags.event, tags.round);
+  fprintf(out, "[White \"%s\"]\n[Black \"%s\"]\n[Result \"%s\"]\n", tags.white, tags.black, tags.result);
+  if (strcmp(startFen, START_FEN) != 0) {
+    fprintf(out, "[SetUp \"1\"]\n[FEN \"%s\"]\n", startFen);
+  }
+  fprintf(out, "[PlyCount \"%zu\"]\n", moves.size());
+  if (tags.termination != nullptr) {
+    fprintf(out, "[Termination \"%s\"]\n", tags.termination);
+  }
+  fprintf(out, "\n");
+
+  ChessBoard board;
+  board.setFen(startFen);
+  int column = 0;
+  char token[MAX_SAN_LENGTH + 16];
+  bool first = true;
+  for (const Move & move : moves) {
+    // Move numbers before White's moves, and before the first move if Black starts
+    int length = 0;
+    if (board.getSideToMove() == White) {
+      length = sprintf(token, "%d. ", board.getFullmoveNumber());
+    } else if (first) {
+      length = sprintf(token, "%d... ", board.getFullmoveNumber());
+    }
+    length += moveToSan(board, move, token + length);
+    first = false;
+
+    if (column > 0 && column + 1 + length > 80) {
+      fputc('\n', out);
+      column = 0;
+    } else if (column > 0) {
+      fputc(' ', out);
+      column++;
+    }
+    fputs(token, out);
+    column += length;
+    board.makeMove(move);
+  }
+  if (column > 0 && column + 1 + static_cast<int>(strlen(tags.result)) > 80) {
+    fputc('\n', out);
+  } else if (column > 0) {
+    fputc(' ', out);
+  }
+  fprintf(out, "%s\n\n", tags.result);
+}
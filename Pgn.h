@@ -0,0 +1,49 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include"Move.h"
+#include<cstdio>
+#include<vector>
+
+class ChessBoard;
+
+/** Longest SAN move plus the terminator, e.g. "Qh4xe1+" or "exd8=Q#". */
+const int MAX_SAN_LENGTH = 10;
+
+/** Writes a move in standard algebraic notation (e.g. "Nbd7", "exd6", "e8=Q+", "O-O").
+ *  @param board: The board in the position before the move, it is left unchanged.
+ *  @param move: A legal move.
+ *  @param san: Buffer of at least MAX_SAN_LENGTH characters.
+ *  @return The length of the string written.
+ */
+int moveToSan(ChessBoard & board, const Move & move, char* san);
+
+/** Finds the legal move written in standard algebraic notation, e.g. a best move of a test suite.
+ *  The check and mate marks and any annotation ("!", "?") are optional, "0-0" is read as "O-O".
+ *  @param board: The board in the position before the move, it is left unchanged.
+ *  @param san: The move.
+ *  @return The move, or a null move if no legal move is written that way.
+ */
+Move sanToMove(ChessBoard & board, const char* san);
+
+/** Tags of a game written by writePgnGame(). */
+struct PgnTags {
+  const char* event = "?";
+  const char* white = "?";
+  const char* black = "?";
+  int round = 1;
+  /** "1-0", "0-1", "1/2-1/2" or "*". */
+  const char* result = "*";
+  /** Reason the game ended, e.g. "checkmate" or "threefold repetition", nullptr to leave it out. */
+  const char* termination = nullptr;
+};
+
+/** Writes one game in PGN, with SAN moves wrapped at 80 columns and a blank line after it.
+ *  @param out: The file to write to.
+ *  @param tags: The header tags.
+ *  @param startFen: The starting position, a FEN tag is written unless it is the standard start.
+ *  @param moves: The moves of the game from the starting position.
+ */
+void writePgnGame(FILE* out, const PgnTags & tags, const char* startFen, const std::vector<Move> & moves);
+
+#endif // PGN_H
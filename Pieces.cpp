@@ -1,30 +1,45 @@
 #include"Pieces.h"
 #include"ChessBoard.h"
+#include"AttackTables.h"
 #include<iostream>
 #include<cstring>
 #include<cctype>
 
-// Forward declare chessboard for Piece factory
-class ChessBoard;
+namespace {
+  /** The delta rules the leaper attack tables replace, kept to check the tables at compile time. */
+  constexpr int absolute(const int value) { return value < 0 ? -value : value; }
 
-Pieces* PieceFactory::createPiece(char c, Colour colour, ChessBoard* board) {
-  // Return nullptr if character is not alphabetic, indicating an invalid piece type.
-  if (!isalpha(c)) {
-    return nullptr; 
+  constexpr bool knightDeltaRule(const int dy, const int dx) {
+    return (absolute(dy) == 2 && absolute(dx) == 1) || (absolute(dy) == 1 && absolute(dx) == 2);
   }
-  // Normalise character to lowercase to simplify switch-case structure.
-  c = tolower(c); 
-
-  // Switch-case to create a chess piece based on the character input.
-  switch (c) {
-    case 'p': return new Pawn(colour, board);
-    case 'k': return new King(colour, board);
-    case 'r': return new Rook(colour, board);
-    case 'b': return new Bishop(colour, board);
-    case 'n': return new Knight(colour, board);
-    case 'q': return new Queen(colour, board);
-    default : return nullptr; // Return nullptr for unsupported piece types.
+
+  constexpr bool kingDeltaRule(const int dy, const int dx) {
+    return (absolute(dy) == 1 && absolute(dx) <= 1) || (absolute(dx) == 1 && absolute(dy) <= 1);
+  }
+
+  constexpr bool pawnCaptureDeltaRule(const Colour colour, const int dy, const int dx) {
+    return dy == (colour == White ? -1 : 1) && absolute(dx) == 1;
+  }
+
+  /** Compares every table entry with the delta rules for all 64 x 64 square pairs. */
+  constexpr bool leaperTablesMatchDeltaRules() {
+    using namespace AttackTables;
+    for (int from = 0; from < 64; from++) {
+      for (int to = 0; to < 64; to++) {
+	int dy = to / 8 - from / 8;
+	int dx = to % 8 - from % 8;
+	if (contains(KNIGHT_ATTACKS[from], to) != knightDeltaRule(dy, dx) ||
+	    contains(KING_ATTACKS[from], to) != kingDeltaRule(dy, dx) ||
+	    contains(PAWN_ATTACKS[White][from], to) != pawnCaptureDeltaRule(White, dy, dx) ||
+	    contains(PAWN_ATTACKS[Black][from], to) != pawnCaptureDeltaRule(Black, dy, dx)) {
+	  return false;
+	}
+      }
+    }
+    return true;
   }
+
+  static_assert(leaperTablesMatchDeltaRules(), "Leaper attack tables differ from the piece delta rules");
 }
 
 const char * Pieces::getColourString() const {
@@ -38,49 +53,34 @@ void Pieces::calcDyDx(const int sourcePos[2], const int destinationPos[2], int d
   dyDxArray[1] = destinationPos[1] - sourcePos[1]; // dx
 }
 
-void Pieces::makeMove(const int sourcePos[2], const int destinationPos[2]){
-  // Ensure is a valid move
-  if (sourcePos && destinationPos && !board->isInsideBoard(destinationPos[0], destinationPos[1]) && !board->isInsideBoard(sourcePos[0], sourcePos[1])) {
-    return;
-  }
-  // Common move logic
-  char sourceSquare[3] = {'\0'};
-  char destinationSquare[3] = {'\0'};;
-  board->rowColToString(sourceSquare, sourcePos);
-  board->rowColToString(destinationSquare, destinationPos);
- 
-  std::cout << "\n" << this->getColourString() << "'s " << this->getType() << " moves from " << sourceSquare << " to " << destinationSquare;
-
-  // If we are capturing a piece, print statement and delete piece
-  board->movePiece(sourcePos, destinationPos);
-  
-  // Update hasMoved for the moving piece
-  this->updateMoved();
+void Pieces::applyMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  // movePiece() also marks the piece as moved
+  board.movePiece(sourcePos, destinationPos);
 
   // Call helper method for castling rights, is overridden in King and Rook
-  updateCastlingRights(sourcePos, destinationPos);
+  updateCastlingRights(board, sourcePos, destinationPos);
 }
 
-bool Pieces::destinationSameColour(const int destinationPos[2]) const {
+bool Pieces::destinationSameColour(const IChessBoardActions & board, const int destinationPos[2]) const {
   // Check if attempting to check Colour of a Piece outside board bounds.
-  if (!board->isInsideBoard(destinationPos[0], destinationPos[1])) {
+  if (!board.isInsideBoard(destinationPos[0], destinationPos[1])) {
     return false;
   }
   // If the position is not empty
-  if (!board->isPosEmpty(destinationPos)){
+  if (!board.isPosEmpty(destinationPos)){
     // If colour is the same return true
-    return (board->getPosColour(destinationPos) == this->pieceColour);
+    return (board.getPosColour(destinationPos) == this->pieceColour);
   }
   // No piece at the destination
   return false; 
 }
 
 
-void King::updateCastlingRights(const int sourcePos[2], const int destinationPos[2]) {
-  Colour colour = this->pieceColour;
+template<Colour C>
+void King<C>::updateCastlingRights(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
   // Updates the castle array at the index
-  board->setCastleArray(colour == White ? whiteKingSide : blackKingSide, false);
-  board->setCastleArray(colour == White ? whiteQueenSide : blackQueenSide, false);
+  board.setCastleArray(castleIndex(C, true), false);
+  board.setCastleArray(castleIndex(C, false), false);
 
   // Check for castling and move the rook if castling occurs
   int dyDxArray[2];
@@ -100,38 +100,26 @@ void King::updateCastlingRights(const int sourcePos[2], const int destinationPos
     int rookDestinationPos[2] = {sourcePos[0], newRookCol};
 	
     // To handle mid-game FEN positions
-    if (!board->isPosEmpty(rookSourcePos) && colour == board->getPosColour(rookSourcePos)){
-      // Now make the move for the rook, bypassing the hasMoved and updateCastleRights as castling occured.
-      board->movePiece(rookSourcePos, rookDestinationPos);
+    if (!board.isPosEmpty(rookSourcePos) && C == board.getPosColour(rookSourcePos)){
+      // Now make the move for the rook, bypassing updateCastleRights as castling occured.
+      board.movePiece(rookSourcePos, rookDestinationPos);
     }
   }
 }
 
-void Rook::updateCastlingRights(const int sourcePos[2], const int destinationPos[2]) {
-  // Check for castling and move the rook if castling occurs.
-  if (this->pieceColour == White) {
-    // White queen side rook
-    if (sourcePos[1] == 0) {
-      board->setCastleArray(whiteQueenSide, false);
-    }
-    else { // White king side rook
-      board->setCastleArray(whiteKingSide, false);
-    }
-  }
-  else {
-    // Black queen side rook
-    if (sourcePos[1] == 0) {
-      board->setCastleArray(blackQueenSide, false);
-    }
-    else { // Black king side rook
-      board->setCastleArray(blackKingSide, false);
-    }
+template<Colour C>
+void Rook<C>::updateCastlingRights(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  // Only a rook leaving its own corner loses a right, any other rook never had one
+  constexpr int homeRow = C == White ? 7 : 0;
+  if (sourcePos[0] == homeRow && (sourcePos[1] == 0 || sourcePos[1] == 7)) {
+    board.setCastleArray(castleIndex(C, sourcePos[1] == 7), false);
   }
 }
 
 // Pawn specific rules applied for move validity
-bool Pawn::isValidMove(const int sourcePos[2], const int destinationPos[2]) const {
-  if (destinationSameColour(destinationPos)) {
+template<Colour C>
+bool Pawn<C>::isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  if (destinationSameColour(board, destinationPos)) {
       return false;
   }
   
@@ -142,83 +130,84 @@ bool Pawn::isValidMove(const int sourcePos[2], const int destinationPos[2]) cons
   int dx = dyDxArray[1];
 
   // White pawns move from higher row indexes to lower.
-  int direction = (pieceColour == White) ? -1 : 1;
+  constexpr int direction = C == White ? -1 : 1;
   // If on starting row to allow loading of all FEN strings
-  bool isStartingRow = (pieceColour == White) ? sourcePos[0] == 6 : sourcePos[0] == 1;
+  bool isStartingRow = sourcePos[0] == (C == White ? 6 : 1);
   
   // Double move, if it hasn't moved, is in the starting row and the path is clear
-  if (isStartingRow && !this->hasMoved && dy == 2 * direction && dx == 0 && isPathClearStraight(sourcePos, destinationPos) && board->isPosEmpty(destinationPos)) {
+  if (isStartingRow && !board.hasPieceMoved(sourcePos) && dy == 2 * direction && dx == 0 && isPathClearStraight(board, sourcePos, destinationPos) && board.isPosEmpty(destinationPos)) {
     return true;
   } // Single move forward
-  else if (dy == 1 * direction && dx == 0 && board->isPosEmpty(destinationPos)) {
-    return true;
-  } // Diagonal capture (one square diagonal has opposing piece)
-  else if (dy == 1 * direction && abs(dx) == 1 && !board->isPosEmpty(destinationPos) && 
-	   board->getPosColour(destinationPos) != this->pieceColour) {
+  else if (dy == 1 * direction && dx == 0 && board.isPosEmpty(destinationPos)) {
     return true;
   }
+  // Diagonal captures use the compile time pawn attack table
+  if (AttackTables::contains(AttackTables::PAWN_ATTACKS[C][toSquare(sourcePos[0], sourcePos[1])],
+			     toSquare(destinationPos[0], destinationPos[1]))) {
+    // Diagonal capture (one square diagonal has opposing piece)
+    if (!board.isPosEmpty(destinationPos) && board.getPosColour(destinationPos) != C) {
+      return true;
+    }
+    // En passant (diagonal onto the square an enemy pawn just passed over)
+    if (board.isPosEmpty(destinationPos) && board.isEnPassantTarget(destinationPos)) {
+      return true;
+    }
+  }
   // Invalid move
   return false;
 }
 
-bool King::isValidMove(const int sourcePos[2], const int destinationPos[2]) const {
-  if (destinationSameColour(destinationPos)) {
+template<Colour C>
+bool King<C>::isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  if (destinationSameColour(board, destinationPos)) {
     return false;
   }
+  // King can move one square in any direction, looked up in the compile time table
+  if (AttackTables::contains(AttackTables::KING_ATTACKS[toSquare(sourcePos[0], sourcePos[1])],
+			     toSquare(destinationPos[0], destinationPos[1]))) {
+    return true;
+  }
+
   int dyDxArray[2];
   // Modifies the dyDxArray
   calcDyDx(sourcePos, destinationPos, dyDxArray);
   int dy = dyDxArray[0];
   int dx = dyDxArray[1];
 
-  // King can move one square in any direction
-  if ((abs(dy) == 1 && abs(dx) <= 1) || (abs(dx) == 1 && abs(dy) <= 1)) {
-    return true;
-  }
-
   // Castling Logic 
   // If king is in the correct starting position
-  int blackKingStartPos[2] = {0, 4};
-  int whiteKingStartPos[2] = {7, 4};
-  if (this->pieceColour == White) {
-    if (sourcePos[0] != whiteKingStartPos[0] || sourcePos[1] != whiteKingStartPos[1]) {
-      return false;
-    }
-  }
-  else {
-    if (sourcePos[0] != blackKingStartPos[0] || sourcePos[1] != blackKingStartPos[1]) {
-      return false;
-    }
+  if (sourcePos[0] != (C == White ? 7 : 0) || sourcePos[1] != 4) {
+    return false;
   }
   
   // If hasnt moved, a lateral move 2 and not in check
-  if (!this->hasMoved && dy == 0 && abs(dx) == 2 && !board->isKingInCheck(this->pieceColour)) {
+  if (!board.hasPieceMoved(sourcePos) && dy == 0 && abs(dx) == 2 && !board.isKingInCheck(C)) {
     // King or Queen side castle
     int rookColumn = dx == 2 ? 7 : 0; 
     int rookPosition[2] = {sourcePos[0], rookColumn};
 
     // If not inside board, the position is empty, not a rook of the same colour
-    if (!board->isInsideBoard(rookPosition[0], rookPosition[1]) || board->isPosEmpty(rookPosition) ||  board->getPosColour(rookPosition) != this->getColour() || 
-    strcmp(board->getPosType(rookPosition), "Rook") != 0) {
+    if (!board.isInsideBoard(rookPosition[0], rookPosition[1]) || board.isPosEmpty(rookPosition) ||  board.getPosColour(rookPosition) != C || 
+    strcmp(board.getPosType(rookPosition), "Rook") != 0) {
       return false;
     }
     
     int direction = (rookColumn == 7) ? 1 : -1; 
 
     // Check the castling array 
-    if (board->canCastle(direction, this->getColour() )) {
+    if (board.canCastle(direction, C)) {
       int pathStart[2] = {sourcePos[0], sourcePos[1]};
       int pathEnd[2] = {sourcePos[0], rookColumn};
 
       // The path clear from pathStart to Rook position (not inclusive)
-      if (!this->isPathClearStraight(pathStart, pathEnd)) {
+      if (!this->isPathClearStraight(board, pathStart, pathEnd)) {
 	return false; 
       }
 
       // Check for no checks on passing squares
       for (int i = 1; i <= abs(dx); ++i) {
 	int destinationPos[2] = {sourcePos[0], sourcePos[1] + i * direction};
-	if (board->doesMoveCauseCheck(sourcePos, destinationPos, this->getColour())) {
+	if (board.doesMoveCauseCheck(sourcePos, destinationPos, C)) {
 	  // King passes through or lands on a square that is under attack
 	  return false;
         }
@@ -233,21 +222,22 @@ bool King::isValidMove(const int sourcePos[2], const int destinationPos[2]) cons
   return false;
 }
 
-bool Rook::isValidMove(const int sourcePos[2], const int destinationPos[2]) const {
-  if (destinationSameColour(destinationPos)) {
+template<Colour C>
+bool Rook<C>::isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  if (destinationSameColour(board, destinationPos)) {
     return false;
    }
   // Rook moves in straight lines
   if (sourcePos[0] == destinationPos[0] || sourcePos[1] == destinationPos[1]) {
     // Returns true is the path is clear
-    return isPathClearStraight(sourcePos, destinationPos);
+    return isPathClearStraight(board, sourcePos, destinationPos);
   }
   // If not a straight line
   return false;
 }
 
-bool Bishop::isValidMove(const int sourcePos[2], const int destinationPos[2]) const {
-  if (destinationSameColour(destinationPos)) {
+bool Bishop::isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  if (destinationSameColour(board, destinationPos)) {
     return false;
   }
   int dyDxArray[2];
@@ -260,27 +250,22 @@ bool Bishop::isValidMove(const int sourcePos[2], const int destinationPos[2]) co
   // Bishop moves diagonally
   if (abs(dy) == abs(dx)) {
     // Returns true is the path is clear
-    return isPathClearDiagonal(sourcePos, destinationPos);
+    return isPathClearDiagonal(board, sourcePos, destinationPos);
   }
   // If not a straight line
   return false;
 }
 
-bool Knight::isValidMove(const int sourcePos[2], const int destinationPos[2]) const {  
-  if (destinationSameColour(destinationPos)) {
+bool Knight::isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {  
+  if (destinationSameColour(board, destinationPos)) {
     return false;
   }
-  int dyDxArray[2];
-  // Modifies the dyDxArray
-  calcDyDx(sourcePos, destinationPos, dyDxArray);
-  // absolute dy dx for different directions
-  int dy = abs(dyDxArray[0]);
-  int dx = abs(dyDxArray[1]);
-  // Knight moves in an L shape
-  return (dy == 2 && dx == 1) || (dy == 1 && dx == 2);
+  // Knight moves in an L shape, looked up in the compile time table
+  return AttackTables::contains(AttackTables::KNIGHT_ATTACKS[toSquare(sourcePos[0], sourcePos[1])],
+				toSquare(destinationPos[0], destinationPos[1]));
 }
-bool Queen::isValidMove(const int sourcePos[2], const int destinationPos[2]) const {
-  if (destinationSameColour(destinationPos)) {
+bool Queen::isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
+  if (destinationSameColour(board, destinationPos)) {
     return false;
   }
 
@@ -291,16 +276,16 @@ bool Queen::isValidMove(const int sourcePos[2], const int destinationPos[2]) con
   int dx = dyDxArray[1];
 
   // If path is a straight, diagonal and clear
-  bool diagonalGood = (abs(dy) == abs(dx) && isPathClearDiagonal(sourcePos, destinationPos));
+  bool diagonalGood = (abs(dy) == abs(dx) && isPathClearDiagonal(board, sourcePos, destinationPos));
 
   // If path is a straight (horizontal or vertical) and clear
-  bool straightGood = ((sourcePos[0] == destinationPos[0] || sourcePos[1] == destinationPos[1]) && isPathClearStraight(sourcePos, destinationPos));
+  bool straightGood = ((sourcePos[0] == destinationPos[0] || sourcePos[1] == destinationPos[1]) && isPathClearStraight(board, sourcePos, destinationPos));
 
   // False if no clear diagonal and straight paths
   return (diagonalGood || straightGood); 
 }
 
-bool Pieces::isPathClearStraight(const int sourcePos[2], const int destinationPos[2]) const {
+bool Pieces::isPathClearStraight(const IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
   int xStart = sourcePos[0];
   int yStart = sourcePos[1];
   int xEnd = destinationPos[0];
@@ -316,7 +301,7 @@ bool Pieces::isPathClearStraight(const int sourcePos[2], const int destinationPo
       currentPos[0] = xStart;
       currentPos[1] = y;
       // If position not empty
-      if (!board->isPosEmpty(currentPos)) {
+      if (!board.isPosEmpty(currentPos)) {
         return false;
       }
     }
@@ -327,7 +312,7 @@ bool Pieces::isPathClearStraight(const int sourcePos[2], const int destinationPo
       currentPos[0] = x;
       currentPos[1] = yStart;
       // If position not empty
-      if (!board->isPosEmpty(currentPos)) {
+      if (!board.isPosEmpty(currentPos)) {
         return false;
       }
     }
@@ -338,7 +323,7 @@ bool Pieces::isPathClearStraight(const int sourcePos[2], const int destinationPo
   return true;
 }
 
-bool Pieces::isPathClearDiagonal(const int sourcePos[2], const int destinationPos[2]) const {
+bool Pieces::isPathClearDiagonal(const IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {
   int xStart = sourcePos[0];
   int yStart = sourcePos[1];
   int xEnd = destinationPos[0];
@@ -362,7 +347,7 @@ bool Pieces::isPathClearDiagonal(const int sourcePos[2], const int destinationPo
     currentPos[0] = x;
     currentPos[1] = y;
     // If a position is not empty
-    if (!board->isPosEmpty(currentPos)) {
+    if (!board.isPosEmpty(currentPos)) {
       return false;
     }
     x += dx;
@@ -372,3 +357,9 @@ bool Pieces::isPathClearDiagonal(const int sourcePos[2], const int destinationPo
   return true;
 }
 
+template class Pawn<White>;
+template class Pawn<Black>;
+template class King<White>;
+template class King<Black>;
+template class Rook<White>;
+template class Rook<Black>;
@@ -1,25 +1,65 @@
 #ifndef PIECES_H
 #define PIECES_H
 
+#include<cstdint>
 #include<iostream>
 
 /** Global enum to represent piece colour, also used by the ChessBoard class.*/
 enum Colour { White, Black };
 
+/** Piece types, as stored in bits 0-2 of a piece code. */
+enum PieceType { NoPiece, PawnType, KnightType, BishopType, RookType, QueenType, KingType };
+
+/** Piece codes are the bytes of the ChessBoard mailbox, one per square and 0 for an empty square.
+ *  Bits 0-2 hold the PieceType, bit 3 is set for Black and bit 4 once the piece has moved.
+ */
+const uint8_t PIECE_TYPE_MASK = 7;
+const uint8_t PIECE_BLACK = 8;
+const uint8_t PIECE_MOVED = 16;
+
+/** Lowercase FEN symbol of each PieceType. */
+const char PIECE_TYPE_SYMBOLS[] = " pnbrqk";
+
+/** Makes the code of a piece that has not moved.
+ *  @param symbol: FEN symbol of the piece, either case.
+ *  @param colour: The enum Colour of the piece.
+ *  @return The piece code, or 0 for an unknown symbol.
+ */
+inline uint8_t makePieceCode(const char symbol, const Colour colour) {
+  uint8_t type;
+  switch (symbol | 0x20) {
+    case 'p': type = PawnType; break;
+    case 'n': type = KnightType; break;
+    case 'b': type = BishopType; break;
+    case 'r': type = RookType; break;
+    case 'q': type = QueenType; break;
+    case 'k': type = KingType; break;
+    default : return 0;
+  }
+  return colour == White ? type : type | PIECE_BLACK;
+}
+
+inline PieceType pieceCodeType(const uint8_t code) { return static_cast<PieceType>(code & PIECE_TYPE_MASK); }
+
+inline Colour pieceCodeColour(const uint8_t code) { return code & PIECE_BLACK ? Black : White; }
+
+/** Gets the lowercase FEN symbol of a piece code, ' ' for an empty square. */
+inline char pieceCodeSymbol(const uint8_t code) { return PIECE_TYPE_SYMBOLS[code & PIECE_TYPE_MASK]; }
+
 /** Forward declaration */
-class PieceFactory;
 class IChessBoardActions;
-class ChessBoard;
 
-/** Parent for all chess pieces */
+/** Parent for all chess pieces.
+ *  A piece object holds the move rules for one type and colour. The objects hold no board state,
+ *  every rule is given the board it looks at, so one shared object of each serves all the boards.
+ */
 class Pieces {
 public:
   /** Constructor for Pieces class.
-   *  Initialises a chess piece with specified colour, board and hasMoved to false.
+   *  Initialises a chess piece with specified colour.
    *  @param _colour: The colour of the piece using the Colour enum(White/Black).
-   *  @param _board: Pointer to the the abstract IChessBoardActions class that contains chess board the piece belongs to.
    */
-  Pieces(Colour _colour, IChessBoardActions * _board) : pieceColour(_colour), hasMoved(false), board(_board) {}
+  explicit Pieces(Colour _colour) : pieceColour(_colour) {}
 
   /** Virtual destructor for proper cleanup of derived classes
    *  Currently unused but included for proper cleanup in case of future extensions.
@@ -31,13 +71,19 @@ public:
    */
   virtual const char* getType() const = 0;
 
+  /** Pure virtual function to get the lowercase FEN symbol of the piece (e.g. 'p', 'n').
+   *  @return FEN character of the piece type.
+   */
+  virtual char getSymbol() const = 0;
+
   /** Pure virtual function overriden by each chess piece to check if the move is valid using piece-specific logic.
    *  Parameter positions are assumed to be 0 <= x < 8, for both row and column.
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the source position (row, column).
    *  @param destinationPos: Array containing the destination position (row, column).
    *  @return True if the move is valid, false otherwise.
    */
-  virtual bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const = 0;
+  virtual bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const = 0;
 
   /** Retrieves the colour of the piece as a string.
    *  @return String representation of the piece's colour.
@@ -49,50 +95,48 @@ public:
    */
   Colour getColour() const { return pieceColour; }
 
-  /** Prints movement statement, calls ChessBoard movePiece() function to carry out the move.
-   *  Updates the 'hasMoved' parameter and calls updateCastlingRights() overriden in the King and Rook.
+  /** Calls ChessBoard movePiece() function to carry out the move, nothing is printed.
+   *  The board marks the piece as moved, then updateCastlingRights() overriden in the King and Rook is called.
+   *  The destination square is expected to be empty, captured pieces are removed by ChessBoard doMove().
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the source position (row, column).
    *  @param destinationPos: Array containing the destination position (row, column).
    */
-  void makeMove(const int sourcePos[2], const int destinationPos[2]);
+  void applyMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const;
 
 protected:
   Colour pieceColour;
-
-  bool hasMoved;
-
-  /** Pointer to a interface chessBoard object included in each Piece.*/
-  IChessBoardActions * board;
   
   /** Virtual function for updating castling rights, overridden by King and Rook only.
    *  If the King is castling, it moves the rook to the appropriate position.
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the source position (row, column).
    *  @param destinationPos: Array containing the destination position (row, column).
    */
-  virtual void updateCastlingRights(const int sourcePos[2], const int destinationPos[2]) {/* By default, do nothing */; }
-
-  /** Updates the 'hasMoved' status of the piece to true*/
-  virtual void updateMoved() { hasMoved = true; }
+  virtual void updateCastlingRights(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const {/* By default, do nothing */; }
   
   /** Checks if the destination square is occupied by a piece of the same colour.
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param destinationPos: Array containing the destination position (row, column).
    *  @return True if the destination has a piece of the same colour, false otherwise.
    */
-  bool destinationSameColour(const int destinationPos[2]) const;
+  bool destinationSameColour(const IChessBoardActions & board, const int destinationPos[2]) const;
 
   /** Checks if the path is clear for a straight-line move (horizontal or vertical).
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the source position (row, column).
    *  @param destinationPos: Array containing the destination position (row, column).
    *  @return True if the path is clear, false otherwise.
    */
-  bool isPathClearStraight(const int sourcePos[2], const int destinationPos[2]) const;
+  bool isPathClearStraight(const IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const;
 
   /** Checks if the path is clear for a diagonal move.
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the source position (row, column).
    *  @param destinationPos: Array containing the destination position (row, column).
    *  @return True if the path is clear, false otherwise.
    */
-  bool isPathClearDiagonal(const int sourcePos[2], const int destinationPos[2]) const;
+  bool isPathClearDiagonal(const IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const;
 
   /** Calculates the change in position (delta x and delta y) for a move.
    *  @param sourcePos: Array containing the source position (row, column).
@@ -105,91 +149,87 @@ protected:
 
 /** Subclass Declarations for Chess Pieces
  *  Each chess piece (Pawn, King, Rook, Bishop, Knight, Queen) inherits from the Pieces class.
- *  Constructor: Initialises a piece with a specified colour and an IChessBoardActions pointer to access specified board methods.
+ *  Constructor: Initialises a piece with a specified colour, the board is passed to each rule instead.
  *  isValidMove(): Contains piece-specific movement logic to determine the validity of a move.
  *  getType(): Returns the string representation of the piece type (e.g., "Pawn", "King").
  *  updateCastlingRights(): Implemented in King and Rook with specific logic for castling rights.
  *  Other pieces inherit the default behaviour (do nothing).
  */
 
-class Pawn : public Pieces {
+/** The pieces whose rules depend on their colour are templates on it, so the pawn direction, the
+ *  home squares and the castling rights are constants and the rules carry no colour branches.
+ *  They are declared final so a call through the exact type is not virtual.
+ */
+template<Colour C>
+class Pawn final : public Pieces {
 public:
-  Pawn(Colour _colour, IChessBoardActions * _board) : Pieces(_colour, _board) {}
+  Pawn() : Pieces(C) {}
   const char* getType() const override { return "Pawn"; };
-  bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const override;
+  char getSymbol() const override { return 'p'; }
+  bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 private:
 };
 
-class King : public Pieces {
+template<Colour C>
+class King final : public Pieces {
 public:
-  King(Colour _colour, IChessBoardActions * _board) : Pieces(_colour, _board) {}
+  King() : Pieces(C) {}
   const char* getType() const override { return "King"; }
-  bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const override;
+  char getSymbol() const override { return 'k'; }
+  bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 private:
   /** Updates castling rights after a king's move.
    *  If castling occurs, this method calls the ChessBoard movePiece() on the appropriate rook.
    *  It updates the board's king position and sets castling availability to false.
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the king's initial position (row, column).
    *  @param destinationPos: Array containing the king's destination position (row, column).
    */
-  void updateCastlingRights(const int sourcePos[2], const int destinationPos[2]) override ;
+  void updateCastlingRights(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 };
 
-class Rook : public Pieces {
+template<Colour C>
+class Rook final : public Pieces {
 public:
-  Rook(Colour _colour, IChessBoardActions * _board) : Pieces(_colour, _board) {}
+  Rook() : Pieces(C) {}
   const char* getType() const override { return "Rook"; };
-  bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const override;
+  char getSymbol() const override { return 'r'; }
+  bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 private:
   /** Updates the corresponding ChessBoard castling array to false based on the rook's initial position.
    *  It uses the ChessBoard global CastleDirection enum. 
+   *  @param board: The abstract IChessBoardActions class of the chess board the piece is on.
    *  @param sourcePos: Array containing the rook's initial position (row, column).
    *  @param destinationPos: Array containing the rook's destination position (row, column).
    *  Note: The function only updates castling rights and does not involve moving the king.
    */
-  void updateCastlingRights(const int sourcePos[2], const int destinationPos[2]) override ;
+  void updateCastlingRights(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 };
 
-class Bishop : public Pieces {
+class Bishop final : public Pieces {
 public:
-  Bishop(Colour _colour, IChessBoardActions * _board) : Pieces(_colour, _board) {}
+  explicit Bishop(Colour _colour) : Pieces(_colour) {}
   const char* getType() const override { return "Bishop"; }
-  bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const override;
+  char getSymbol() const override { return 'b'; }
+  bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 private:
 };
 
-class Knight : public Pieces {
+class Knight final : public Pieces {
 public:
-  Knight(Colour _colour, IChessBoardActions * _board) : Pieces(_colour, _board) {}
+  explicit Knight(Colour _colour) : Pieces(_colour) {}
   const char* getType() const override { return "Knight"; }
-  bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const override;
+  char getSymbol() const override { return 'n'; }
+  bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 };
 
-class Queen : public Pieces {
+class Queen final : public Pieces {
 public:
-  Queen(Colour _colour, IChessBoardActions * _board) : Pieces(_colour, _board) {}
+  explicit Queen(Colour _colour) : Pieces(_colour) {}
   const char* getType() const override { return "Queen"; }
-  bool isValidMove(const int sourcePos[2], const int destinationPos[2]) const override;
+  char getSymbol() const override { return 'q'; }
+  bool isValidMove(IChessBoardActions & board, const int sourcePos[2], const int destinationPos[2]) const override;
 private:
 };
 
-/** PieceFactory Class
- *  Solely responsible for creating chess piece objects.
- *  This factory class ensures the encapsulation of the instantiation logic of chess pieces.
- *  It receives a raw pointer to the ChessBoard, which is acceptable as it only creates pieces 
- *  without modifying the board state or owning the board resource.
- */
-class PieceFactory {
-public:
-  /** Creates and returns a new chess piece object based on input character and colour.
-   *  It is a static method so it can be called without an instance of PieceFactory.
-   *  @param c: Character representing the type of chess piece (e.g., 'p' for pawn).
-   *  @param colour: The enum Colour of the piece to be created (White/Black).
-   *  @param board: Raw pointer to the ChessBoard object on which the piece will be placed.
-   *  @return Pointer to the created chess piece object, or nullptr if an invalid character is provided.
-   *  Note: The function returns a nullptr for non-alphabetic characters or unsupported piece types.
-   */
-  static Pieces* createPiece(char c, Colour colour ,ChessBoard * board);
-};
-
 #endif // PIECES_H
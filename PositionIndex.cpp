@@ -0,0 +1,165 @@
+#include"PositionIndex.h"
+#include<fcntl.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<unistd.h>
+
+namespace {
+  // Slot layout: fingerprint in bits 40-63, distance from home in bits 32-39, count in bits 0-31
+  const int FINGERPRINT_SHIFT = 40;
+  const int DISTANCE_SHIFT = 32;
+  const uint64_t COUNT_MASK = 0xFFFFFFFFULL;
+  const size_t MAX_DISTANCE = 255;
+
+  static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t) && std::atomic<uint64_t>::is_always_lock_free,
+		"slots are mapped straight from memory, so atomics must be plain 64-bit words");
+
+  /** The top 24 bits of the key, never 0 as 0 marks an empty slot. */
+  uint32_t fingerprintOf(const uint64_t key) {
+    uint32_t fingerprint = static_cast<uint32_t>(key >> FINGERPRINT_SHIFT);
+    return fingerprint == 0 ? 1 : fingerprint;
+  }
+
+  uint32_t fingerprintOfSlot(const uint64_t word) { return static_cast<uint32_t>(word >> FINGERPRINT_SHIFT); }
+  size_t distanceOfSlot(const uint64_t word) { return (word >> DISTANCE_SHIFT) & 0xFF; }
+}
+
+PositionIndex::PositionIndex(const size_t capacity, const char* path) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  size_t bytes = size * sizeof(uint64_t);
+
+  void* memory = MAP_FAILED;
+  bool reopened = false;
+  if (path == nullptr) {
+    // Anonymous pages are zero filled and only committed when touched
+    memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  } else {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+      return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+      close(fd);
+      return;
+    }
+    size_t fileBytes = static_cast<size_t>(info.st_size);
+    if (fileBytes != 0) {
+      // An existing table keeps its own capacity, its entries only hold the key bits it needs.
+      // A file that cannot be a table is left alone and the index stays closed.
+      size_t fileSlots = fileBytes / sizeof(uint64_t);
+      if (fileBytes % sizeof(uint64_t) != 0 || (fileSlots & (fileSlots - 1)) != 0) {
+	close(fd);
+	return;
+      }
+      size = fileSlots;
+      bytes = fileBytes;
+      reopened = true;
+    }
+    if (reopened || ftruncate(fd, bytes) == 0) {
+      memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    fileBacked = true;
+  }
+  if (memory == MAP_FAILED) {
+    return;
+  }
+  slots = static_cast<std::atomic<uint64_t>*>(memory);
+  mask = size - 1;
+
+  if (reopened) {
+    size_t used = 0;
+    for (size_t i = 0; i < size; i++) {
+      used += slots[i].load(std::memory_order_relaxed) != 0;
+    }
+    distinct.store(used);
+  }
+}
+
+PositionIndex::~PositionIndex() {
+  if (slots != nullptr) {
+    munmap(slots, memoryBytes());
+  }
+}
+
+uint32_t PositionIndex::insertAt(const size_t home, const uint32_t fingerprint, const uint32_t count) {
+  for (size_t distance = 0; distance <= MAX_DISTANCE; distance++) {
+    std::atomic<uint64_t> & slot = slots[(home + distance) & mask];
+    uint64_t word = slot.load(std::memory_order_relaxed);
+    while (true) {
+      if (word == 0) {
+	// Claim the empty slot, on failure word holds the winner and is looked at again
+	uint64_t claimed = static_cast<uint64_t>(fingerprint) << FINGERPRINT_SHIFT |
+	  static_cast<uint64_t>(distance) << DISTANCE_SHIFT | count;
+	if (slot.compare_exchange_weak(word, claimed, std::memory_order_relaxed)) {
+	  distinct.fetch_add(1, std::memory_order_relaxed);
+	  return count;
+	}
+	continue;
+      }
+      if (fingerprintOfSlot(word) != fingerprint || distanceOfSlot(word) != distance) {
+	break;
+      }
+      uint64_t total = (word & COUNT_MASK) + count;
+      uint32_t newCount = total > COUNT_MASK ? static_cast<uint32_t>(COUNT_MASK) : static_cast<uint32_t>(total);
+      if (slot.compare_exchange_weak(word, (word & ~COUNT_MASK) | newCount, std::memory_order_relaxed)) {
+	return newCount;
+      }
+    }
+  }
+  return 0;
+}
+
+uint32_t PositionIndex::insert(const uint64_t key, const uint32_t count) {
+  if (slots == nullptr || count == 0) {
+    return 0;
+  }
+  return insertAt(key & mask, fingerprintOf(key), count);
+}
+
+uint32_t PositionIndex::lookup(const uint64_t key) const {
+  if (slots == nullptr) {
+    return 0;
+  }
+  size_t home = key & mask;
+  uint32_t fingerprint = fingerprintOf(key);
+  for (size_t distance = 0; distance <= MAX_DISTANCE; distance++) {
+    uint64_t word = slots[(home + distance) & mask].load(std::memory_order_relaxed);
+    // Nothing is ever removed, so an empty slot ends the probe
+    if (word == 0) {
+      return 0;
+    }
+    if (fingerprintOfSlot(word) == fingerprint && distanceOfSlot(word) == distance) {
+      return static_cast<uint32_t>(word & COUNT_MASK);
+    }
+  }
+  return 0;
+}
+
+bool PositionIndex::merge(const PositionIndex & other) {
+  if (slots == nullptr || other.slots == nullptr || other.capacity() != capacity()) {
+    return false;
+  }
+  for (size_t i = 0; i <= mask; i++) {
+    uint64_t word = other.slots[i].load(std::memory_order_relaxed);
+    if (word == 0) {
+      continue;
+    }
+    // The home slot is the low bits of the original key
+    size_t home = (i - distanceOfSlot(word)) & mask;
+    if (insertAt(home, fingerprintOfSlot(word), static_cast<uint32_t>(word & COUNT_MASK)) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void PositionIndex::sync() {
+  if (slots != nullptr && fileBacked) {
+    msync(slots, memoryBytes(), MS_SYNC);
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef POSITIONINDEX_H
+#define POSITIONINDEX_H
+
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+
+/** Counts how often each position has been seen, keyed by Zobrist hash.
+ *  An open addressing table with linear probing and one 64-bit word per position:
+ *  a 24-bit fingerprint from the top of the key, the 8-bit distance from the home slot
+ *  and a 32-bit saturating count. The home slot holds the low bits of the key, so a
+ *  position is identified by its home slot and fingerprint, 24 + log2(capacity) bits of key.
+ *  Inserts from several threads are lock-free (compare and swap on the word), and the
+ *  table can live in a memory-mapped file, larger than RAM, and be reopened later.
+ *
+ *  The capacity is fixed when the table is created and the table never grows: an entry keeps
+ *  only the key bits its home slot and fingerprint need, so it cannot be moved to a larger
+ *  table. Size the table for the whole corpus; once a position would be more than 255 slots
+ *  from its home, insert() returns 0 and the position is not counted.
+ */
+class PositionIndex {
+public:
+  /** Creates an index in memory, or backed by a file.
+   *  @param capacity: Number of slots, rounded up to a power of two. Keep the load below ~0.8.
+   *  @param path: File to map the table to, or nullptr for anonymous memory. An existing file
+   *  is reopened with its counts and keeps its own capacity, whatever capacity asks for; a file
+   *  whose size is not that of a table is left untouched and the index is not opened.
+   */
+  explicit PositionIndex(const size_t capacity, const char* path = nullptr);
+  ~PositionIndex();
+
+  PositionIndex(const PositionIndex &) = delete;
+  PositionIndex & operator=(const PositionIndex &) = delete;
+
+  /** Checks if the table memory or file could be mapped. */
+  bool isOpen() const { return slots != nullptr; }
+
+  /** Adds occurrences of a position, safe to call from several threads at once.
+   *  @param key: The Zobrist key of the position.
+   *  @param count: Number of occurrences to add.
+   *  @return The new count of the position, or 0 if the table is too full to add it.
+   */
+  uint32_t insert(const uint64_t key, const uint32_t count = 1);
+
+  /** Gets the number of times a position was inserted, 0 if it was never seen. */
+  uint32_t lookup(const uint64_t key) const;
+
+  /** Adds every position of another index of the same capacity, e.g. a shard built on
+   *  another thread or machine. Safe to run while other threads insert.
+   *  @return False if the capacities differ or this index became full.
+   */
+  bool merge(const PositionIndex & other);
+
+  /** Writes a file-backed table to disk. */
+  void sync();
+
+  /** Number of distinct positions. */
+  size_t size() const { return distinct.load(std::memory_order_relaxed); }
+  size_t capacity() const { return mask + 1; }
+  size_t memoryBytes() const { return capacity() * sizeof(uint64_t); }
+
+private:
+  std::atomic<uint64_t>* slots = nullptr;
+  size_t mask = 0;
+  bool fileBacked = false;
+  std::atomic<size_t> distinct{0};
+
+  /** Inserts by home slot and fingerprint, shared by insert() and merge(). */
+  uint32_t insertAt(const size_t home, const uint32_t fingerprint, const uint32_t count);
+};
+
+#endif // POSITIONINDEX_H
@@ -0,0 +1,598 @@
+#include"Search.h"
+#include"ChessBoard.h"
+#include"Evaluation.h"
+#include<cmath>
+#include<utility>
+
+namespace {
+  /** Nodes between two looks at the clock, a power of two. A few microseconds of search at most. */
+  const uint64_t DEADLINE_POLL_NODES = 64;
+
+  /** Null-move pruning is tried with this much depth left, and the null move is searched this
+   *  much shallower, more at larger depths.
+   */
+  const int NULL_MOVE_MIN_DEPTH = 3;
+  int nullMoveReduction(const int depth) { return 2 + depth / 6; }
+
+  /** Futility and reverse futility pruning apply with at most this much depth left, with a margin
+   *  in centipawns per ply of it.
+   */
+  const int FUTILITY_MAX_DEPTH = 3;
+  const int FUTILITY_MARGIN = 125;
+  const int REVERSE_FUTILITY_MARGIN = 90;
+
+  /** Late move reductions start with this much depth left, after this many moves. */
+  const int REDUCTION_MIN_DEPTH = 3;
+  const int REDUCTION_MIN_MOVES = 3;
+
+  /** Plies a late quiet move is reduced by, growing with the log of the depth and of the number of
+   *  moves searched before it.
+   */
+  int lateMoveReduction(const int depth, const int moveNumber) {
+    static const std::vector<int> table = []() {
+      std::vector<int> reductions((MAX_PLY + 1) * MAX_MOVES);
+      for (int d = 1; d <= MAX_PLY; d++) {
+	for (int m = 1; m < MAX_MOVES; m++) {
+	  reductions[d * MAX_MOVES + m] = static_cast<int>(0.5 + std::log(d) * std::log(m) / 2.0);
+	}
+      }
+      return reductions;
+    }();
+    return table[(depth < MAX_PLY ? depth : MAX_PLY) * MAX_MOVES + (moveNumber < MAX_MOVES ? moveNumber : MAX_MOVES - 1)];
+  }
+
+  /** Checks if a score is a mate score, which pruning margins must not be added to. */
+  bool isMateScore(const int score) { return score > MATE_SCORE - MAX_PLY || score < -MATE_SCORE + MAX_PLY; }
+
+  /** Mate scores are stored in the table relative to the node, not the root. */
+  int scoreToTT(const int score, const int ply) {
+    if (score > MATE_SCORE - MAX_PLY) return score + ply;
+    if (score < -MATE_SCORE + MAX_PLY) return score - ply;
+    return score;
+  }
+
+  int scoreFromTT(const int score, const int ply) {
+    if (score > MATE_SCORE - MAX_PLY) return score - ply;
+    if (score < -MATE_SCORE + MAX_PLY) return score + ply;
+    return score;
+  }
+}
+
+double SearchStats::firstMoveCutoffRate() const {
+  return betaCutoffs == 0 ? 0.0 : static_cast<double>(firstMoveCutoffs) / betaCutoffs;
+}
+
+double SearchStats::effectiveBranchingFactor() const {
+  if (completedDepth < 2 || iterationNodes[completedDepth - 1] == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(iterationNodes[completedDepth]) / iterationNodes[completedDepth - 1];
+}
+
+double SearchStats::ttHitRate() const {
+  return ttProbes == 0 ? 0.0 : static_cast<double>(ttHits) / ttProbes;
+}
+
+double SearchStats::pawnHitRate() const {
+  return pawnProbes == 0 ? 0.0 : static_cast<double>(pawnHits) / pawnProbes;
+}
+
+void SearchStats::writeJson(FILE* out) const {
+  int64_t micros = 0;
+  for (int depth = 1; depth <= completedDepth; depth++) {
+    micros += iterationMicros[depth];
+  }
+  fprintf(out, "{\"nodes\":%llu,\"quiescenceNodes\":%llu,\"seePruned\":%llu,\"betaCutoffs\":%llu,"
+	  "\"firstMoveCutoffs\":%llu,\"firstMoveCutoffRate\":%.4f,\"ttProbes\":%llu,\"ttHits\":%llu,"
+	  "\"ttHitRate\":%.4f,\"ttCutoffs\":%llu,\"nullMoveTries\":%llu,\"nullMoveCutoffs\":%llu,"
+	  "\"reducedMoves\":%llu,\"reductionResearches\":%llu,\"futilityPruned\":%llu,"
+	  "\"reverseFutilityCutoffs\":%llu,\"pawnProbes\":%llu,\"pawnHits\":%llu,\"pawnHitRate\":%.4f,"
+	  "\"depth\":%d,\"selectiveDepth\":%d,"
+	  "\"branchingFactor\":%.3f,\"micros\":%lld,\"iterations\":[",
+	  static_cast<unsigned long long>(nodes), static_cast<unsigned long long>(quiescenceNodes),
+	  static_cast<unsigned long long>(seePruned), static_cast<unsigned long long>(betaCutoffs),
+	  static_cast<unsigned long long>(firstMoveCutoffs), firstMoveCutoffRate(),
+	  static_cast<unsigned long long>(ttProbes), static_cast<unsigned long long>(ttHits), ttHitRate(),
+	  static_cast<unsigned long long>(ttCutoffs), static_cast<unsigned long long>(nullMoveTries),
+	  static_cast<unsigned long long>(nullMoveCutoffs), static_cast<unsigned long long>(reducedMoves),
+	  static_cast<unsigned long long>(reductionResearches), static_cast<unsigned long long>(futilityPruned),
+	  static_cast<unsigned long long>(reverseFutilityCutoffs), static_cast<unsigned long long>(pawnProbes),
+	  static_cast<unsigned long long>(pawnHits), pawnHitRate(), completedDepth, selectiveDepth,
+	  effectiveBranchingFactor(), static_cast<long long>(micros));
+  for (int depth = 1; depth <= completedDepth; depth++) {
+    fprintf(out, "%s{\"depth\":%d,\"nodes\":%llu,\"quiescenceNodes\":%llu,\"micros\":%lld}",
+	    depth > 1 ? "," : "", depth, static_cast<unsigned long long>(iterationNodes[depth]),
+	    static_cast<unsigned long long>(iterationQuiescenceNodes[depth]),
+	    static_cast<long long>(iterationMicros[depth]));
+  }
+  fputs("]}", out);
+}
+
+SearchTrace::SearchTrace(const size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  events.resize(size);
+  mask = size - 1;
+}
+
+void SearchTrace::writeJson(FILE* out) const {
+  uint64_t kept = recorded < events.size() ? recorded : events.size();
+  fprintf(out, "{\"recorded\":%llu,\"events\":[", static_cast<unsigned long long>(recorded));
+  for (uint64_t i = recorded - kept; i < recorded; i++) {
+    const TraceEvent & event = events[i & mask];
+    char move[6];
+    event.move.toString(move);
+    fprintf(out, "%s{\"ply\":%d,\"move\":\"%s\",\"alpha\":%d,\"beta\":%d,\"score\":%d}",
+	    i > recorded - kept ? "," : "", event.ply, move, event.alpha, event.beta, event.score);
+  }
+  fputs("]}", out);
+}
+
+Search::Search(ChessBoard & _board, const size_t ttMegabytes, const MemoryOptions & memory)
+  : board(_board), tt(ttMegabytes, memory) {}
+
+void Search::clear() {
+  tt.clear();
+  pawnTable.clear();
+  ordering.clear();
+}
+
+SearchResult Search::searchDepth(const int maxDepth) {
+  SearchLimits limits;
+  limits.depth = maxDepth;
+  return search(limits);
+}
+
+void Search::setDeadline(const SearchClock::time_point deadline) {
+  deadlineTicks.store(deadline.time_since_epoch().count(), std::memory_order_relaxed);
+}
+
+bool Search::shouldStop() {
+  if (stopped) {
+    return true;
+  }
+  bool pollClock = (stats.nodes & (DEADLINE_POLL_NODES - 1)) == 0;
+  if (yieldNodes != 0 && stats.nodes >= nextYieldNode) {
+    nextYieldNode = stats.nodes + yieldNodes;
+    onYield();
+    // Other searches may have run for a while
+    pollClock = true;
+  }
+  if (stopRequested.load(std::memory_order_relaxed) || (maxNodes != 0 && stats.nodes >= maxNodes)) {
+    stopped = true;
+  } else if (pollClock) {
+    int64_t deadline = deadlineTicks.load(std::memory_order_relaxed);
+    if (deadline != 0 && SearchClock::now().time_since_epoch().count() >= deadline) {
+      stopped = true;
+    }
+  }
+  return stopped;
+}
+
+void Search::setYieldCallback(const std::function<void()> & callback, const uint64_t everyNodes) {
+  onYield = callback;
+  yieldNodes = callback ? everyNodes : 0;
+  nextYieldNode = stats.nodes + yieldNodes;
+}
+
+bool Search::isExcludedRootMove(const Move & move) const {
+  for (int i = 0; i < excludedCount; i++) {
+    if (excludedRootMoves[i] == move) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Search::writeJson(FILE* out) const {
+  fputs("{\"stats\":", out);
+  stats.writeJson(out);
+  fputs(",\"trace\":", out);
+  if (trace != nullptr) {
+    trace->writeJson(out);
+  } else {
+    fputs("null", out);
+  }
+  fputs("}\n", out);
+}
+
+SearchResult Search::search(const SearchLimits & limits) {
+  stats = SearchStats();
+  nextYieldNode = yieldNodes;
+  uint64_t pawnProbesBefore = pawnTable.getProbes(), pawnHitsBefore = pawnTable.getHits();
+  if (trace != nullptr) {
+    trace->clear();
+  }
+  ordering.clear();
+  stopped = false;
+  maxNodes = limits.nodes;
+  bool clocked = limits.clock.remainingMs >= 0;
+  if (clocked) {
+    timeManager.start(limits.clock, SearchClock::now());
+    setDeadline(timeManager.getHardDeadline());
+  } else if (limits.moveTimeMs > 0) {
+    setDeadline(SearchClock::now() + std::chrono::milliseconds(limits.moveTimeMs));
+  }
+
+  // There cannot be more lines than legal moves
+  int lineCount = limits.multiPV < 1 ? 1 : (limits.multiPV > MAX_MULTI_PV ? MAX_MULTI_PV : limits.multiPV);
+  if (lineCount > 1) {
+    MoveList moves;
+    board.generateLegalMoves(moves);
+    if (lineCount > moves.size()) {
+      lineCount = moves.size() > 0 ? moves.size() : 1;
+    }
+  }
+
+  SearchResult result;
+  SearchLine lines[MAX_MULTI_PV];
+  for (int depth = 1; depth <= limits.depth && depth <= MAX_PLY; depth++) {
+    uint64_t nodesBefore = stats.nodes;
+    uint64_t quiescenceNodesBefore = stats.quiescenceNodes;
+    SearchClock::time_point iterationStart = SearchClock::now();
+    int score = 0;
+    Move bestMove;
+
+    // Each further line searches the root again without the best moves already found. The table
+    // keeps the work of the earlier searches, so the later ones are much cheaper than the first.
+    excludedCount = 0;
+    for (int line = 0; line < lineCount && !stopped; line++) {
+      rootBestMove = Move();
+      int lineScore = alphaBeta(depth, 0, -INFINITE_SCORE, INFINITE_SCORE);
+      if (stopped) {
+	break;
+      }
+      if (line == 0) {
+	score = lineScore;
+	bestMove = rootBestMove;
+      }
+      lines[line].score = lineScore;
+      lines[line].pvLength = pvLength[0];
+      for (int i = 0; i < pvLength[0]; i++) {
+	lines[line].pv[i] = pvTable[0][i];
+      }
+      excludedRootMoves[excludedCount++] = rootBestMove;
+    }
+    excludedCount = 0;
+    // Once the first line is complete its move is the best, even if a later line was interrupted
+    if (!bestMove.isNull()) {
+      rootBestMove = bestMove;
+    }
+
+    // An interrupted iteration is only trusted for its best move if nothing was completed
+    if (stopped) {
+      if (result.bestMove.isNull()) {
+	if (rootBestMove.isNull()) {
+	  // Stopped before any move was scored, any legal move is better than none
+	  MoveList moves;
+	  board.generateLegalMoves(moves);
+	  if (!moves.empty()) {
+	    rootBestMove = moves[0];
+	  }
+	}
+	result.bestMove = rootBestMove;
+	result.pv[0] = rootBestMove;
+	result.pvLength = rootBestMove.isNull() ? 0 : 1;
+	result.lines[0].pv[0] = rootBestMove;
+	result.lines[0].pvLength = result.pvLength;
+	result.lineCount = result.pvLength;
+      }
+      break;
+    }
+
+    stats.iterationNodes[depth] = stats.nodes - nodesBefore;
+    stats.iterationQuiescenceNodes[depth] = stats.quiescenceNodes - quiescenceNodesBefore;
+    stats.iterationMicros[depth] =
+      std::chrono::duration_cast<std::chrono::microseconds>(SearchClock::now() - iterationStart).count();
+    stats.completedDepth = depth;
+    result.bestMove = rootBestMove;
+    result.score = score;
+    result.depth = depth;
+    result.pvLength = lines[0].pvLength;
+    for (int i = 0; i < lines[0].pvLength; i++) {
+      result.pv[i] = lines[0].pv[i];
+    }
+    // A later line can come out higher when the table makes the search see further, keep them sorted
+    result.lineCount = lineCount;
+    for (int line = 0; line < lineCount; line++) {
+      result.lines[line] = lines[line];
+      for (int k = line; k > 0 && result.lines[k].score > result.lines[k - 1].score; k--) {
+	std::swap(result.lines[k], result.lines[k - 1]);
+      }
+    }
+    if (onIteration) {
+      onIteration(result);
+    }
+
+    // No need to search deeper once there is nothing to move or a mate is found, unless other lines are wanted
+    if (rootBestMove.isNull() ||
+	(lineCount == 1 && (score > MATE_SCORE - MAX_PLY || score < -MATE_SCORE + MAX_PLY))) {
+      break;
+    }
+    // Under a clock, only start another iteration if it is likely to be worth its time
+    if (clocked && !timeManager.shouldStartIteration(rootBestMove, score)) {
+      break;
+    }
+  }
+  deadlineTicks.store(0, std::memory_order_relaxed);
+  stats.pawnProbes = pawnTable.getProbes() - pawnProbesBefore;
+  stats.pawnHits = pawnTable.getHits() - pawnHitsBefore;
+  if (reportFile != nullptr) {
+    writeJson(reportFile);
+  }
+  return result;
+}
+
+int Search::evaluatePosition() {
+  if (useNetwork) {
+    return board.evaluateNetwork();
+  }
+  return evaluate(board, options.pawnHash ? &pawnTable : nullptr);
+}
+
+int Search::alphaBeta(int depth, const int ply, int alpha, int beta, const bool allowNullMove) {
+  // A leaf handed to the quiescence search is counted there
+  if ((depth > 0 && ply < MAX_PLY) || !options.quiescence) {
+    stats.nodes++;
+  }
+  pvLength[ply] = 0;
+  if (ply > stats.selectiveDepth) {
+    stats.selectiveDepth = ply;
+  }
+
+  if (shouldStop()) {
+    return 0;
+  }
+
+  // A repeated position is scored as a draw straight away, a second repetition cannot be better
+  if (ply > 0 && (board.getHalfmoveClock() >= 100 || board.getRepetitionCount() > 0)) {
+    return 0;
+  }
+
+  if (depth <= 0 || ply >= MAX_PLY) {
+    return options.quiescence ? quiescence(ply, alpha, beta) : evaluatePosition();
+  }
+
+  // Probe the transposition table for a cutoff and the hash move
+  uint64_t key = board.getHashKey();
+  Move hashMove;
+  const TTEntry * entry = tt.probe(key);
+  stats.ttProbes++;
+  if (entry != nullptr) {
+    stats.ttHits++;
+    hashMove = entry->bestMove;
+    if (ply > 0 && entry->depth >= depth) {
+      int ttScore = scoreFromTT(entry->score, ply);
+      if (entry->bound == BoundExact ||
+	  (entry->bound == BoundLower && ttScore >= beta) ||
+	  (entry->bound == BoundUpper && ttScore <= alpha)) {
+	stats.ttCutoffs++;
+	return ttScore;
+      }
+    }
+  }
+
+  Colour side = board.getSideToMove();
+
+  // The selective parts need the static evaluation, and do nothing in check or at the root
+  bool selective = ply > 0 && (options.nullMove || options.lateMoveReductions || options.futility || options.reverseFutility);
+  bool inCheck = selective && board.isSideToMoveInCheck();
+  int staticEval = selective && !inCheck ? evaluatePosition() : 0;
+  bool canPrune = selective && !inCheck;
+
+  // So far above beta that no move will bring the score back down in the plies left
+  if (options.reverseFutility && canPrune && depth <= FUTILITY_MAX_DEPTH && !isMateScore(beta) &&
+      staticEval - REVERSE_FUTILITY_MARGIN * depth >= beta) {
+    stats.reverseFutilityCutoffs++;
+    return staticEval - REVERSE_FUTILITY_MARGIN * depth;
+  }
+
+  // If passing still fails high the position is good enough. Only pawns left is where passing
+  // would be better than any move, and two null moves in a row would search nothing.
+  if (options.nullMove && canPrune && allowNullMove && depth >= NULL_MOVE_MIN_DEPTH && staticEval >= beta &&
+      !isMateScore(beta) && board.hasNonPawnMaterial(side)) {
+    stats.nullMoveTries++;
+    MoveUndo undo;
+    board.doNullMove(undo);
+    int score = -alphaBeta(depth - 1 - nullMoveReduction(depth), ply + 1, -beta, -beta + 1, false);
+    board.undoNullMove(undo);
+    if (stopped) {
+      return 0;
+    }
+    if (score >= beta) {
+      stats.nullMoveCutoffs++;
+      // A mate found after passing is not a real one
+      return isMateScore(score) ? beta : score;
+    }
+  }
+
+  // So far below alpha that a quiet move cannot raise the score to it in the plies left
+  bool futile = options.futility && canPrune && depth <= FUTILITY_MAX_DEPTH && !isMateScore(alpha) &&
+    staticEval + FUTILITY_MARGIN * depth <= alpha;
+
+  int originalAlpha = alpha;
+  int bestScore = -INFINITE_SCORE;
+  Move bestMove;
+
+  // Moves come in stages, so a cutoff on an early move skips generating the quiet moves
+  MovePicker picker(board, ordering, hashMove, ply);
+  int searched = 0;
+  for (Move move = picker.next(); !move.isNull(); move = picker.next()) {
+    if (ply == 0 && isExcludedRootMove(move)) {
+      continue;
+    }
+    bool isTactical = board.isCapture(move) || move.isPromotion();
+    bool isLate = options.lateMoveReductions && depth >= REDUCTION_MIN_DEPTH && searched >= REDUCTION_MIN_MOVES;
+
+    MoveUndo undo;
+    board.doMove(move, undo);
+    // The child probes the table first thing, start fetching its slot now
+    if (options.prefetch) {
+      tt.prefetch(board.getHashKey());
+    }
+    // Checks are neither pruned nor reduced
+    bool prunable = !isTactical && (futile || (isLate && canPrune)) && !board.lastMoveGivesCheck(move);
+    if (futile && prunable && searched > 0) {
+      board.undoMove(move, undo);
+      stats.futilityPruned++;
+      continue;
+    }
+    int reduction = 0;
+    if (isLate && canPrune && prunable) {
+      reduction = lateMoveReduction(depth, searched);
+      // Moves that have cut off elsewhere in the tree are reduced less
+      if (ordering.scoreQuiet(side, move) > 0) {
+	reduction--;
+      }
+      // Leave at least one ply
+      reduction = reduction < depth - 2 ? reduction : depth - 2;
+    }
+    bool isFirst = searched++ == 0;
+
+    int score;
+    if (reduction > 0) {
+      // A null window is enough to show the move is no better than alpha
+      stats.reducedMoves++;
+      score = -alphaBeta(depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+      if (score > alpha && !stopped) {
+	stats.reductionResearches++;
+	score = -alphaBeta(depth - 1, ply + 1, -beta, -alpha);
+      }
+    } else {
+      score = -alphaBeta(depth - 1, ply + 1, -beta, -alpha);
+    }
+    board.undoMove(move, undo);
+
+    // The score of an interrupted subtree is meaningless
+    if (stopped) {
+      return 0;
+    }
+    if (trace != nullptr) {
+      trace->record(ply, move, alpha, beta, score);
+    }
+
+    if (score > bestScore) {
+      bestScore = score;
+      bestMove = move;
+      if (ply == 0) {
+	rootBestMove = move;
+      }
+    }
+    if (score > alpha) {
+      alpha = score;
+      // Extend the principal variation with the child's line
+      pvTable[ply][0] = move;
+      int length = 1;
+      for (int k = 0; k < pvLength[ply + 1] && length < MAX_PLY; k++) {
+	pvTable[ply][length++] = pvTable[ply + 1][k];
+      }
+      pvLength[ply] = length;
+    }
+    if (alpha >= beta) {
+      stats.betaCutoffs++;
+      if (isFirst) {
+	stats.firstMoveCutoffs++;
+      }
+      if (!isTactical) {
+	ordering.updateQuietCutoff(side, move, depth, ply);
+      }
+      break;
+    }
+  }
+
+  // Checkmate or stalemate
+  if (searched == 0) {
+    return board.isSideToMoveInCheck() ? -MATE_SCORE + ply : 0;
+  }
+
+  // A root search without some moves does not give the position's real score
+  if (ply > 0 || excludedCount == 0) {
+    Bound bound = bestScore >= beta ? BoundLower : (bestScore > originalAlpha ? BoundExact : BoundUpper);
+    tt.store(key, bestMove, scoreToTT(bestScore, ply), depth, bound);
+  }
+  return bestScore;
+}
+
+int Search::quiescence(const int ply, int alpha, int beta) {
+  stats.nodes++;
+  stats.quiescenceNodes++;
+  pvLength[ply] = 0;
+  if (ply > stats.selectiveDepth) {
+    stats.selectiveDepth = ply;
+  }
+
+  if (shouldStop()) {
+    return 0;
+  }
+  if (ply >= MAX_PLY) {
+    return evaluatePosition();
+  }
+
+  // Not capturing is an option, unless in check where every evasion has to be tried
+  bool inCheck = board.isSideToMoveInCheck();
+  int bestScore = -INFINITE_SCORE;
+  if (!inCheck) {
+    bestScore = evaluatePosition();
+    if (bestScore >= beta) {
+      return bestScore;
+    }
+    if (bestScore > alpha) {
+      alpha = bestScore;
+    }
+  }
+
+  MoveList moves;
+  int scores[MAX_MOVES];
+  if (inCheck) {
+    board.generateLegalMoves(moves);
+  } else {
+    board.generateNoisyMoves(moves);
+  }
+  for (int i = 0; i < moves.size(); i++) {
+    bool noisy = board.isCapture(moves[i]) || moves[i].isPromotion();
+    // Captures by MVV-LVA before the quiet evasions
+    scores[i] = noisy ? INFINITE_SCORE + ordering.scoreNoisy(board, moves[i]) : 0;
+  }
+
+  for (int i = 0; i < moves.size(); i++) {
+    MoveOrdering::pickNext(moves, scores, i);
+    const Move & move = moves[i];
+    // A capture that loses material is not made, a later capture can still win it back
+    if (!inCheck && options.seePruning && !move.isPromotion() && board.staticExchange(move) < 0) {
+      stats.seePruned++;
+      continue;
+    }
+
+    MoveUndo undo;
+    board.doMove(move, undo);
+    int score = -quiescence(ply + 1, -beta, -alpha);
+    board.undoMove(move, undo);
+    if (stopped) {
+      return 0;
+    }
+
+    if (score > bestScore) {
+      bestScore = score;
+    }
+    if (score > alpha) {
+      alpha = score;
+      pvTable[ply][0] = move;
+      int length = 1;
+      for (int k = 0; k < pvLength[ply + 1] && length < MAX_PLY; k++) {
+	pvTable[ply][length++] = pvTable[ply + 1][k];
+      }
+      pvLength[ply] = length;
+    }
+    if (alpha >= beta) {
+      break;
+    }
+  }
+
+  // Checkmate, a stalemate is not looked for outside the main search
+  if (inCheck && moves.empty()) {
+    return -MATE_SCORE + ply;
+  }
+  return bestScore;
+}
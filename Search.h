@@ -0,0 +1,346 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include"Evaluation.h"
+#include"Move.h"
+#include"MoveOrdering.h"
+#include"TranspositionTable.h"
+#include"TimeManager.h"
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<cstdio>
+#include<functional>
+#include<vector>
+
+class ChessBoard;
+
+/** Score of a checkmate at the root, mates further away score closer to zero. */
+const int MATE_SCORE = 30000;
+/** Bound on all scores, larger than any mate score. */
+const int INFINITE_SCORE = 32000;
+
+/** Counters collected during a search. */
+struct SearchStats {
+  /** Nodes of the main search and the quiescence search. */
+  uint64_t nodes = 0;
+  /** Nodes of the quiescence search alone. */
+  uint64_t quiescenceNodes = 0;
+  /** Captures the quiescence search skipped because the static exchange evaluation loses material. */
+  uint64_t seePruned = 0;
+  /** Nodes where a move failed high. */
+  uint64_t betaCutoffs = 0;
+  /** Beta cutoffs caused by the first move searched. */
+  uint64_t firstMoveCutoffs = 0;
+  /** Transposition table lookups of the main search, and those that found the position. */
+  uint64_t ttProbes = 0;
+  uint64_t ttHits = 0;
+  /** Table hits whose score ended the node without a search. */
+  uint64_t ttCutoffs = 0;
+  /** Null-move searches, and those that cut the node off. */
+  uint64_t nullMoveTries = 0;
+  uint64_t nullMoveCutoffs = 0;
+  /** Moves searched to a reduced depth, and those searched again to full depth. */
+  uint64_t reducedMoves = 0;
+  uint64_t reductionResearches = 0;
+  /** Quiet moves skipped by futility pruning, and nodes cut off by reverse futility pruning. */
+  uint64_t futilityPruned = 0;
+  uint64_t reverseFutilityCutoffs = 0;
+  /** Pawn structure lookups of the handcrafted evaluation, and those found in the pawn hash table. */
+  uint64_t pawnProbes = 0;
+  uint64_t pawnHits = 0;
+  /** Total nodes searched by each iteration of iterative deepening. */
+  uint64_t iterationNodes[MAX_PLY + 1] = {0};
+  /** Quiescence nodes of each iteration, part of iterationNodes. */
+  uint64_t iterationQuiescenceNodes[MAX_PLY + 1] = {0};
+  /** Wall time of each iteration in microseconds. */
+  int64_t iterationMicros[MAX_PLY + 1] = {0};
+  int completedDepth = 0;
+  /** Deepest ply reached, quiescence search included. */
+  int selectiveDepth = 0;
+
+  /** Fraction of beta cutoffs that came from the first move, 1.0 is perfect ordering. */
+  double firstMoveCutoffRate() const;
+
+  /** Ratio of the nodes of the last iteration to the nodes of the one before. */
+  double effectiveBranchingFactor() const;
+
+  /** Fraction of table lookups that found the position. */
+  double ttHitRate() const;
+
+  /** Fraction of pawn structure lookups found in the pawn hash table. */
+  double pawnHitRate() const;
+
+  /** Writes the counters and the per iteration figures as a JSON object, without a newline. */
+  void writeJson(FILE* out) const;
+};
+
+/** A node of the main search returning: the move searched from it, the window it was searched
+ *  with and the score it got, from the point of view of the side that made the move.
+ */
+struct TraceEvent {
+  Move move;
+  int16_t ply;
+  int16_t alpha;
+  int16_t beta;
+  int16_t score;
+};
+
+/** Ring buffer of the last search events, to see where a search spent its effort.
+ *  Recording is a store and an increment, the oldest events are overwritten.
+ */
+class SearchTrace {
+public:
+  /** @param capacity: Events kept, rounded up to a power of two. */
+  explicit SearchTrace(const size_t capacity = 4096);
+
+  void record(const int ply, const Move & move, const int alpha, const int beta, const int score) {
+    TraceEvent & event = events[recorded++ & mask];
+    event.move = move;
+    event.ply = static_cast<int16_t>(ply);
+    event.alpha = static_cast<int16_t>(alpha);
+    event.beta = static_cast<int16_t>(beta);
+    event.score = static_cast<int16_t>(score);
+  }
+
+  void clear() { recorded = 0; }
+
+  /** Gets the number of events recorded since the last clear(), more than are kept if it wrapped. */
+  uint64_t getRecorded() const { return recorded; }
+
+  /** Writes the kept events, oldest first, as a JSON array of objects, without a newline. */
+  void writeJson(FILE* out) const;
+
+private:
+  std::vector<TraceEvent> events;
+  size_t mask;
+  uint64_t recorded = 0;
+};
+
+/** Which parts of the search are used, so each one can be measured on its own. */
+struct SearchOptions {
+  /** Search captures past the last ply, so no leaf is scored in the middle of an exchange. */
+  bool quiescence = true;
+  /** Skip quiescence captures that lose material by static exchange evaluation. */
+  bool seePruning = true;
+  /** Look the pawn structure up in the pawn hash table instead of computing it at every node. */
+  bool pawnHash = true;
+  /** Prefetch the transposition table slot of each position as soon as its move is made. */
+  bool prefetch = true;
+  /** Let the opponent move twice, and cut the node off if a reduced search still fails high.
+   *  Not tried in check, twice in a row, or by a side with only pawns, where zugzwang is common.
+   */
+  bool nullMove = true;
+  /** Search late quiet moves to a reduced depth, the later and the poorer their history the
+   *  more, and again to full depth only if they beat alpha.
+   */
+  bool lateMoveReductions = true;
+  /** Skip quiet moves near the leaves when the static evaluation is too far below alpha. */
+  bool futility = true;
+  /** Cut a node off near the leaves when the static evaluation is far enough above beta. */
+  bool reverseFutility = true;
+};
+
+/** Most principal variations a MultiPV search reports. */
+const int MAX_MULTI_PV = 16;
+
+/** One principal variation of a MultiPV search. */
+struct SearchLine {
+  int score = 0;
+  Move pv[MAX_PLY];
+  int pvLength = 0;
+};
+
+/** Result of a search, the best move is null when there are no legal moves. */
+struct SearchResult {
+  Move bestMove;
+  int score = 0;
+  int depth = 0;
+  /** Principal variation, pv[0] is the best move and pv[1] the expected reply. */
+  Move pv[MAX_PLY];
+  int pvLength = 0;
+  /** The best lines of the last completed iteration, best first; lines[0] is the line above. */
+  SearchLine lines[MAX_MULTI_PV];
+  int lineCount = 0;
+};
+
+/** When to stop a search. The last completed iteration is returned. */
+struct SearchLimits {
+  /** Depth in plies of the last iteration. */
+  int depth = MAX_PLY;
+  /** Thinking time in milliseconds, 0 for no time limit. */
+  int64_t moveTimeMs = 0;
+  /** The clock of the side to move. When set, the TimeManager decides the thinking time and
+   *  moveTimeMs is ignored.
+   */
+  TimeControl clock;
+  /** Nodes to search, 0 for no node limit. Unlike time, gives the same result on every run. */
+  uint64_t nodes = 0;
+  /** Number of best moves to find lines for, at most MAX_MULTI_PV and the number of legal moves. */
+  int multiPV = 1;
+};
+
+/** Iterative deepening alpha-beta search over a ChessBoard.
+ *  Moves are made and taken back on the board with doMove() and undoMove(),
+ *  so the board is left unchanged when the search returns.
+ */
+class Search {
+public:
+  /** Creates a search for a board.
+   *  @param _board: The board to search, it must outlive the Search.
+   *  @param ttMegabytes: Size of the transposition table.
+   *  @param memory: Page size and NUMA placement of the transposition table.
+   */
+  explicit Search(ChessBoard & _board, const size_t ttMegabytes = 16, const MemoryOptions & memory = MemoryOptions());
+
+  /** Searches the current position to a fixed depth with iterative deepening.
+   *  @param maxDepth: Depth in plies of the last iteration.
+   *  @return The best move and its score from the side to move's point of view.
+   */
+  SearchResult searchDepth(const int maxDepth);
+
+  /** Searches the current position with iterative deepening until a limit or stop() is reached.
+   *  @param limits: Depth and time limits.
+   *  @return The result of the last completed iteration.
+   */
+  SearchResult search(const SearchLimits & limits);
+
+  /** Asks a running search to return as soon as possible, safe to call from another thread.
+   *  The flag is checked at every node so the search unwinds within microseconds.
+   */
+  void stop() { stopRequested.store(true, std::memory_order_relaxed); }
+
+  /** Clears a stop() request. search() does not, so a stop() sent to a background search
+   *  before it has started is not lost.
+   */
+  void clearStop() { stopRequested.store(false, std::memory_order_relaxed); }
+
+  /** Sets or moves the deadline of a search, safe to call from another thread.
+   *  search() only sets it when given a time limit, so it can be set before a background
+   *  search has started; it is cleared when a search returns.
+   *  @param deadline: Time at which the search stops, a default time point for none.
+   */
+  void setDeadline(const SearchClock::time_point deadline);
+
+  /** Sets a function called with the result of every completed iteration, e.g. to show the
+   *  lines of an analysis as they deepen. It runs on the searching thread.
+   *  @param callback: The function, or an empty function for none.
+   */
+  void setIterationCallback(const std::function<void(const SearchResult &)> & callback) { onIteration = callback; }
+
+  /** Sets a function called every few nodes on the searching thread, the search goes on when it
+   *  returns. A SearchTask switches to other searches from it, so one thread can share its time
+   *  between many of them. The clock is read again after each call.
+   *  @param callback: The function, or an empty function for none.
+   *  @param everyNodes: Nodes searched between two calls, counted from now.
+   */
+  void setYieldCallback(const std::function<void()> & callback, const uint64_t everyNodes);
+
+  /** Sets which move ordering heuristics are used, for measuring their effect. */
+  void setOrderingOptions(const OrderingOptions & options) { ordering.setOptions(options); }
+
+  /** Sets which parts of the search are used, for measuring their effect. */
+  void setSearchOptions(const SearchOptions & _options) { options = _options; }
+
+  /** Scores positions with the board's network instead of the handcrafted evaluation.
+   *  The board must have a network attached with ChessBoard::setNetwork().
+   */
+  void setUseNetwork(const bool use) { useNetwork = use; }
+
+  /** Clears the transposition table, the pawn hash table and the ordering tables. */
+  void clear();
+
+  /** Gets the transposition table, to see how its memory was allocated. */
+  const TranspositionTable & getTable() const { return tt; }
+
+  /** Gets the statistics of the last search. */
+  const SearchStats & getStats() const { return stats; }
+
+  /** Sets a trace that records every move of the main search, it is cleared when a search starts.
+   *  @param _trace: The trace, it must outlive its use; nullptr to stop tracing.
+   */
+  void setTrace(SearchTrace* _trace) { trace = _trace; }
+
+  /** Sets a file the JSON report of writeJson() is written to after every search, one line each.
+   *  @param out: The file, nullptr for none.
+   */
+  void setReportFile(FILE* out) { reportFile = out; }
+
+  /** Writes the statistics of the last search and the trace, if one is set, as one JSON object
+   *  followed by a newline.
+   */
+  void writeJson(FILE* out) const;
+
+private:
+  ChessBoard & board;
+  TranspositionTable tt;
+  PawnHashTable pawnTable;
+  MoveOrdering ordering;
+  SearchStats stats;
+
+  /** Best move found at the root by the current iteration. */
+  Move rootBestMove;
+
+  /** Root moves left out of the current root search, the best moves of the lines already found. */
+  Move excludedRootMoves[MAX_MULTI_PV];
+  int excludedCount = 0;
+
+  std::function<void(const SearchResult &)> onIteration;
+
+  SearchOptions options;
+  bool useNetwork = false;
+
+  SearchTrace* trace = nullptr;
+  FILE* reportFile = nullptr;
+
+  /** Triangular principal variation table, pvTable[ply] holds the line from that ply. */
+  Move pvTable[MAX_PLY + 1][MAX_PLY];
+  int pvLength[MAX_PLY + 1];
+
+  TimeManager timeManager;
+
+  std::atomic<bool> stopRequested{false};
+  /** Deadline as steady clock ticks since its epoch, 0 for none. */
+  std::atomic<int64_t> deadlineTicks{0};
+  bool stopped = false;
+  /** Node limit of the current search, 0 for none. */
+  uint64_t maxNodes = 0;
+
+  std::function<void()> onYield;
+  uint64_t yieldNodes = 0;
+  /** Value of stats.nodes at which onYield is next called. */
+  uint64_t nextYieldNode = 0;
+
+  /** Checks the stop flag and, every DEADLINE_POLL_NODES nodes, the deadline, so the clock is rarely read.
+   *  Also calls the yield callback when it is due.
+   *  @return True if the search must unwind.
+   */
+  bool shouldStop();
+
+  /** Checks if a root move is left out because an earlier line of a MultiPV search has it. */
+  bool isExcludedRootMove(const Move & move) const;
+
+  /** Negamax alpha-beta search.
+   *  @param depth: Remaining depth in plies.
+   *  @param ply: Distance from the root.
+   *  @param alpha: Lower bound of the search window.
+   *  @param beta: Upper bound of the search window.
+   *  @param allowNullMove: False right after a null move, so two are not made in a row.
+   *  @return Score of the position from the side to move's point of view.
+   */
+  int alphaBeta(int depth, const int ply, int alpha, int beta, const bool allowNullMove = true);
+
+  /** Searches captures and promotions until the position is quiet, and every move when in check.
+   *  The side to move may stand pat on the static evaluation unless it is in check.
+   *  @param ply: Distance from the root.
+   *  @param alpha: Lower bound of the search window.
+   *  @param beta: Upper bound of the search window.
+   *  @return Score of the position from the side to move's point of view.
+   */
+  int quiescence(const int ply, int alpha, int beta);
+
+  /** Scores the current position with the network or the handcrafted evaluation. */
+  int evaluatePosition();
+};
+
+#endif // SEARCH_H
@@ -0,0 +1,125 @@
+#include"SearchScheduler.h"
+#include"ChessBoard.h"
+#include<new>
+
+SearchTask::SearchTask(ChessBoard & _board, const size_t ttMegabytes) : search(_board, ttMegabytes) {}
+
+void SearchTask::start(const SearchLimits & _limits, const SearchClock::time_point _deadline) {
+  limits = _limits;
+  deadline = _deadline;
+  result = SearchResult();
+  slices = 0;
+
+  // Normal pages, a stack only touches a few of them
+  MemoryOptions options;
+  options.hugePages = HugePagesOff;
+  stack.reset(new LargeMemory(STACK_BYTES, options));
+  if (stack->data() == nullptr) {
+    stack.reset();
+    throw std::bad_alloc();
+  }
+  getcontext(&taskContext);
+  taskContext.uc_stack.ss_sp = stack->data();
+  taskContext.uc_stack.ss_size = STACK_BYTES;
+  // Returning from run() goes back to the last resume()
+  taskContext.uc_link = &callerContext;
+  uintptr_t self = reinterpret_cast<uintptr_t>(this);
+  makecontext(&taskContext, reinterpret_cast<void (*)()>(&SearchTask::run), 2, static_cast<int>(self & 0xFFFFFFFF),
+	      static_cast<int>(self >> 32));
+
+  search.clearStop();
+  search.setDeadline(deadline);
+  finished = false;
+}
+
+void SearchTask::run(const int low, const int high) {
+  SearchTask* task = reinterpret_cast<SearchTask*>(static_cast<uintptr_t>(static_cast<uint32_t>(high)) << 32 |
+						   static_cast<uint32_t>(low));
+  task->result = task->search.search(task->limits);
+  task->finished = true;
+}
+
+bool SearchTask::resume(const uint64_t sliceNodes) {
+  if (finished) {
+    return true;
+  }
+  slices++;
+  search.setYieldCallback([this]() { swapcontext(&taskContext, &callerContext); }, sliceNodes);
+  swapcontext(&callerContext, &taskContext);
+  if (finished) {
+    // Back on the caller's stack, so the search's one can go
+    search.setYieldCallback(std::function<void()>(), 0);
+    stack.reset();
+  }
+  return finished;
+}
+
+SearchScheduler::SearchScheduler(const unsigned threads, const uint64_t _sliceNodes)
+  : sliceNodes(_sliceNodes > 0 ? _sliceNodes : DEFAULT_SLICE_NODES) {
+  for (unsigned i = 0; i < (threads > 0 ? threads : 1); i++) {
+    workers.emplace_back(&SearchScheduler::work, this);
+  }
+}
+
+SearchScheduler::~SearchScheduler() {
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    shuttingDown = true;
+  }
+  workAvailable.notify_all();
+  for (std::thread & worker : workers) {
+    worker.join();
+  }
+}
+
+void SearchScheduler::submit(SearchTask & task, const std::function<void(SearchTask &)> & onFinished) {
+  SearchClock::time_point deadline = task.getDeadline();
+  int64_t ticks = deadline == SearchClock::time_point() ? INT64_MAX : deadline.time_since_epoch().count();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push(QueuedTask{&task, onFinished, ticks, sequence++});
+    pending++;
+  }
+  workAvailable.notify_one();
+}
+
+void SearchScheduler::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  allFinished.wait(lock, [this]() { return pending == 0; });
+}
+
+uint64_t SearchScheduler::getSlices() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return slices;
+}
+
+void SearchScheduler::work() {
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    workAvailable.wait(lock, [this]() { return shuttingDown || !queue.empty(); });
+    if (queue.empty()) {
+      return;
+    }
+    QueuedTask queued = queue.top();
+    queue.pop();
+    slices++;
+
+    lock.unlock();
+    bool done = queued.task->resume(sliceNodes);
+    if (done && queued.onFinished) {
+      queued.onFinished(*queued.task);
+    }
+    lock.lock();
+
+    if (done) {
+      if (--pending == 0) {
+	allFinished.notify_all();
+      }
+    } else {
+      // Behind the tasks with the same deadline that are waiting
+      queued.sequence = sequence++;
+      queue.push(queued);
+    }
+  }
+}
@@ -0,0 +1,150 @@
+#ifndef SEARCHSCHEDULER_H
+#define SEARCHSCHEDULER_H
+
+#include"LargeMemory.h"
+#include"Search.h"
+#include<condition_variable>
+#include<cstdint>
+#include<functional>
+#include<memory>
+#include<mutex>
+#include<queue>
+#include<thread>
+#include<ucontext.h>
+#include<vector>
+
+class ChessBoard;
+
+/** A search that runs a slice of nodes at a time, so one thread can interleave the searches of
+ *  many game sessions.
+ *  The search runs unchanged on a stack of its own. Every slice it yields from the search's yield
+ *  callback, switching back to the thread that resumed it; the next resume() switches back in and
+ *  the search carries on where it stopped. A suspended task may be resumed by another thread.
+ *  The stack only exists while a search is in progress, and only its touched pages use memory.
+ */
+class SearchTask {
+public:
+  /** Size of the stack a search runs on. A search is a few KB per ply of the main and the
+   *  quiescence search.
+   */
+  static const size_t STACK_BYTES = 512 * 1024;
+
+  /** Creates a task for the board of a session.
+   *  @param _board: The board, it must outlive the task and be left alone while a search is in progress.
+   *  @param ttMegabytes: Size of the transposition table of the task's search.
+   */
+  explicit SearchTask(ChessBoard & _board, const size_t ttMegabytes = 1);
+
+  SearchTask(const SearchTask &) = delete;
+  SearchTask & operator=(const SearchTask &) = delete;
+
+  /** Sets up a search of the board's position, resume() runs it. The last search must have finished.
+   *  @param _limits: Limits of the search.
+   *  @param _deadline: Time the result is needed by, the search stops then and returns its last
+   *  completed iteration. A default time point for none.
+   *  @throws std::bad_alloc if the stack cannot be mapped.
+   */
+  void start(const SearchLimits & _limits, const SearchClock::time_point _deadline = SearchClock::time_point());
+
+  /** Runs the search until it has searched sliceNodes more nodes or has finished.
+   *  @param sliceNodes: Nodes to search before yielding.
+   *  @return True once the search has finished and getResult() holds its result.
+   */
+  bool resume(const uint64_t sliceNodes);
+
+  bool isFinished() const { return finished; }
+
+  const SearchResult & getResult() const { return result; }
+
+  SearchClock::time_point getDeadline() const { return deadline; }
+
+  /** Gets the number of times the current or last search was resumed. */
+  int getSlices() const { return slices; }
+
+  /** Gets the search, e.g. for its statistics or to set its options between searches. */
+  Search & getSearch() { return search; }
+
+private:
+  Search search;
+  SearchLimits limits;
+  SearchResult result;
+  SearchClock::time_point deadline;
+  std::unique_ptr<LargeMemory> stack;
+  /** Where the search goes on from, and where resume() was called from. */
+  ucontext_t taskContext;
+  ucontext_t callerContext;
+  bool finished = true;
+  int slices = 0;
+
+  /** Entry point of the task's stack, makecontext() only passes ints so the task pointer comes in two halves. */
+  static void run(const int low, const int high);
+};
+
+/** Threads that share their time between many SearchTasks.
+ *  Each thread takes the task with the earliest deadline, tasks without one coming last, and runs
+ *  one slice of it; a task that has not finished goes back in the queue behind the others with the
+ *  same deadline. Urgent searches therefore run first and the rest share the threads in turn.
+ */
+class SearchScheduler {
+public:
+  /** Nodes of one slice, some milliseconds of search. */
+  static const uint64_t DEFAULT_SLICE_NODES = 4096;
+
+  /** Starts the threads.
+   *  @param threads: Number of threads, at least one.
+   *  @param _sliceNodes: Nodes a task searches before the thread moves on to the next one.
+   */
+  explicit SearchScheduler(const unsigned threads, const uint64_t _sliceNodes = DEFAULT_SLICE_NODES);
+
+  /** Waits for every submitted task to finish, then stops the threads. */
+  ~SearchScheduler();
+
+  SearchScheduler(const SearchScheduler &) = delete;
+  SearchScheduler & operator=(const SearchScheduler &) = delete;
+
+  /** Queues a task set up with SearchTask::start(), thread safe.
+   *  @param task: The task, it must outlive its search.
+   *  @param onFinished: Called on a scheduler thread once the task's search has finished, may be empty.
+   */
+  void submit(SearchTask & task, const std::function<void(SearchTask &)> & onFinished = std::function<void(SearchTask &)>());
+
+  /** Waits until every submitted task has finished. */
+  void wait();
+
+  /** Gets the number of slices run so far. */
+  uint64_t getSlices() const;
+
+private:
+  struct QueuedTask {
+    SearchTask* task;
+    std::function<void(SearchTask &)> onFinished;
+    /** Deadline as steady clock ticks, INT64_MAX for none. */
+    int64_t deadline;
+    /** Order of queueing, so tasks with the same deadline take turns. */
+    uint64_t sequence;
+  };
+
+  /** Orders the queue so its top is the earliest deadline, queued first. */
+  struct RunsLater {
+    bool operator()(const QueuedTask & a, const QueuedTask & b) const {
+      return a.deadline != b.deadline ? a.deadline > b.deadline : a.sequence > b.sequence;
+    }
+  };
+
+  uint64_t sliceNodes;
+  std::priority_queue<QueuedTask, std::vector<QueuedTask>, RunsLater> queue;
+  mutable std::mutex mutex;
+  std::condition_variable workAvailable;
+  std::condition_variable allFinished;
+  /** Tasks submitted and not finished, queued or running. */
+  size_t pending = 0;
+  uint64_t sequence = 0;
+  uint64_t slices = 0;
+  bool shuttingDown = false;
+  std::vector<std::thread> workers;
+
+  /** Loop of each thread. */
+  void work();
+};
+
+#endif // SEARCHSCHEDULER_H
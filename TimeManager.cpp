@@ -0,0 +1,69 @@
+#include"TimeManager.h"
+
+namespace {
+  /** Moves the clock is shared between when it has to last the rest of the game. */
+  const int64_t SUDDEN_DEATH_MOVES = 30;
+  /** The hard limit is this many times the normal time of a move. */
+  const int64_t HARD_LIMIT_FACTOR = 4;
+  /** Score drop between iterations, in centipawns, that makes the search think longer. */
+  const int SMALL_SCORE_DROP = 20;
+  const int LARGE_SCORE_DROP = 50;
+  /** An iteration takes a few times as long as the one before, so the next one is only started
+   *  if less than this share of the soft limit has been used.
+   */
+  const double NEXT_ITERATION_SHARE = 0.4;
+}
+
+void TimeManager::start(const TimeControl & control, const SearchClock::time_point now) {
+  startTime = now;
+  lastBestMove = Move();
+  lastScore = 0;
+  iterations = 0;
+  stableIterations = 0;
+
+  int64_t usable = control.remainingMs - MOVE_OVERHEAD_MS;
+  if (usable < 0) {
+    usable = 0;
+  }
+  int64_t movesLeft = SUDDEN_DEATH_MOVES;
+  if (control.movesToGo > 0 && control.movesToGo < movesLeft) {
+    movesLeft = control.movesToGo;
+  }
+  // Most of the increment comes back after the move, so it can be spent now
+  int64_t normalMs = usable / movesLeft + control.incrementMs * 3 / 4;
+
+  // No single move may take more than half the clock, except the last one before the clock is topped up
+  int64_t maximumMs = control.movesToGo == 1 ? usable * 4 / 5 : usable / 2;
+  hardMs = normalMs * HARD_LIMIT_FACTOR < maximumMs ? normalMs * HARD_LIMIT_FACTOR : maximumMs;
+  // With nothing left but the overhead the limits are 0, the search then stops at its first look
+  // at the clock and plays the best move found so far
+  softMs = normalMs < hardMs ? normalMs : hardMs;
+}
+
+bool TimeManager::shouldStartIteration(const Move & bestMove, const int score) {
+  double scale = 1.0;
+  if (iterations > 0) {
+    stableIterations = bestMove == lastBestMove ? stableIterations + 1 : 0;
+    // A best move that keeps changing needs more time, one that has settled needs less
+    if (stableIterations == 0) {
+      scale = 1.5;
+    } else if (stableIterations >= 4) {
+      scale = 0.5;
+    } else if (stableIterations >= 2) {
+      scale = 0.75;
+    }
+    // A falling score means trouble was found, look for a way out
+    int drop = lastScore - score;
+    if (drop > LARGE_SCORE_DROP) {
+      scale *= 1.6;
+    } else if (drop > SMALL_SCORE_DROP) {
+      scale *= 1.25;
+    }
+  }
+  iterations++;
+  lastBestMove = bestMove;
+  lastScore = score;
+
+  double elapsedMs = std::chrono::duration<double, std::milli>(SearchClock::now() - startTime).count();
+  return elapsedMs < softMs * scale * NEXT_ITERATION_SHARE;
+}
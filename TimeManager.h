@@ -0,0 +1,62 @@
+#ifndef TIMEMANAGER_H
+#define TIMEMANAGER_H
+
+#include"Move.h"
+#include<chrono>
+#include<cstdint>
+
+typedef std::chrono::steady_clock SearchClock;
+
+/** The clock of the side to move, as given by a game server. */
+struct TimeControl {
+  /** Time left on the clock in milliseconds, negative for no clock. */
+  int64_t remainingMs = -1;
+  /** Time added to the clock after each move. */
+  int64_t incrementMs = 0;
+  /** Moves to play before the clock is topped up, 0 if the rest of the game must be played in the remaining time. */
+  int movesToGo = 0;
+};
+
+/** Decides how long to think on a move played under a clock.
+ *  Each move gets a soft limit, the time it should normally take, and a hard limit that the
+ *  search is stopped at no matter what. The soft limit is only looked at between iterations:
+ *  it shrinks while the best move stays the same and grows when the best move changes or the
+ *  score drops, so time is spent where the search is unsure.
+ */
+class TimeManager {
+public:
+  /** Time kept back on every move for sending the move and other overheads, in milliseconds. */
+  static const int64_t MOVE_OVERHEAD_MS = 10;
+
+  /** Works out the limits of a move.
+   *  @param control: The clock of the side to move.
+   *  @param now: The time the move's search starts.
+   */
+  void start(const TimeControl & control, const SearchClock::time_point now);
+
+  /** Gets the time the search must be stopped at. */
+  SearchClock::time_point getHardDeadline() const { return startTime + std::chrono::milliseconds(hardMs); }
+
+  int64_t getSoftMs() const { return softMs; }
+  int64_t getHardMs() const { return hardMs; }
+
+  /** Called after every completed iteration to decide if another one is worth starting.
+   *  @param bestMove: The best move of the iteration.
+   *  @param score: Its score.
+   *  @return True to search one ply deeper, only if the iteration is likely to end before the soft limit.
+   */
+  bool shouldStartIteration(const Move & bestMove, const int score);
+
+private:
+  SearchClock::time_point startTime;
+  int64_t softMs = 0;
+  int64_t hardMs = 0;
+
+  Move lastBestMove;
+  int lastScore = 0;
+  int iterations = 0;
+  /** Consecutive iterations that kept the same best move. */
+  int stableIterations = 0;
+};
+
+#endif // TIMEMANAGER_H
@@ -0,0 +1,43 @@
+#include"TranspositionTable.h"
+#include<new>
+
+namespace {
+  /** Round down to a power of two so the index is a mask of the key. */
+  size_t entryCount(const size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(TTEntry) <= megabytes * 1024 * 1024) {
+      count *= 2;
+    }
+    return count;
+  }
+}
+
+TranspositionTable::TranspositionTable(const size_t megabytes, const MemoryOptions & options)
+  : memory(entryCount(megabytes) * sizeof(TTEntry), options) {
+  if (memory.data() == nullptr) {
+    throw std::bad_alloc();
+  }
+  entries = static_cast<TTEntry*>(memory.data());
+  mask = entryCount(megabytes) - 1;
+}
+
+void TranspositionTable::clear() {
+  memory.clear();
+}
+
+const TTEntry * TranspositionTable::probe(const uint64_t key) const {
+  const TTEntry & entry = entries[key & mask];
+  if (entry.bound != BoundNone && entry.key == key) {
+    return &entry;
+  }
+  return nullptr;
+}
+
+void TranspositionTable::store(const uint64_t key, const Move & bestMove, const int score, const int depth, const Bound bound) {
+  TTEntry & entry = entries[key & mask];
+  entry.key = key;
+  entry.bestMove = bestMove;
+  entry.score = static_cast<int16_t>(score);
+  entry.depth = static_cast<int8_t>(depth);
+  entry.bound = bound;
+}
@@ -0,0 +1,63 @@
+#ifndef TRANSPOSITIONTABLE_H
+#define TRANSPOSITIONTABLE_H
+
+#include"LargeMemory.h"
+#include"Move.h"
+#include<cstdint>
+#include<cstddef>
+
+/** Bound type of a stored score. */
+enum Bound : uint8_t { BoundNone, BoundUpper, BoundLower, BoundExact };
+
+/** One transposition table slot. All zero bytes is an empty slot, so fresh pages need no setting up. */
+struct TTEntry {
+  uint64_t key = 0;
+  Move bestMove;
+  int16_t score = 0;
+  int8_t depth = 0;
+  Bound bound = BoundNone;
+};
+
+/** Fixed-size, always-replace hash table of search results keyed by Zobrist key.
+ *  The entries live in a LargeMemory block, on huge pages when the system has them, and are
+ *  only placed in memory when the search first writes them.
+ */
+class TranspositionTable {
+public:
+  /** Creates a table with a power of two number of entries.
+   *  @param megabytes: Approximate size of the table in megabytes.
+   *  @param options: Page size and NUMA placement of the entries.
+   *  @throws std::bad_alloc if the memory cannot be mapped.
+   */
+  explicit TranspositionTable(const size_t megabytes = 16, const MemoryOptions & options = MemoryOptions());
+
+  /** Clears all entries. */
+  void clear();
+
+  /** Starts loading the slot of a position into the cache, so a probe() a little later does not
+   *  wait for memory. Called as soon as a move is made, before the child node looks at the table.
+   */
+  void prefetch(const uint64_t key) const { __builtin_prefetch(&entries[key & mask]); }
+
+  /** Gets the number of entries. */
+  size_t getSize() const { return mask + 1; }
+
+  /** Gets the block the entries are in, to see which pages it got. */
+  const LargeMemory & getMemory() const { return memory; }
+
+  /** Looks up a position.
+   *  @param key: The Zobrist key of the position.
+   *  @return The matching entry, or nullptr if the position is not stored.
+   */
+  const TTEntry * probe(const uint64_t key) const;
+
+  /** Stores a search result, replacing whatever was in the slot. */
+  void store(const uint64_t key, const Move & bestMove, const int score, const int depth, const Bound bound);
+
+private:
+  LargeMemory memory;
+  TTEntry* entries;
+  size_t mask;
+};
+
+#endif // TRANSPOSITIONTABLE_H
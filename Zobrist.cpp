@@ -0,0 +1,68 @@
+#include"Zobrist.h"
+
+namespace {
+  /** All keys, generated on first use. 12 * 64 piece keys, 4 castling keys, 8 en passant keys and 1 side key. */
+  struct ZobristKeys {
+    uint64_t pieces[12][64];
+    uint64_t castle[4];
+    uint64_t enPassant[8];
+    uint64_t side;
+
+    ZobristKeys() {
+      // SplitMix64 with a fixed seed, so keys are identical on every run
+      uint64_t state = 0x9E3779B97F4A7C15ULL;
+      auto next = [&state]() {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+      };
+      for (int p = 0; p < 12; p++) {
+	for (int sq = 0; sq < 64; sq++) {
+	  pieces[p][sq] = next();
+	}
+      }
+      for (int i = 0; i < 4; i++) {
+	castle[i] = next();
+      }
+      for (int i = 0; i < 8; i++) {
+	enPassant[i] = next();
+      }
+      side = next();
+    }
+  };
+
+  const ZobristKeys & keys() {
+    static const ZobristKeys instance;
+    return instance;
+  }
+}
+
+int Zobrist::pieceIndex(const char symbol, const Colour colour) {
+  int base = (colour == White) ? 0 : 6;
+  switch (symbol) {
+    case 'p': return base + 0;
+    case 'n': return base + 1;
+    case 'b': return base + 2;
+    case 'r': return base + 3;
+    case 'q': return base + 4;
+    case 'k': return base + 5;
+    default : return -1;
+  }
+}
+
+uint64_t Zobrist::pieceKey(const int pieceIndex, const int square) {
+  return keys().pieces[pieceIndex][square];
+}
+
+uint64_t Zobrist::castleKey(const int index) {
+  return keys().castle[index];
+}
+
+uint64_t Zobrist::enPassantKey(const int col) {
+  return keys().enPassant[col];
+}
+
+uint64_t Zobrist::sideKey() {
+  return keys().side;
+}
@@ -0,0 +1,29 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include"Pieces.h"
+#include<cstdint>
+
+/** Zobrist hashing keys.
+ *  A position key is the XOR of one key per (piece, square), one key per available castling right,
+ *  the file key of the en passant square if there is one and the side key when Black is to move.
+ *  Keys are generated once from a fixed seed so hashes are reproducible between runs.
+ */
+namespace Zobrist {
+  /** Returns the 0-11 piece index for a lowercase FEN piece symbol and a colour, or -1 if unknown. */
+  int pieceIndex(const char symbol, const Colour colour);
+
+  /** Key for a piece (index from pieceIndex()) standing on a square index. */
+  uint64_t pieceKey(const int pieceIndex, const int square);
+
+  /** Key for castling right index (CastleDirection). */
+  uint64_t castleKey(const int index);
+
+  /** Key for an en passant target square on a file (column 0-7). */
+  uint64_t enPassantKey(const int col);
+
+  /** Key XORed in when Black is to move. */
+  uint64_t sideKey();
+}
+
+#endif // ZOBRIST_H